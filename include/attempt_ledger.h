@@ -0,0 +1,45 @@
+#ifndef ATTEMPT_LEDGER_H
+#define ATTEMPT_LEDGER_H
+
+#include "common_includes.h"
+#include "config.h"
+#include "nlohmann/json.hpp"
+using json = nlohmann::json;
+
+/*
+AttemptLedger is an append-only record of the attempts of a search, one JSON object per line: a header with the channel, the seed and
+the configuration, then one line per finished attempt. Every record is written to the file as soon as it is appended, and synced in
+batches (every LEDGER_SYNC_RECORDS records or LEDGER_SYNC_SECONDS seconds), so that a crash loses at most the last batch and never
+leaves more than a partial last line. That line is dropped when the ledger is opened again, and the search continues after the
+attempts that are recorded. The file is also meant to be read back for statistics on the attempts.
+*/
+class AttemptLedger {
+public:
+    AttemptLedger();
+    ~AttemptLedger();                           // Syncs and closes the file
+
+    // Open the ledger for appending. A new (or empty) file gets header as its first line. An existing one must have been written for
+    // the same channel: its records are read, and a partial last line is cut off. Throws std::runtime_error.
+    int open(const std::string& filename, const json& header);
+    int append(const json& record);             // Write a record, and sync if the batch is full
+    int sync();                                 // Sync what was written so far
+    static bool readHeader(const std::string& filename, json* header); // Header of an existing ledger, false if there is none
+    static json encodeVector(const std::vector<std::complex<double> >& vector); // As [[re, im], ...], exact since doubles are written with 17 digits
+    static std::vector<std::complex<double> > decodeVector(const json& encoded);
+
+    // Getters
+    const json& getHeader();
+    const std::vector<json>& getRecords();      // Records read by open, and appended since
+
+private:
+    int fd;
+    std::string filename;
+    json header;
+    std::vector<json> records;
+    int unsynced;                               // Records written since the last sync
+    std::chrono::steady_clock::time_point first_unsynced;
+
+    int writeLine(const json& line);
+};
+
+#endif
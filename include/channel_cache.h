@@ -0,0 +1,52 @@
+#ifndef CHANNEL_CACHE_H
+#define CHANNEL_CACHE_H
+
+#include "common_includes.h"
+#include "config.h"
+#include "vector_serializer.h"
+
+/*
+ChannelCache keeps what runs derive from a Kraus file in a sidecar next to it (its name followed by CHANNEL_CACHE_EXTENSION), so that
+later runs on the same channel skip that work: the verification of the checksum, the detected symmetry generators, the block
+decomposition and the ranked channel-informed starts. The sidecar is keyed by the checksum in the footer of the Kraus file, a hash of
+its content, and by its dimensions; a sidecar of other content is ignored, and replaced on the next store. The verification is only
+trusted for the file it was done on: it is also keyed by the size and modification time of the Kraus file.
+
+The sidecar is a file of type "channel" (magic CHANL, see VectorSerializer). Its data are the vectors of all sections one after the
+other, and its metadata says where each section starts, with the configuration the section was computed for. Sections are mapped in
+place. Storing one writes the whole sidecar to a temporary file and renames it, so that concurrent runs never see a partial one; at
+worst one of them recomputes a section another one stored at the same time.
+*/
+class ChannelCache {
+public:
+    ChannelCache();
+
+    // Use the sidecar of the Kraus file, which is already mapped as kraus. Returns 1 if the sidecar holds nothing for this content.
+    // Throws std::runtime_error if the Kraus file has no content hash (format version 1.0).
+    int open(const std::string& kraus_filename, const MappedData& kraus);
+    bool isVerified();                          // Whether the checksum of this very Kraus file was verified by an earlier run
+    int setVerified();
+
+    // A section is found only if it was stored with the same key (the configuration it depends on). vectors points into the mapping,
+    // and is valid as long as the cache is not stored to. Store throws std::runtime_error, e.g. if the directory is read-only.
+    bool getSection(const std::string& name, const json& key, json* info, ComplexView* vectors);
+    int storeSection(const std::string& name, const json& key, const json& info, const ComplexView& vectors);
+
+    // Getters
+    std::string getFilename();
+
+private:
+    std::string filename;
+    std::string kraus_filename;
+    json identity;                              // Checksum and dimensions of the Kraus file
+    json file_state;                            // Size and modification time of the Kraus file, for the verification
+    json verified;                              // file_state of the last verification, null if none
+    json sections;                              // name: {"key", "info", "offset", "count"}, offsets in elements of the data
+    MappedData mapped;                          // The sidecar, if it was read or written
+    int d, N;
+
+    // Write the sidecar with the sections other than replaced, then the new one if vectors is not null. Throws std::runtime_error.
+    int write(const std::string& replaced, const json& new_section, const ComplexView* vectors);
+};
+
+#endif
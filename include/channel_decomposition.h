@@ -0,0 +1,48 @@
+#ifndef CHANNEL_DECOMPOSITION_H
+#define CHANNEL_DECOMPOSITION_H
+
+#include "common_includes.h"
+#include "config.h"
+#include "complex_view.h"
+#include "vector_serializer.h"
+
+/*
+ChannelDecomposition finds the common invariant subspaces of the Kraus operators of a channel.
+
+The invariant subspaces of the *-algebra generated by {K_k, K_k^H} are the eigenspaces of a generic Hermitian element
+of its commutant, i.e. of the space of matrices X with [X, K_k] = [X, K_k^H] = 0 for all k.
+The commutant is the kernel of the (positive semidefinite) superoperator
+    L(X) = sum_k ad_{K_k}^H ad_{K_k}(X) + ad_{K_k^H}^H ad_{K_k^H}(X),
+which we build explicitly as an N^2 x N^2 matrix and diagonalize. This is only sensible for moderate N.
+*/
+class ChannelDecomposition {
+public:
+    ChannelDecomposition(ComplexView* kraus_ops, int kraus_number, int kraus_dimension);
+    ~ChannelDecomposition();
+
+    int decompose();                            // Find the block structure. Returns the number of blocks found (1 if the channel is irreducible or too large)
+
+    // Getters
+    int getBlockCount();
+    int getBlockDimension(int block);
+    std::vector<std::complex<double> >* getBlockKraus(int block);  // Returns the d restricted Kraus operators Q_b^H K_k Q_b of the block. Created with new, so it must be deleted.
+    std::vector<std::complex<double> > embedVector(int block, const std::vector<std::complex<double> >& block_vector); // Maps a vector of the block back to C^N
+    std::string describe();                     // Human readable summary of the block structure
+
+    // The result of decompose(), e.g. to cache it: the dimensions in the snapshot, the basis on its own
+    json getSnapshot();
+    const std::vector<std::complex<double> >& getBasis();
+    int restoreSnapshot(const json& snapshot, const ComplexView& new_basis); // Instead of decompose(). Throws std::runtime_error if they do not fit.
+
+private:
+    int N, d;
+    int commutant_dimension;
+    ComplexView* kraus_operators;
+    std::vector<std::complex<double> >* basis;  // NxN unitary. Its columns are grouped by block, block b occupying columns block_offsets[b] ... block_offsets[b]+block_dimensions[b]-1
+    std::vector<int> block_dimensions;
+    std::vector<int> block_offsets;
+
+    int buildCommutantOperator(std::vector<std::complex<double> >* L);
+};
+
+#endif
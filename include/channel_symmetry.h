@@ -0,0 +1,51 @@
+#ifndef CHANNEL_SYMMETRY_H
+#define CHANNEL_SYMMETRY_H
+
+#include "common_includes.h"
+#include "config.h"
+#include "complex_view.h"
+
+/*
+ChannelSymmetry stores a finite group of unitaries U under which the channel is covariant, i.e. Phi(U rho U^H) = V Phi(rho) V^H
+for some unitary V (we test V = U and V = conj(U)). Output entropies are invariant under such U, and so is the fixed point iteration,
+so two vectors in the same orbit are the same minimum.
+
+Orbits are represented in the fundamental domain
+    D = { v : |<r|v>| >= |<r|U v>| for all U in the group }
+of a fixed, generic reference vector r.
+*/
+class ChannelSymmetry {
+public:
+    ChannelSymmetry(ComplexView* kraus_ops, int kraus_number, int kraus_dimension);
+    ~ChannelSymmetry();
+
+    // Building the group
+    int addGenerator(const std::vector<std::complex<double> >& unitary); // Adds a generator if the channel is covariant under it. Returns 0 if accepted, 1 otherwise.
+    int detectGenerators();                     // Tries the Weyl-Heisenberg operators X^a Z^b as generators. Returns how many were accepted.
+    int generateGroup();                        // Closes the generators under multiplication (up to a phase). Returns the order of the group.
+    std::vector<std::complex<double> > getGenerators(); // The generators, one NxN matrix after the other, e.g. to cache what detectGenerators found
+    int restoreGenerators(const ComplexView& unitaries); // Adds generators that are known to be symmetries, without testing them. Returns how many.
+
+    // Using the group
+    int toFundamentalDomain(std::vector<std::complex<double> >* vector);    // Replaces the vector with the representative of its orbit in D. Returns the index of the group element used.
+    int canonicalize(std::vector<std::complex<double> >* vector);           // Same, but also fixes the global phase so that <r|v> is real and positive
+    double orbitFidelity(const std::vector<std::complex<double> >& first, const std::vector<std::complex<double> >& second); // max over the group of |<first|U second>|
+
+    // Getters
+    int getGroupOrder();
+    int getGeneratorCount();
+
+private:
+    int N, d;
+    ComplexView* kraus_operators;
+    std::vector<std::vector<std::complex<double> > > generators;
+    std::vector<std::vector<std::complex<double> > > group;    // All group elements, identity first. Each is NxN in column-major order.
+    std::vector<std::complex<double> > reference;              // Reference vector r defining the fundamental domain
+    std::vector<std::vector<std::complex<double> > > reference_images; // U r for every group element U, used to tell group elements apart
+
+    bool isCovariant(const std::vector<std::complex<double> >& unitary);
+    bool inGroup(const std::vector<std::complex<double> >& unitary);
+    std::vector<std::complex<double> > applyToReference(const std::vector<std::complex<double> >& unitary);
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef CHECKPOINT_WRITER_H
+#define CHECKPOINT_WRITER_H
+
+#include "common_includes.h"
+#include "vector_serializer.h"
+#include "vector_collection.h"
+
+/*
+CheckpointWriter saves vectors from a background thread, so that the minimization loop only pays for a copy of the vector. It has two
+buffers: submit copies the vector into the pending one and returns, while the thread serializes the other one to a temporary file,
+fsyncs it and renames it over the target (then fsyncs the directory), so that a checkpoint on disk is always complete. If a new vector
+is submitted before the pending one was picked up, it replaces it: only the latest state matters, and a slow disk never holds up the
+computation. Vectors may also go to a collection (see VectorCollection), where they are appended instead. The thread does not print
+anything: errors are collected and handed over by takeErrors.
+*/
+class CheckpointWriter {
+public:
+    CheckpointWriter();                 // Starts the writer thread
+    ~CheckpointWriter();                // Writes what is still pending, then stops the thread
+
+    // Copy vec and queue it for writing to filename, as VectorSerializer::serialize would. Returns 1 if this replaced a pending vector
+    // that was never written, 0 otherwise. With a collection, the vector is appended to it, and filename only names it in errors.
+    int submit(const std::string& type, const std::vector<std::complex<double> >& vec, const std::string& filename, const std::string& description, int d, int N, const json& metadata, VectorCollection* collection = nullptr);
+    int flush();                        // Wait until everything submitted so far is on disk (or failed)
+    std::vector<std::string> takeErrors(); // Error messages of failed writes since the last call
+    int getWritten();                   // Number of vectors written so far
+    int getCoalesced();                 // Number of vectors replaced before they were written
+
+private:
+    struct Job {
+        std::string type;
+        std::vector<std::complex<double> > data;
+        std::string filename;
+        std::string description;
+        int d, N;
+        json metadata;
+        VectorCollection* collection;   // nullptr to write filename
+    };
+    Job pending, writing;               // Swapped when the thread picks up a vector, so their buffers are reused
+    bool has_pending, busy, stopping;
+    int written, coalesced;
+    std::vector<std::string> errors;
+    std::mutex mutex;
+    std::condition_variable wake;       // The thread waits on it for work
+    std::condition_variable idle;       // flush waits on it for the thread to be done
+    std::thread thread;
+
+    int work();
+    static int writeAtomically(const Job& job); // Throws std::runtime_error or std::filesystem::filesystem_error
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include "common_includes.h"
+
+/*
+Checksums of serialized files. xxHash64 (Collet, 2012) reads 32 bytes per round with four independent accumulators, so it runs at
+memory bandwidth, and unlike a byte sum it catches swapped, zeroed or shifted blocks. Large buffers are cut into chunks of a fixed
+size that are hashed in parallel (chunk i with seed i), and the chunk hashes are hashed once more. The result depends on the chunk
+size but not on the number of threads, so the chunk size is stored with the data.
+*/
+uint64_t xxHash64(const uint8_t* data, size_t length, uint64_t seed);
+uint64_t chunkedHash(const uint8_t* data, size_t length, size_t chunk_size); // Parallel over chunks, with one thread per core at most
+
+// Incremental versions, for data that arrives in pieces of any size. digest() gives the same value as the functions above on the whole.
+class XxHash64 {
+public:
+    XxHash64(uint64_t seed);
+    void update(const uint8_t* data, size_t length);
+    uint64_t digest() const;
+private:
+    uint64_t seed;
+    uint64_t accumulators[4];
+    uint8_t buffer[32];     // Bytes of the last, incomplete stripe
+    size_t buffered;
+    uint64_t total;
+};
+
+class ChunkedHash {
+public:
+    ChunkedHash(size_t chunk_size);
+    void update(const uint8_t* data, size_t length);
+    uint64_t digest() const;
+private:
+    size_t chunk_size;
+    size_t filled;          // Bytes in the current chunk
+    uint64_t total;
+    XxHash64 current;
+    std::vector<uint64_t> hashes; // Of the completed chunks
+};
+
+#endif
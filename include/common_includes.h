@@ -6,11 +6,18 @@
 #include <filesystem>
 #include <iomanip>
 #include <vector>
+#include <memory>
 #include <random>
 #include <complex>
 #include <algorithm>
+#include <numeric>
 #include <stdexcept>
 #include <atomic>   // For atomic variables
+#include <thread>   // Threads and synchronization, for racing and parallel work
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional> // Callbacks, e.g. where serialized bytes go
 #include <csignal>  // For signal handling (e.g. SIGTERM to stop the program)
 
 #include <cmath>
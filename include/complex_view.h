@@ -0,0 +1,30 @@
+#ifndef COMPLEX_VIEW_H
+#define COMPLEX_VIEW_H
+
+#include "common_includes.h"
+
+/*
+ComplexView is a read-only window onto contiguous complex data owned by somebody else: a std::vector, or the data region of a memory
+mapped file (see VectorSerializer::map). It has the part of the std::vector interface the Kraus operators are used through, so that a
+channel of several GB is handed to the minimizers without being copied. The owner must outlive the view, and a vector it looks at must
+not be resized in the meantime.
+*/
+class ComplexView {
+public:
+    ComplexView();
+    ComplexView(const std::complex<double>* data, size_t size);
+    ComplexView(const std::vector<std::complex<double> >& vec);
+
+    const std::complex<double>& at(size_t i) const; // Throws std::out_of_range like std::vector::at
+    const std::complex<double>* data() const;
+    const std::complex<double>* begin() const;
+    const std::complex<double>* end() const;
+    size_t size() const;
+    bool empty() const;
+
+private:
+    const std::complex<double>* first;
+    size_t length;
+};
+
+#endif
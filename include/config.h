@@ -26,13 +26,34 @@ EntropyMinimizer parameters
 #define DEFAULT_MINIMIZER_MOE_PREDICTION_TOLERANCE 1e-5     // What is the tolerance for the MOE prediction?
 #define DEFAULT_MINIMIZER_MINIMIZATION_ATTEMPTS 100         // How many times to run the minimization algorithm before giving up
 
+#define DEFAULT_MINIMIZER_START_SEQUENCE START_SEQUENCE_RANDOM // How random starting vectors are drawn
+#define DEFAULT_MINIMIZER_CHANNEL_STARTS 4                  // With START_SEQUENCE_CHANNEL, how many of the best ranked candidates to use before random starts
+#define DEFAULT_MINIMIZER_OBJECTIVE OBJECTIVE_VON_NEUMANN   // Which entropy to minimize
+#define DEFAULT_MINIMIZER_RENYI_P 2                         // Order of the Renyi entropy, when that is the objective
+#define DEFAULT_MINIMIZER_CONVERGENCE CONVERGENCE_WINDOW    // When a run has converged
+
 #define DEFAULT_MINIMIZER_CHECKPOINT_INTERVAL 100           // How often to save the state of the minimizer
 #define DEFAULT_MINIMIZER_CHECKPOINT_FILE "checkpoint.dat"      // What is the default name of the checkpoint file
 
 
+// Objectives that can be minimized
+#define OBJECTIVE_VON_NEUMANN 0         // von Neumann entropy
+#define OBJECTIVE_RENYI 1               // Renyi-p entropy for integer p >= 2, i.e. the maximal output p-norm. Steps need no eigensolver.
+#define OBJECTIVE_MIN_ENTROPY 2         // Min-entropy -log of the largest output eigenvalue
+
+// Sequences of starting vectors
+#define START_SEQUENCE_RANDOM 0         // Independent uniformly random vectors
+#define START_SEQUENCE_HALTON 1         // Randomly scrambled Halton sequence mapped onto the sphere: more evenly spread
+#define START_SEQUENCE_CHANNEL 2        // Candidates built from the channel (see StartGenerator), best first, then random vectors
+#define START_COMPARISON_TOLERANCE 1e-6 // When comparing channel-informed and random starts, an attempt ending this close to the MOE reached it
+
 // These other parameters that are just baked in at compile
 #define CONVERGENCE_TOLERANCE 1e-15     // When running the algorithm, if the improvement is below this threshold value for CONVERGENCE_ITERS iterations, 
 #define CONVERGENCE_ITERS 20            // How many iterations to average over to check for convergence
+#define CONVERGENCE_WINDOW 0            // A run has converged when the entropy improved by less than CONVERGENCE_TOLERANCE per step over the last CONVERGENCE_ITERS steps
+#define CONVERGENCE_RESIDUAL 1          // A run has converged when the fixed point residual of the last step says that nothing is left to gain
+#define RESIDUAL_TOLERANCE 1e-13        // With CONVERGENCE_RESIDUAL, stop when the estimated improvement left is below this
+#define RESIDUAL_FIDELITY_TOLERANCE 1e-20 // With CONVERGENCE_RESIDUAL, also stop when a step moves the vector by less than this in infidelity
 #define RSQUARED_THRESHOLD 0.999        // What is the threshold for the R^2 value of the linear fit to be considered good enough
 
 /*
@@ -42,6 +63,129 @@ Entropy estimator parameters
 #define ENTROPY_ESTIMATOR_DEFAULT_WINDOW_SIZE 200
 
 
+/*
+Stochastic Lanczos quadrature parameters
+*/
+#define DEFAULT_SLQ_MAX_PROBES 32               // At most this many Hutchinson probes per estimate
+#define DEFAULT_SLQ_LANCZOS_STEPS 40            // Lanczos steps per probe. With d+1 steps or more, the quadrature is exact.
+#define DEFAULT_SLQ_TOLERANCE 1e-6              // Add probes until the standard error of the estimate is below this
+#define SLQ_MIN_PROBES 4                        // Probes used before the standard error is trusted
+#define SLQ_BREAKDOWN_TOLERANCE 1e-12           // Stop Lanczos when the next vector has a norm below this: the Krylov space is invariant
+
+
+/*
+Kraus subsampling parameters
+*/
+#define DEFAULT_SUBSAMPLING_BATCH 32            // Number of Kraus operators sampled per step at the start of a run
+#define DEFAULT_SUBSAMPLING_GROWTH 1.05         // The batch is multiplied by this after every subsampled step
+#define SUBSAMPLING_FIT_WINDOW 20               // Number of entropies in the exponential fit that decides when to switch to the full channel
+#define SUBSAMPLING_RSQUARED_THRESHOLD 0.99     // Switch to the full channel when the fit of the entropy decay is at least this good
+
+
+/*
+Beam search parameters
+*/
+#define DEFAULT_BEAM_WIDTH 1                    // Number of vectors kept per step. 1 is the plain fixed point iteration.
+#define DEFAULT_BEAM_BRANCHES 2                 // Top eigenvectors of the step operator tried from every vector of the beam
+#define BEAM_MERGE_FIDELITY 0.9999              // Branches with fidelity above this have merged, only the better one is kept
+
+
+/*
+Overrelaxed steps and portfolio racing parameters
+*/
+#define OVERRELAXATION_GROWTH 1.2               // The extrapolation factor is multiplied by this after every successful overrelaxed step
+#define OVERRELAXATION_MAX 8.0                  // and never goes above this
+#define PORTFOLIO_BEAM_WIDTH 3                  // Beam width of the beam search variant
+#define PORTFOLIO_POLL_INTERVAL 5               // Milliseconds between two looks at the entropy traces of the racing variants
+#define PORTFOLIO_MIN_RACE_TIME 0.05            // Seconds before any variant can be cancelled
+#define PORTFOLIO_CANCEL_RATIO 4.0              // Cancel a variant if closing its gap to the leader at its current rate would take this many times the time elapsed
+#define PORTFOLIO_TRUST_RACES 10                // Once a variant has won at least this many races on similar channels
+#define PORTFOLIO_TRUST_SHARE 0.8               // and this share of them, it runs alone
+#define PORTFOLIO_RERACE_INTERVAL 10            // but every this many runs all variants race again, to keep the statistics honest
+#define DEFAULT_PORTFOLIO_STATS_FILE "portfolio_stats.json" // Winner statistics, in SAVE_DIRECTORY unless a path is given
+
+// Status of a racing variant
+#define PORTFOLIO_RUNNING 0
+#define PORTFOLIO_CONVERGED 1           // Stopped by its own convergence checks or the iteration limit
+#define PORTFOLIO_CANCELLED 2           // Stopped by the referee
+
+
+/*
+Channel decomposition parameters
+*/
+#define DECOMPOSITION_MAX_DIMENSION 48          // Above this input dimension the decomposition is skipped: it needs an N^2 x N^2 eigendecomposition
+#define DECOMPOSITION_KERNEL_TOLERANCE 1e-10    // Eigenvalues of the commutant operator below this (relative) value are treated as zero
+#define DECOMPOSITION_EIGENVALUE_GAP 1e-6       // Relative gap between eigenvalues of the random commutant element that separates two blocks
+#define DECOMPOSITION_SUPERPOSITION_BLOCKS 4    // How many of the best blocks to pair up when trying cross-block superpositions
+#define DECOMPOSITION_SUPERPOSITION_SEEDS 4     // How many superpositions to try for every pair of blocks
+
+
+/*
+Symmetry parameters
+*/
+#define SYMMETRY_COVARIANCE_TESTS 2             // On how many random pure states to test covariance under a candidate unitary
+#define SYMMETRY_TOLERANCE 1e-9                 // Relative tolerance for covariance tests and for telling group elements apart
+#define SYMMETRY_MAX_DETECTION_DIMENSION 64     // Above this input dimension, symmetries are not detected automatically
+#define SYMMETRY_MAX_GROUP_ORDER 1024           // Stop closing the group (it is stored explicitly) beyond this order
+
+/*
+Minima registry parameters
+*/
+#define MINIMA_FIDELITY_THRESHOLD 0.9999        // Two converged vectors with fidelity above this are the same minimum
+#define BASIN_FIDELITY_THRESHOLD 0.999          // A running attempt with fidelity above this to a known minimum has entered its basin
+#define DEFAULT_DEDUP_INTERVAL 10               // How often (in iterations) running attempts are compared to the known minima
+
+
+/*
+Basin hopping parameters
+*/
+#define DEFAULT_HOPPING_STEP 1.0                // Initial norm of the perturbation added to the current (unit) vector
+#define DEFAULT_HOPPING_TEMPERATURE 0.01        // Metropolis temperature, in units of entropy
+#define DEFAULT_HOPPING_RESTART_RATIO 0.0       // Probability that an attempt starts from a fresh random vector instead
+#define DEFAULT_HOPPING_ITERATIONS 1000         // Iteration budget of a hop move, which starts close to a minimum
+#define HOPPING_RETURN_INTERVAL 10              // How often (in iterations) a hop move is compared to the minimum it started from
+#define HOPPING_TARGET_ACCEPTANCE 0.5           // The step is adapted so that about this fraction of moves is accepted
+#define HOPPING_ADAPT_INTERVAL 5                // Moves between two adaptations of the step
+#define HOPPING_STEP_FACTOR 1.25                // Factor by which the step grows or shrinks at each adaptation
+#define HOPPING_MIN_STEP 1e-3
+#define HOPPING_MAX_STEP 2.0                    // Perturbations of norm 2 and more forget most of the current vector
+
+
+/*
+Tensor power (MPS) parameters
+*/
+#define DEFAULT_TENSOR_POWER_COPIES 2           // Number of copies n of the channel in Phi^{(x)n}
+#define DEFAULT_TENSOR_POWER_BOND_DIMENSION 8   // Maximum bond dimension of the input MPS
+#define DEFAULT_TENSOR_POWER_MAX_SWEEPS 200     // How many sweeps to run before giving up, unless set with -i
+#define TENSOR_POWER_SWEEP_TOLERANCE 1e-12      // Stop sweeping when the relative improvement of the output purity is below this
+#define TENSOR_POWER_MAX_EXACT_DIMENSION 1024   // The von Neumann entropy of the best input is only computed if d^n is at most this
+
+
+/*
+Kraus operator generation parameters
+*/
+#define DEFAULT_HAAR_THREADS 0                  // Threads drawing the unitaries of kraus haar. 0 is one per core.
+#define HAAR_BATCH_BYTES (64 << 20)             // Unitaries are drawn in batches of about this size (at least one per thread), then written in order
+
+
+/*
+Random number generation. Every use of random numbers has its own domain, so that their streams never overlap.
+*/
+#define RNG_GENERATOR_NAME "philox4x32-10"
+#define RNG_DOMAIN_START_VECTOR 1               // Random starting vectors, one stream per attempt
+#define RNG_DOMAIN_SUBSAMPLING 2                // Kraus subsampling, one stream per attempt and substream per step
+#define RNG_DOMAIN_SLQ_PROBES 3                 // Probes of the stochastic Lanczos quadrature
+#define RNG_DOMAIN_SYMMETRY 4                   // Reference vector and covariance tests of ChannelSymmetry
+#define RNG_DOMAIN_DECOMPOSITION 5              // Random element of the commutant in ChannelDecomposition
+#define RNG_DOMAIN_SUPERPOSITION 6              // Relative phases of cross-block superpositions
+#define RNG_DOMAIN_HALTON_SCRAMBLE 7            // Digit scrambling of the Halton starts
+#define RNG_DOMAIN_MPS 8                        // Random MPS, one stream per attempt
+#define RNG_DOMAIN_HAAR 9                       // Haar random unitaries, one stream per Kraus operator
+#define RNG_DOMAIN_VECTOR 10                    // Vectors saved by the vector subcommand
+#define RNG_DOMAIN_HOPPING 11                   // Basin hopping perturbations and Metropolis tests, one stream per attempt
+#define RNG_DOMAIN_STIEFEL 12                   // Haar random isometries of kraus stiefel
+
+
 /*
 File save parameters
 */
@@ -49,6 +193,17 @@ File save parameters
 #define LOG_DIRECTORY "logs"            // Subfolder for saving logs
 #define VECTORS_DIRECTORY "checkpoints"     // Subfolder for saving vectors
 #define KRAUS_DIRECTORY "kraus"         // Subfolder for saving kraus operators
+#define SERIALIZER_FORMAT_VERSION "2.0" // Version of the files written by VectorSerializer. Version 1.0 files are still read.
+#define SERIALIZER_ALIGNMENT 64         // The data of version 2.0 files starts at a multiple of this many bytes, so that it can be used in place
+#define SERIALIZER_CHUNK_SIZE (4 << 20) // Bytes per chunk of the parallel checksum. Stored in every file, so it can change.
+#define LEDGER_VERSION "1.0"            // Version of the attempt ledgers written by AttemptLedger
+#define LEDGER_SYNC_RECORDS 16          // The attempt ledger is synced to disk after this many records...
+#define LEDGER_SYNC_SECONDS 30          // ... or this many seconds after the oldest unsynced one, whichever comes first
+#define COLLECTION_VERSION "1.0"        // Version of the vector collections (and their index) written by VectorCollection
+#define COLLECTION_SYNC_RECORDS 16      // A collection is synced to disk after this many vectors...
+#define COLLECTION_SYNC_SECONDS 30      // ... or this many seconds after the oldest unsynced one, whichever comes first
+#define CHANNEL_CACHE_VERSION "1.0"     // Version of the channel caches written by ChannelCache
+#define CHANNEL_CACHE_EXTENSION ".cache" // The cache of a Kraus file is that file's name followed by this
 
 /*
 LOGGING configuration. These are baked in.
@@ -9,6 +9,32 @@ class EntropyConfig {
         // Algorithm config
         int max_iterations, minimization_attempts;
         double epsilon;
+        int objective, renyi_p;
+        int start_sequence;
+        int channel_start_count;
+        bool compare_starts;
+        int convergence;
+        // Entropy estimation with stochastic Lanczos quadrature
+        bool use_slq;
+        int slq_max_probes, slq_lanczos_steps;
+        double slq_tolerance;
+        // Warm-up on a random subset of Kraus operators
+        bool use_subsampling;
+        int subsampling_batch;
+        double subsampling_growth;
+        // Beam search over the top eigenvectors of each step
+        int beam_width, beam_branches;
+        // Overrelaxed steps, and racing several variants of the step on the same start
+        bool use_overrelaxation;
+        bool use_portfolio;
+        std::string portfolio_stats_file;
+        // Stopping attempts that enter the basin of a known minimum
+        bool use_dedup;
+        int dedup_interval;
+        // Basin hopping from the last accepted minimum
+        bool use_hopping;
+        double hopping_step, hopping_temperature, hopping_restart_ratio;
+        int hopping_iterations;                 // Iteration budget of a hop move, at most max_iterations
         // Specific to prediction of final entropy of a run
         bool MOE_use_prediction;
         double MOE_prediction_tolerance;
@@ -18,6 +44,7 @@ class EntropyConfig {
         int checkpoint_interval;
         std::string checkpoint_file;
         bool use_custom_checkpoint_file;
+        std::string snapshot_file;  // Full state of the search, to resume it (see EntropyMinimizer::saveSnapshot). Empty for none.
 
 
 
@@ -31,6 +58,31 @@ class EntropyConfig {
 
         // Setters
         int setEpsilon(double eps);
+        int setObjective(int obj);
+        int setRenyiP(int p);
+        int setStartSequence(int ss);
+        int setChannelStartCount(int count);
+        int setCompareStarts(bool cs);
+        int setConvergence(int c);
+        int setSLQ(bool slq);
+        int setSLQMaxProbes(int probes);
+        int setSLQLanczosSteps(int steps);
+        int setSLQTolerance(double tol);
+        int setSubsampling(bool ss);
+        int setSubsamplingBatch(int batch);
+        int setSubsamplingGrowth(double growth);
+        int setBeamWidth(int width);
+        int setBeamBranches(int branches);
+        int setOverrelaxation(bool o);
+        int setPortfolio(bool p);
+        int setPortfolioStatsFile(const std::string& psf);
+        int setDedup(bool dd);
+        int setDedupInterval(int di);
+        int setHopping(bool h);
+        int setHoppingStep(double step);
+        int setHoppingTemperature(double temperature);
+        int setHoppingRestartRatio(double ratio);
+        int setHoppingIterations(int iterations);
         int setLogging(bool l);
         int setPrinting(bool p);
         int setLogFile(const std::string& lf);
@@ -41,6 +93,7 @@ class EntropyConfig {
         int setCheckpointInterval(int ci);
         int setCheckpointFile(const std::string& cf);
         int setCheckpointing(bool sc);
+        int setSnapshotFile(const std::string& sf);
 };
 
 #endif
\ No newline at end of file
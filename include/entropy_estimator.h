@@ -3,6 +3,7 @@
 
 #include "common_includes.h"
 #include "config.h"
+#include "vector_serializer.h"
 
 class EntropyEstimator{
     public:
@@ -18,6 +19,8 @@ class EntropyEstimator{
 
         int updateXY();
         int reset(); // This resets the entropy estimator to its initial state
+        json getSnapshot(); // The filled part of the buffers and the last fit, bit for bit
+        int restoreSnapshot(const json& snapshot); // Throws std::runtime_error if the snapshot does not fit this estimator
 
         size_t window_size, current_window_index;
         double* deltas; // This stores the delta entropies over time. It is one shorter than window size.
@@ -5,9 +5,20 @@
 #include "minimizer.h"
 #include "message_handler.h"
 #include "entropy_config.h"
+#include "channel_symmetry.h"
+#include "minima_registry.h"
+#include "generate_random_vector.h"
+#include "start_generator.h"
+#include "portfolio.h"
+#include "checkpoint_writer.h"
+#include "attempt_ledger.h"
+#include "vector_collection.h"
+#include "channel_cache.h"
+#include "rng.h"
 class EntropyMinimizer {
 public:
-    EntropyMinimizer(std::vector<std::complex<double> >* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, EntropyConfig* conf);
+    EntropyMinimizer(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, EntropyConfig* conf);
+    EntropyMinimizer(Minimizer* min, ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, EntropyConfig* conf); // Use a custom minimizer (e.g. a ProductMinimizer), which is then owned
     ~EntropyMinimizer();
 
     // Setup functions
@@ -19,12 +30,24 @@ public:
     int runMinimization();                      // Run one pass of the minimization algorithm. Requires a run to be initialized.
     int runMinimization(double target_entropy); // Run one pass of the minimization algorithm. Requires a run to be initialized.
     int findMOE();                              // This function finds the MOE of the channel
+    int findMOEDecomposed();                    // This function splits the channel into invariant blocks, finds the MOE of each, then of cross-block superpositions
+
+    // Setup of the search
+    int setSymmetry(ChannelSymmetry* sym);      // Draw random starts from a fundamental domain of this group, and recognize equivalent minima
+    int setChannelCache(ChannelCache* cache);   // Take the ranked channel-informed starts and the block decomposition from this cache, and store them there once computed
+
+    // Getters
+    double getMOE();                            // Lowest entropy found so far
+    std::vector<std::complex<double> > getMOEVector(); // Vector that achieved the lowest entropy found so far
 
     // IO functions
     int saveState();                            // Save the state of the minimizer to a file
     int saveState(std::string filename);        // Save the state of the minimizer to a file
-    int saveVector();                           // Save the vector of the minimizer to a file
-    int saveVector(std::string filename);       // Save the vector of the minimizer to a file
+    int saveVector();                           // Save the vector of the minimizer to a file, in the background (see CheckpointWriter)
+    int saveVector(std::string filename);       // Save the vector of the minimizer to a file, in the background (see CheckpointWriter)
+    int openLedger(std::string filename);       // Record every attempt of findMOE in this ledger. If it has records, findMOE continues after them. Returns 1 if it cannot be used.
+    int openCollection(std::string filename);   // Store the vectors saveState() and saveVector() save, and the final vector of every attempt of findMOE, in this collection rather than in files of their own. Returns 1 if it cannot be used.
+    int loadSnapshot(std::string filename, bool search_mode); // Continue from a snapshot instead of initializing a run: runMinimization (search_mode false) or findMOE (true) then go on exactly where it stopped. Returns 1 if it cannot be used.
     
     // Graceful termination
     void requestTerminate();             // This is used to request the termination of the minimization algorithm
@@ -38,16 +61,90 @@ public:
 private:
     std::string run_id;                         // This is the id of the run
     std::string minimizer_id;                   // This is the id of the minimizer
+    uint64_t run_count, run_stream;             // Runs initialized so far, and the random stream of the current one
     double entropy_buffer[CONVERGENCE_ITERS];   // This array keeps track of past iterations of entropy
     int current_iteration;                      // This is the index of the current iteration, also used for insertion and deletion of elements fromt eh queue
+    double previous_gain;                       // Entropy gain of the previous full step as measured by the minimizer, -1 if there was none
+    double window_entropy;                      // Exact entropy at the last window check of a run with estimated entropies, -1 if there was none
+    int window_iteration;                       // Iteration of that check
+    bool estimate_noise_reported;               // Whether the estimator has been reported to run out of probes above its tolerance
     std::ostringstream oss;                      // Useful for formatting certain strings
     MessageHandler* message_handler;            // This makes sure logs and messages are handled correctly.
     // Seralizer
     VectorSerializer* serializer;               // This is used to save the state of the vector
+    CheckpointWriter* checkpoint_writer;        // Writes the vectors saved by saveVector from its own thread, nullptr until the first one
+    int submitVector(std::string filename, std::string description, VectorCollection* target = nullptr); // Hand the current vector to the checkpoint writer, for filename or for the collection target
+    int flushCheckpoints();                     // Wait for the checkpoint and snapshot writers and sync the ledger and the collection, and report failed writes
+    json vectorMetadata();                      // What saved vectors record about the run: random stream, entropy, iteration and run id
+    VectorCollection* collection;               // Where saved vectors go, nullptr for files of their own
+    std::string collection_file;
+    int collectAttempt(int attempt, std::string outcome); // Append the final vector of the attempt that just finished to the collection
+    // Snapshots: everything the rest of the search depends on, so that a resumed search is the same, bit for bit, as one never stopped
+    CheckpointWriter* snapshot_writer;          // Writes snapshots to config->snapshot_file, nullptr until the first one. Separate from checkpoint_writer, so that neither replaces the other's files.
+    bool resume_pending;                        // A snapshot was loaded and the next runMinimization or attempt of findMOE continues from it
+    json trajectoryConfig();                    // The configuration the steps depend on, to check that a resumed search uses the same
+    AttemptLedger* ledger;                      // Finished attempts of findMOE, nullptr if they are not recorded
+    int recordAttempt(int attempt, std::string outcome, int minimum, bool accepted, double duration, bool new_MOE); // Append the attempt that just finished to the ledger
+    int replayLedger();                         // Rebuild the search from the attempts in the ledger
+    int saveSnapshot(bool search_mode, bool in_attempt); // Queue a snapshot of findMOE (search_mode) or of a single run. in_attempt: taken inside search.attempt rather than before it starts.
     // Entropy estimator
     EntropyEstimator* entropy_estimator;       // This is used to estimate the entropy of the state
+    // Symmetries and minima found
+    ChannelSymmetry* symmetry;                  // Symmetry group of the channel, nullptr if none is known. Not owned.
+    MinimaRegistry* minima_registry;            // Distinct minima found by findMOE
+    HaltonSphere* start_sequence;               // Quasi-random starting vectors, nullptr for independent random ones
+    StartGenerator* start_generator;            // Channel-informed starting vectors, ranked on the first run that needs them. nullptr until then.
+    int channel_starts_used;                    // How many runs started from one of its candidates
+    int rankChannelStarts();                    // Create start_generator and rank its pool, or take the ranked pool from the channel cache
+    ChannelCache* channel_cache;                // Derived data of the channel kept across runs, nullptr if none. Not owned.
+    bool run_channel_start;                     // Whether the current run did
 
     double MOE;
+    std::vector<std::complex<double> > MOE_vector; // Vector achieving MOE
+
+    // State of findMOE across attempts. Members rather than locals, so that snapshots can save it.
+    struct SearchState {
+        int attempt;                            // Index of the current attempt
+        bool in_attempt;                        // Whether the snapshot loaded was taken inside the current attempt
+        double start_entropy;                   // Entropy the current attempt started from
+        bool predict_stop;                      // The current run was stopped because its predicted entropy is too high
+        int basin;                              // Index of the known minimum whose basin the current attempt has entered, -1 if none
+        bool hop_move;                          // Whether the current attempt started from a perturbation of the basin hopping state
+        bool hop_return;                        // The current hop move fell back into the basin of the state it started from
+        std::vector<std::complex<double> > hop_vector; // Basin hopping state: the last accepted minimum. Empty until the first attempt has finished.
+        double hop_entropy, hop_step;
+        int hop_moves, hop_accepted, window_moves, window_accepted;
+        std::vector<double> start_entropies[2], final_entropies[2]; // Of the attempts, for channel-informed (index 1) and random (index 0) starts
+    };
+    SearchState search;
+    int resetSearch();                          // Called when findMOE starts from scratch
+    int updateMOE(double entropy);              // Update MOE (and MOE_vector) if entropy is lower. Returns 1 if a new MOE was found.
+    int exactEntropyCheck();                    // If the current entropy is an estimate, replace it with the exact one and report both. Returns 1 if it was an estimate.
+    int exactWindowCheck();                     // Window convergence check for estimated entropies: compares exact ones, every CONVERGENCE_ITERS iterations. Returns 1 to stop.
+    int reportEstimateNoise();                  // Warn, once, if the last estimate used all its probes and is still above the tolerance
+    int perturbVector(std::vector<std::complex<double> >* vector, double step, RandomStream* stream); // Add a uniformly random direction of norm step, then normalize
+
+    // Kraus subsampling
+    int kraus_batch;                            // Kraus operators sampled per step, 0 once the run uses the full channel
+    int subsampling_end;                        // Iteration at which the run switched to the full channel
+    EntropyEstimator* batch_estimator;          // Short-window fit of the entropy decay, to detect when subsampling noise no longer dominates
+    int startSubsampling();                     // Called when a run is initialized
+    int updateKrausBatch();                     // Grow the batch after a subsampled step, and switch to the full channel when it is time
+
+    // Portfolio racing
+    Portfolio* portfolio;                       // Variants of the minimization raced on the start of every run, nullptr until the first race
+    int racePortfolio();                        // Race from the current vector, and continue from the winner's result
+
+    // Beam search
+    std::vector<std::vector<std::complex<double> > > beam; // Vectors kept after the last beam step, best first. Empty until the first beam step of a run.
+    int stepBeam();                             // Branch every vector of the beam, and keep the best distinct branches. The minimizer follows the best.
+
+    // Entropy estimation
+    SLQEstimator* slq_estimator;                // Stochastic Lanczos quadrature estimator, nullptr if entropies are exact
+
+    // Channel data, kept to be able to run sub-problems on the same channel
+    ComplexView* kraus_operators;
+    int d, N, M;
 
     std::atomic<bool> terminate_requested{false};     // This is used to stop the minimization algorithm
 
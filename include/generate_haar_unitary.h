@@ -2,7 +2,26 @@
 #define GENERATE_HAAR_UNITARY_H
 
 #include "common_includes.h"
+#include "vector_serializer.h"
 
-std::vector<std::complex<double> >* generateHaarRandomUnitary(int N);
+// LAPACK workspace of the QR decomposition, sized by the first call and reused by the next ones
+struct HaarWorkspace {
+    std::vector<std::complex<double> > tau;
+    std::vector<std::complex<double> > work;
+};
+
+std::vector<std::complex<double> >* generateHaarRandomUnitary(int N, uint64_t stream_index); // Draws from stream stream_index of the Haar domain
+int generateHaarRandomUnitary(int N, uint64_t stream_index, std::vector<std::complex<double> >* out, HaarWorkspace* workspace); // Same unitary, written into out (resized to N*N), so that buffers serve many calls
+
+// The d Kraus operators U_m/sqrt(d) of a random unitary channel, appended to writer in order. U_m is drawn from stream m, so the
+// file does not depend on the number of threads (0 is one per core).
+int generateHaarChannel(int N, int d, int threads, VectorStreamWriter* writer);
+
+// Haar random isometry C^columns -> C^rows (rows >= columns), column-major with leading dimension rows: the Q of the QR decomposition
+// of a Gaussian matrix, with the diagonal of R positive. Draws from stream stream_index of the Stiefel domain.
+std::vector<std::complex<double> >* generateHaarRandomIsometry(int rows, int columns, uint64_t stream_index);
+// Random channel of the environment model: one Haar random isometry V: C^N -> C^{dN}, whose N x N blocks of rows are the d Kraus
+// operators (sum_m K_m^dagger K_m = V^dagger V = 1), appended to writer in order
+int generateStiefelChannel(int N, int d, VectorStreamWriter* writer);
 
 #endif // GENERATE_HAAR_UNITARY_H
\ No newline at end of file
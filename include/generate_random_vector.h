@@ -5,4 +5,37 @@
 
 std::vector<std::complex<double> >* generateUniformRandomVector(int N);
 
-#endif // GENERATE_RANDOM_VECTOR_H
\ No newline at end of file
+double inverseNormalCDF(double p); // Quantile function of the standard normal distribution (Acklam's rational approximation, relative error below 1.2e-9)
+
+/*
+HaltonSphere maps the Halton sequence in [0,1)^{2N} onto the unit sphere in C^N: every coordinate goes through the inverse normal CDF,
+which gives the real and imaginary parts of a Gaussian vector, and the vector is normalized. Since the Gaussian is rotation invariant,
+a uniformly distributed point of the cube gives a uniformly distributed point of the sphere, while the low discrepancy of the sequence
+spreads the first few points more evenly than independent draws.
+
+The sequence is scrambled (random linear scrambling: digit k of coordinate i goes to a_ik digit + c_ik mod its base, for random a_ik != 0
+and c_ik). Unscrambled, the first points have a single digit in the large bases, so that coordinates i/p and i/q of neighbouring primes
+are almost equal and the first starts cluster. With the scrambling, every point is exactly uniform on its own, and the scrambling is drawn
+from the seed: runs with the same seed use the same points.
+*/
+class HaltonSphere {
+public:
+    HaltonSphere(int dimension);
+    ~HaltonSphere();
+
+    int getVector(long index, std::vector<std::complex<double> >* out); // Point number index (starting at 1) of the sequence
+    int nextVector(std::vector<std::complex<double> >* out);            // The point after the last one drawn with nextVector
+    long getNextIndex();                                                // Where nextVector is, to resume the sequence later
+    int setNextIndex(long index);
+
+private:
+    int N;
+    long next_index;
+    std::vector<int> bases;                     // The first 2N primes, one per real coordinate
+    std::vector<std::vector<int> > multipliers; // Multiplier a_ik of digit k of coordinate i, nonzero
+    std::vector<std::vector<int> > offsets;     // Offset c_ik of digit k of coordinate i
+
+    double radicalInverse(long index, int coordinate); // Scrambled radical inverse of index in the base of the coordinate
+};
+
+#endif // GENERATE_RANDOM_VECTOR_H
@@ -10,5 +10,6 @@ void zgeqrfp_wrapper(int M, int N, std::vector<std::complex<double> >* A, int ld
 void zungqr_wrapper(int M, int N, int K, std::vector<std::complex<double> >* A, int lda, std::vector<std::complex<double> >* tau, std::complex<double>* work, int lwork);
 void zungqr_wrapper(int M, int N, int K, std::vector<std::complex<double> >* A, int lda, std::vector<std::complex<double> >* tau, std::vector<std::complex<double> >* work, int lwork);
 void zheev_wrapper(char jobz, char uplo, int N, std::vector<std::complex<double> >* A, int lda, std::vector<double>* w);
+void zheevr_wrapper(char uplo, int N, std::vector<std::complex<double> >* A, int lda, int il, int iu, std::vector<double>* w, std::vector<std::complex<double> >* Z, int ldz); // Eigenpairs il..iu (from 1, ascending) only, vectors in the columns of Z. A is destroyed.
 void dgesv_wrapper(int N, int NRHS, double* A, int lda, int* ipiv, double* B, int ldb);
 #endif // MATRIX_OPS_H
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef MINIMA_REGISTRY_H
+#define MINIMA_REGISTRY_H
+
+#include "common_includes.h"
+#include "config.h"
+#include "channel_symmetry.h"
+
+/*
+MinimaRegistry keeps track of the distinct minima found across minimization attempts, and of how many times each was hit.
+Two vectors are the same minimum if their fidelity |<v|w>| is above MINIMA_FIDELITY_THRESHOLD. If a symmetry group is set,
+the fidelity is maximized over the group, so equivalent minima are recognized, and minima are stored in canonical form.
+Running attempts can also be matched against the known minima with a looser threshold, to stop those that have entered a known basin.
+*/
+class MinimaRegistry {
+public:
+    MinimaRegistry();
+    ~MinimaRegistry();
+
+    int setSymmetry(ChannelSymmetry* sym);
+    int registerMinimum(const std::vector<std::complex<double> >& vector, double entropy); // Returns the index of the minimum the vector belongs to (possibly a new one)
+    int findMinimum(const std::vector<std::complex<double> >& vector);                     // Returns the index of the minimum the vector belongs to, -1 if none
+    int findMinimum(const std::vector<std::complex<double> >& vector, double threshold);   // Same, with a custom fidelity threshold
+    int recordBasinHit(int index);                                                         // An attempt was stopped in the basin of this minimum
+    int restoreMinimum(const std::vector<std::complex<double> >& vector, double entropy, int hit_count, int basin_hit_count); // Append a saved minimum as it is, without matching it
+    int reset();
+
+    // Getters
+    int getMinimaCount();
+    int getHits(int index);
+    int getBasinHits(int index);                // How many of the hits were attempts stopped early in the basin
+    double getEntropy(int index);
+    std::vector<std::complex<double> > getVector(int index);
+    double fidelity(const std::vector<std::complex<double> >& first, const std::vector<std::complex<double> >& second); // |<first|second>|, maximized over the symmetry group if one is set
+
+private:
+    std::vector<std::vector<std::complex<double> > > minima;
+    std::vector<double> entropies;
+    std::vector<int> hits;
+    std::vector<int> basin_hits;
+    ChannelSymmetry* symmetry;
+};
+
+#endif
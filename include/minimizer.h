@@ -3,29 +3,44 @@
 #define MINIMIZER_H
 
 #include "config.h"
+#include "complex_view.h"
 #include "vector_serializer.h"
 #include "entropy_estimator.h"
+#include "slq_estimator.h"
 
 class Minimizer {
 public:
-    Minimizer(std::vector<std::complex<double> >* kraus_ops,int kraus_number,int kraus_in_dimension,int kraus_out_dimension, double eps);             // Constructor declaration
-    ~Minimizer();            // Destructor declaration
+    Minimizer(ComplexView* kraus_ops,int kraus_number,int kraus_in_dimension,int kraus_out_dimension, double eps);             // Constructor declaration
+    virtual ~Minimizer();            // Destructor declaration
     // Initialization
-    int initializeVector(std::vector<std::complex<double> >* vector_pointer); // This initializes the vector to a given one. If dimensions don't match, it defaults to initializing a random vector
-    int initializeRandomVector(); // Initializes the vector for the algorithm to a random one
+    virtual int initializeVector(std::vector<std::complex<double> >* vector_pointer); // This initializes the vector to a given one. If dimensions don't match, it defaults to initializing a random vector
+    virtual int initializeRandomVector(); // Initializes the vector for the algorithm to a random one
 
     // Updaters
     int updateProjector(); // Calculates the rank one projector from the vector stored in memory
-    int calculateEntropy(); // Calculates the entropy of Phi(projector), recalculates the projector for safety
+    virtual int calculateEntropy(); // Calculates the entropy of Phi(projector), recalculates the projector for safety
+    int setObjective(int obj, int p); // Which entropy to minimize: OBJECTIVE_VON_NEUMANN, OBJECTIVE_RENYI (integer p >= 2) or OBJECTIVE_MIN_ENTROPY
+    int setEntropyEstimator(SLQEstimator* estimator); // Estimate the von Neumann entropy with stochastic Lanczos quadrature instead of diagonalizing. Not owned; nullptr to go back.
+    int calculateExactEntropy(); // Same as calculateEntropy, but never estimated
+    int calculateImageEntropy(); // Same as calculateEntropy, from the Gram matrix of the Kraus images: O(d M N + d^2 M + d^3) instead of the O(d M N^2 + M^3) of the full output
+    bool isEntropyExact(); // Whether the last entropy calculated is exact or an estimate
+    int setRandomStream(uint64_t stream); // Draw random numbers from this stream (e.g. the attempt number), so that runs are reproducible from the seed
+    int setKrausBatch(int batch); // Step with an importance-weighted random subset of this many Kraus operators. 0 (or d and above) for the full channel.
+    int setOverrelaxation(bool use); // Extrapolate every step along the direction of the plain one, see stepOverrelaxed
+    json getSnapshot(); // What the next step depends on besides the vector (entropy, extrapolation factor, random draws), bit for bit
+    int restoreSnapshot(const json& snapshot); // The vector itself is restored through getVectorState
 
     // Algorithm
-    int stepAlgorithm(); // Run one step of the algorithm: update the vector with a new, better one. In so doing, scramble both input and output matrix.
+    virtual int stepAlgorithm(); // Run one step of the algorithm: update the vector with a new, better one. In so doing, scramble both input and output matrix.
     int minimizeEntropy(); // Run a full minimization pass, until tolerance is reached
     int step(); // This both runs one step of the algorithm, and updates the entropy.
+    int branchVectors(int count, std::vector<std::complex<double> >* branches); // The top count eigenvectors of the operator of stepAlgorithm, best first, as the columns of branches. Returns how many.
+    int getStepResidual(double* residual, double* gain, double* infidelity); // How far the vector was from a fixed point before the last step, see measureResidual. Returns 1 if that step did not measure it.
 
     // Getters
     std::vector<std::complex<double> >* getState();
-    std::vector<std::complex<double> > getVector();
+    virtual std::vector<std::complex<double> > getVector();
+    std::vector<std::complex<double> >* getVectorState(); // The current vector itself, without recomputing it from the projector
     double* getEntropy();
     int getN();
     int getD();
@@ -34,21 +49,47 @@ public:
     int printVectorState();
     int printState();
 
-private:
+protected:
     // Members
     int N, M, d;
+    int objective, renyi_p;
+    int kraus_batch;
+    bool overrelax;
+    double overrelaxation; // Current extrapolation factor eta of stepOverrelaxed, 1 for the plain step
+    bool residual_valid; // Whether the last step measured the quantities below
+    double step_residual, step_gain, step_infidelity; // Relative eigen-residual of the vector, entropy gain of the linearized step, and 1 - |<v|w>|^2 for the step v -> w
+    uint64_t random_stream, random_draws; // Stream of the random draws, and how many substreams of it were used
+    std::vector<double> kraus_weights; // Squared Frobenius norms of the Kraus operators, computed on the first subsampled step
+    SLQEstimator* slq_estimator;
+    bool entropy_exact;
     double epsilon, bin_entropy, entropy_error, entropy, estimated_entropy, estimated_entropy_ub, estimated_entropy_lb;
     // Matrices and vectors
-    std::vector<std::complex<double> >* kraus_operators;
+    ComplexView* kraus_operators;
     std::vector<std::complex<double> >* vector_state;
     std::vector<std::complex<double> >* input_matrix;
     std::vector<std::complex<double> >* output_matrix; // is this one necessary?
     // Methods
+    int logOutputMatrix(); // Replaces output_matrix with its matrix logarithm
+    int objectiveOutputMatrix(); // Replaces output_matrix = Phi_e(rho) with the X such that Phi^*(X) is the gradient of the objective (up to a positive factor)
+    int outputEntropy(); // Sets entropy to the objective evaluated on output_matrix, which is left untouched
+    int krausImages(std::vector<std::complex<double> >* images); // The M x d matrix with columns K_k v, for the current vector v
+    int imagesOutputMatrix(std::vector<std::complex<double> >* images, int rank); // output_matrix = (1-e) W W^H + e/M I for the M x rank matrix W
+    int updateOutputMatrix(); // Compute Phi_e(|v><v|) into output_matrix, using that the input has rank one
+    int stepSubsampled(); // Step on a random subset of kraus_batch Kraus operators, see minimizer.cpp. Returns 1 if it could not be taken.
+    int stepRenyi(); // Eigensolver-free step for integer Renyi-p, see minimizer.cpp
+    int stepOverrelaxed(); // Plain step, then extrapolated along its direction while that does not increase the objective. Also updates the entropy.
+    int measureResidual(const std::vector<double>& eigvals); // Residual, gain and infidelity of the step, from the eigendecomposition in input_matrix. Call before the vector is replaced.
+    double gainScale(); // Converts a gain of <v|Phi^*(X)|v> into a decrease of the entropy, to first order
+    int calculateRenyiEntropy(); // Renyi-p entropy from the d x d (or M x M) Gram matrix of the Kraus images, GEMM only
+    int gramMatrix(std::vector<std::complex<double> >* images, std::vector<std::complex<double> >* gram); // W^H W (d x d) or W W^H (M x M), whichever is smaller. Returns its dimension.
+    int imagesEntropy(std::vector<std::complex<double> >* images); // Von Neumann or min-entropy of (1-e) W W^H + e/M I from the spectrum of the Gram matrix, exactly
+    bool useEntropyEstimator(); // Whether calculateEntropy should estimate rather than compute the entropy
+    int estimateEntropy(); // Stochastic Lanczos quadrature estimate of the von Neumann entropy, from the Kraus images only. Exact instead when the Gram matrix is cheaper.
     int printMatrix(std::vector<std::complex<double> >* matrix_pointer, int n, int m);
-    int applyChannel(std::vector<std::complex<double> >* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension);
-    int applyDualChannel(std::vector<std::complex<double> >* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension);
-    int applyEpsilonChannel(std::vector<std::complex<double> >* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension, double epsilon);
-    int applyDualEpsilonChannel(std::vector<std::complex<double> >* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension, double epsilon);
+    int applyChannel(ComplexView* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension);
+    int applyDualChannel(ComplexView* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension);
+    int applyEpsilonChannel(ComplexView* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension, double epsilon);
+    int applyDualEpsilonChannel(ComplexView* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension, double epsilon);
 
 };
 
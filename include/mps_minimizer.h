@@ -0,0 +1,74 @@
+#ifndef MPS_MINIMIZER_H
+#define MPS_MINIMIZER_H
+
+#include "config.h"
+#include "complex_view.h"
+#include "message_handler.h"
+#include "entropy_config.h"
+
+/*
+MPSMinimizer looks for inputs of the n-fold tensor power Phi^{(x)n} with low output entropy, among matrix product states
+    |psi> = sum A_1[i_1] A_2[i_2] ... A_n[i_n] |i_1 i_2 ... i_n>
+with bond dimension at most D. Nothing of size N^n is ever stored: all contractions go through the single-copy Kraus operators.
+
+The von Neumann entropy of Phi^{(x)n}(|psi><psi|) is not polynomial in the MPS tensors, so the sweeps minimize the Renyi-2 entropy
+-log Tr[sigma^2] instead, which is a quartic contraction over two copies of the MPS:
+    Tr[sigma^2] = <psi psi| W^{(x)n} |psi psi>,     W = sum_{a,b} K_b^H K_a (x) K_a^H K_b
+Site tensors are updated one at a time in mixed-canonical form, with the same fixed point step as in Minimizer:
+the new tensor is the top eigenvector of Phi^{(x)n*}(sigma) restricted to the site, which can only increase the purity.
+Cost per site update is O(D^6 N^2 + D^4 N^4) and one eigendecomposition of size D^2 N, so everything grows polynomially in n.
+If d^n is small enough, the exact von Neumann entropy of the best input is computed at the end from the complementary channel.
+*/
+class MPSMinimizer {
+public:
+    MPSMinimizer(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, int copies, int bond_dimension, EntropyConfig* conf);
+    ~MPSMinimizer();
+
+    // Setup
+    int initializeRandomMPS();                  // Random site tensors, brought to right-canonical form
+
+    // Algorithm
+    int sweep();                                // Update every site once from left to right and once from right to left
+    int runMinimization();                      // Sweep until the purity stops increasing. Requires initializeRandomMPS.
+    int findMOE();                              // Run several attempts from random MPS, keep the best
+
+    // Evaluation
+    int calculatePurity();                      // Tr[sigma^2] for the current MPS, by contracting both copies from the left
+    int calculateExactEntropy(std::vector<std::vector<std::complex<double> > >* mps, double* out); // von Neumann entropy of the output. Returns 1 if d^n is too large.
+
+    // Getters
+    double getPurity();
+    double getRenyi2Entropy();
+    double getMOE();                            // Lowest Renyi-2 entropy found so far
+    int getBondDimension(int cut);
+
+private:
+    int N, M, d, n, D;
+    std::vector<int> bonds;                     // bonds[s] is the dimension of the bond between sites s-1 and s. bonds[0] = bonds[n] = 1.
+    std::vector<std::vector<std::complex<double> > > sites; // Site s has entry (alpha, i, alpha') at alpha + bonds[s]*(i + N*alpha')
+    // Two-copy environments, entry (alpha1, alpha2, beta1, beta2) at alpha1 + D*(alpha2 + D*(beta1 + D*beta2)), alpha for kets and beta for bras
+    std::vector<std::vector<std::complex<double> > > left_environments;  // left_environments[s] contracts sites 0..s-1
+    std::vector<std::vector<std::complex<double> > > right_environments; // right_environments[s] contracts sites s..n-1
+
+    std::vector<std::complex<double> > gram_operators;     // K_a^H K_b (NxN) at (a*d+b)*N*N
+    std::vector<std::complex<double> > two_copy_operator;  // W above, N^2 x N^2, entry ((j1,j2),(i1,i2)) at (j1+N*j2) + N*N*(i1+N*i2)
+
+    double purity;
+    double MOE;
+    std::vector<std::vector<std::complex<double> > > MOE_sites;
+    int sweeps;
+    uint64_t random_mps_count;                  // How many random MPS were drawn, which is the stream of the next one
+
+    EntropyConfig* config;
+    MessageHandler* message_handler;
+    std::ostringstream oss;
+
+    int updateSite(int s);                      // Replace site s (the orthogonality center) with the top eigenvector of its effective operator
+    int moveCenterRight(int s);                 // QR of site s, R is absorbed into site s+1
+    int moveCenterLeft(int s);                  // LQ of site s, L is absorbed into site s-1
+    int contractLeft(const std::vector<std::complex<double> >& environment, const std::vector<std::complex<double> >& site, int Dl, int Dr, std::vector<std::complex<double> >* out);
+    int contractRight(const std::vector<std::complex<double> >& environment, const std::vector<std::complex<double> >& site, int Dl, int Dr, std::vector<std::complex<double> >* out);
+    int qrFactor(std::vector<std::complex<double> >* A, int m, int k, std::vector<std::complex<double> >* R); // A (m x k, m >= k) is replaced by Q, R is k x k
+};
+
+#endif
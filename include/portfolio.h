@@ -0,0 +1,76 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include "common_includes.h"
+#include "config.h"
+#include "complex_view.h"
+#include "entropy_config.h"
+#include "nlohmann/json.hpp"
+using json = nlohmann::json;
+
+class EntropyMinimizer;
+
+/*
+Portfolio races several variants of the minimization on the same starting vector, one thread each:
+    fixedpoint   the plain step of Minimizer::stepAlgorithm (or stepRenyi)
+    overrelaxed  the same step, extrapolated adaptively (Minimizer::stepOverrelaxed)
+    beam         beam search of width PORTFOLIO_BEAM_WIDTH (not for the Renyi objective)
+    subsampled   warm-up on a random subset of the Kraus operators (only if there are more of them than the batch)
+Each variant is a full EntropyMinimizer with its own copy of the configuration, so its steps and convergence checks are the usual ones.
+A referee looks at the entropy traces every PORTFOLIO_POLL_INTERVAL ms. A variant that would need more than PORTFOLIO_CANCEL_RATIO times
+the time elapsed so far to close its gap to the leader at its current rate is cancelled. Once a variant converges, the others are
+cancelled unless they are already below it. The winner is the converged variant with the lowest entropy, the earliest one among ties.
+
+Winners are counted per class of channels (dimensions and objective) in a JSON file. A variant that has clearly won on the class
+(PORTFOLIO_TRUST_RACES, PORTFOLIO_TRUST_SHARE) runs alone, except every PORTFOLIO_RERACE_INTERVAL runs. Several jobs may share the file:
+saving holds an exclusive lock on the file's name followed by ".lock", reads the file again, adds only the races of this instance that
+were not saved yet, and replaces the file through a temporary one, so that the counts of other jobs are kept and nobody reads half a file.
+*/
+struct PortfolioVariant {
+    std::string name;
+    EntropyConfig config;
+    EntropyMinimizer* minimizer;
+    std::vector<std::pair<double, double> > trace; // (seconds since the start of the race, entropy) after every step
+    std::atomic<int> status;                        // PORTFOLIO_RUNNING, PORTFOLIO_CONVERGED or PORTFOLIO_CANCELLED
+    double finish_time;
+};
+
+class Portfolio {
+public:
+    Portfolio(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, EntropyConfig* conf);
+    ~Portfolio();
+
+    int race(const std::vector<std::complex<double> >& start, uint64_t stream, EntropyMinimizer* owner); // Returns the index of the winner. Stops early if owner is asked to terminate.
+
+    // Winner statistics. Both return 0 on success, 1 if the file could not be read or written, and 2 if it does not parse. Saving
+    // then moves it aside (its name followed by ".corrupt") and starts it over.
+    int loadStatistics();
+    int saveStatistics();
+
+    // Getters
+    int getVariantCount();
+    std::string getName(int variant);
+    std::vector<std::complex<double> > getVector(int variant);
+    double getEntropy(int variant);
+    int getIterations(int variant);
+    std::string describe();                     // One line per variant about the last race
+
+private:
+    int N, M, d;
+    EntropyConfig* config;
+    std::vector<PortfolioVariant*> variants;
+    std::mutex trace_mutex;                     // Guards the traces, written by the workers and read by the referee
+    std::string channel_class;                  // Key of this channel in the statistics
+    json statistics;                            // {channel_class: {variant: {"races": ..., "wins": ..., "win_time": ...}}}
+    json unsaved;                               // Same layout: the races of this instance that are not in the file yet
+    int races;                                  // Races run by this instance
+    std::vector<bool> racing;                   // Which variants took part in the last race
+
+    int trustedVariant();                       // The variant that runs alone, -1 if all of them should race
+    int work(int variant, std::chrono::steady_clock::time_point start_time); // Step one variant until it converges or is cancelled
+    int referee(double elapsed);                // Cancel laggards. Returns how many variants are still running.
+    int readStatistics(json* read);             // Parse the file, see loadStatistics
+    static void addStatistics(json* into, const json& increments); // Add up the counts of two statistics
+};
+
+#endif
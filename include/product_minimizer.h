@@ -0,0 +1,45 @@
+#ifndef PRODUCT_MINIMIZER_H
+#define PRODUCT_MINIMIZER_H
+
+#include "config.h"
+#include "minimizer.h"
+
+/*
+ProductMinimizer restricts the search to product inputs v = v_1 (x) v_2 (x) ... (x) v_p, with N = n_1 n_2 ... n_p.
+The first factor is the most significant one: entry c of v is prod_j v_j[c_j], with c = sum_j c_j * (n_{j+1} ... n_p).
+
+One step updates the factors in turn (alternating minimization). Factor j is updated with the same fixed point step as in Minimizer,
+applied to the effective channel with Kraus operators K_k (v_1 (x) ... (x) I_{n_j} (x) ... (x) v_p), which are M x n_j.
+The input side of the step (dual channel and eigensolver) therefore costs O(d M^2 n_j) and O(n_j^3) instead of O(d N^3) and O(N^3).
+The output side is still M x M: the output entropy of a product input of a general channel does not factorize.
+*/
+class ProductMinimizer : public Minimizer {
+public:
+    ProductMinimizer(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, double eps, std::vector<int> factor_dims);
+    ~ProductMinimizer();
+
+    // Initialization
+    int initializeVector(std::vector<std::complex<double> >* vector_pointer) override; // The factors are the top eigenvectors of the reduced states of the given vector
+    int initializeRandomVector() override;
+
+    // Updaters
+    int calculateEntropy() override;
+
+    // Algorithm
+    int stepAlgorithm() override;
+
+    // Getters
+    std::vector<std::complex<double> > getVector() override;
+    std::vector<std::complex<double> > getFactor(int factor);
+    int getFactorCount();
+
+private:
+    std::vector<int> factor_dimensions;
+    std::vector<int> factor_strides;            // Stride of every factor's index in the index of the product vector
+    std::vector<std::vector<std::complex<double> > > factors;
+
+    int updateProductVector();                  // Recompute vector_state from the factors
+    int effectiveKraus(int factor, std::vector<std::complex<double> >* effective_kraus); // The d effective M x n_j Kraus operators of a factor
+};
+
+#endif
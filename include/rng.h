@@ -0,0 +1,50 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include "common_includes.h"
+#include "config.h"
+#include "nlohmann/json.hpp"
+using json = nlohmann::json;
+
+/*
+Reproducible random numbers. All random draws go through RandomStream, a counter-based generator (Philox4x32-10, Salmon et al. 2011):
+block i of a stream is a fixed bijective scramble of the counter (i, domain, stream, substream) under a key derived from the seed.
+Streams are therefore independent of each other and of the order in which they are used, and creating one costs nothing: every
+attempt, Kraus operator or probe set can have its own, and parallel workers reproduce a serial run exactly.
+
+The seed is set once per program with setRandomSeed (--seed). If it is not set, it is drawn from std::random_device on first use,
+and can be read back with getRandomSeed to reproduce the run. Domains (RNG_DOMAIN_* in config.h) separate unrelated uses of the same
+stream index; stream and substream are truncated to 32 bits.
+*/
+class RandomStream {
+public:
+    typedef uint64_t result_type;               // Satisfies UniformRandomBitGenerator, so <random> distributions accept it
+
+    RandomStream(uint64_t domain, uint64_t stream, uint64_t substream = 0); // Stream of the global seed
+    RandomStream(uint64_t seed, uint64_t domain, uint64_t stream, uint64_t substream);
+
+    result_type operator()();                   // 64 random bits
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    double uniform();                           // Uniform in (0,1), never 0 or 1
+    double normal();                            // Standard normal
+    int fillNormal(double* out, size_t count);  // count standard normals, with Box-Muller on whole blocks
+    int fillComplexNormal(std::complex<double>* out, size_t count); // count complex numbers with independent standard normal parts
+
+private:
+    uint32_t key[2];
+    uint32_t counter[4];                        // (block, domain, stream, substream)
+    uint32_t block[4];                          // Output of the current block
+    int position;                               // Next unused 64-bit word of the current block (0, 1, or 2 if used up)
+    bool has_spare;                             // normal() produces normals in pairs
+    double spare;
+
+    int generateBlock();                        // Scramble the counter into block, then increment it
+};
+
+int setRandomSeed(uint64_t seed);
+uint64_t getRandomSeed();
+json rngMetadata(uint64_t domain, uint64_t first_stream, uint64_t stream_count); // What to record in serialized metadata to reproduce the draws
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef SLQ_ESTIMATOR_H
+#define SLQ_ESTIMATOR_H
+
+#include "common_includes.h"
+#include "config.h"
+
+/*
+SLQEstimator estimates the von Neumann entropy Tr f(sigma), f(x) = -x log x, of an output
+    sigma = Phi_e(|v><v|) = (1-e) W W^H + e/M I,      W = [K_0 v, ..., K_{d-1} v]  (M x d)
+with stochastic Lanczos quadrature: Hutchinson's trace estimator z^H f(sigma) z over random probes z, each evaluated by Gauss quadrature
+on the Krylov space of sigma and z. Only products with W and W^H are needed, so an estimate costs O(probes * steps * M (d + steps))
+instead of the O(M^3) of a full eigendecomposition.
+
+Since sigma is the identity plus a rank-d matrix, the Krylov space of every probe has dimension at most d+1: with that many Lanczos steps,
+the quadrature is exact and the only error is Hutchinson's. Probes are added until the standard error of their mean is below the tolerance.
+The probes are drawn once and reused, so that estimates along a run change smoothly with v, as the convergence checks expect.
+
+The same rank structure gives the entropy exactly from the d x d Gram matrix W^H W, in O(d^2 M + d^3). That is cheaper than SLQ_MIN_PROBES
+probes unless d is much larger than M, so Minimizer only asks for an estimate in that case. Hutchinson's error does not shrink with M:
+for random-looking outputs it stays around 0.1 after a few dozen probes.
+*/
+class SLQEstimator {
+public:
+    SLQEstimator(int dimension, int max_probes, int lanczos_steps, double tolerance);
+    ~SLQEstimator();
+
+    double estimateEntropy(std::vector<std::complex<double> >* images, int rank, double epsilon); // images is the M x rank matrix W above
+
+    // Getters
+    double getStandardError();                  // Standard error of the last estimate, from the spread of the probes
+    int getProbesUsed();                        // How many probes the last estimate needed
+    int getLanczosSteps();
+
+private:
+    int M, max_probes, lanczos_steps;
+    double tolerance, standard_error;
+    int probes_used;
+    std::vector<std::vector<std::complex<double> > > probes; // Rademacher probes, |z|^2 = M
+
+    int applyOutput(std::vector<std::complex<double> >* images, int rank, double epsilon, const std::complex<double>* x, std::complex<double>* y); // y = sigma x
+    double quadrature(std::vector<std::complex<double> >* images, int rank, double epsilon, const std::vector<std::complex<double> >& probe); // z^H f(sigma) z
+};
+
+#endif
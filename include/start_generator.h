@@ -0,0 +1,50 @@
+#ifndef START_GENERATOR_H
+#define START_GENERATOR_H
+
+#include "common_includes.h"
+#include "config.h"
+#include "minimizer.h"
+
+/*
+StartGenerator builds starting vectors from the structure of the channel instead of drawing them at random. The candidates are
+    - the eigenvectors of Phi^*(Phi(I/N)), from the most to the least likely to be mapped onto the typical output
+    - for every output basis state |j>, the top eigenvector of Phi^*(|j><j|), i.e. the input most likely to give |j>
+    - the computational basis states, and the Fourier basis states (the uniform superposition, a product state, among them)
+The pool is ranked by one entropy evaluation per candidate, and handed out from the lowest entropy up. Candidates with fidelity above
+MINIMA_FIDELITY_THRESHOLD to a better one are dropped. Evaluations use the d x d Gram matrix of the Kraus images, and the output candidates
+the d x d matrix R R^H, so that building and ranking the pool costs O(N^3 + d N M^2 + (N+M) (d N M + d^2 (N+M) + d^3)) once per channel.
+*/
+class StartGenerator {
+public:
+    StartGenerator(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension);
+    ~StartGenerator();
+
+    int rankCandidates(Minimizer* minimizer);   // Build the pool and sort it by the entropy minimizer computes for each candidate. Returns the pool size.
+    int nextVector(std::vector<std::complex<double> >* out); // Next best candidate. Returns 1 if the pool is exhausted.
+
+    // The ranked pool, e.g. to cache it: labels and entropies in the snapshot, the candidates one after the other on their own
+    json getSnapshot();
+    std::vector<std::complex<double> > getCandidates();
+    int restoreSnapshot(const json& snapshot, const ComplexView& ranked); // Instead of rankCandidates. Returns the pool size, throws std::runtime_error if it does not fit.
+
+    // Getters
+    int getCandidateCount();
+    int getPosition();                          // Number of vectors handed out so far
+    int setPosition(int position);              // Resume handing out after position vectors, once the pool is ranked again
+    std::string getLabel();                     // What the last vector handed out is, e.g. "output |3>"
+    double getEntropy();                        // Entropy of the last vector handed out, as ranked
+
+private:
+    int N, M, d;
+    ComplexView* kraus_operators;
+    std::vector<std::vector<std::complex<double> > > candidates; // Ranked after rankCandidates, best first
+    std::vector<std::string> labels;
+    std::vector<double> entropies;
+    int next_candidate;
+
+    int addSpectralCandidates();                // Eigenvectors of Phi^*(Phi(I/N))
+    int addOutputCandidates();                  // Top eigenvectors of Phi^*(|j><j|)
+    int addBasisCandidates();                   // Computational and Fourier basis states
+};
+
+#endif
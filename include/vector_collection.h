@@ -0,0 +1,84 @@
+#ifndef VECTOR_COLLECTION_H
+#define VECTOR_COLLECTION_H
+
+#include "common_includes.h"
+#include "config.h"
+#include "vector_serializer.h"
+
+// One record of the index of a collection, as stored on disk (96 bytes, little-endian)
+struct CollectionEntry {
+    uint64_t offset;            // Of the stored file in the collection, a multiple of SERIALIZER_ALIGNMENT
+    uint64_t size;              // Bytes of the stored file
+    double entropy;             // From the metadata of the vector, NaN if it has none
+    uint64_t seed;              // Of the random number generator, and the first random stream of the run ("rng" in the metadata)
+    uint64_t stream;
+    int64_t iteration;          // -1 if the metadata has none
+    char run_id[40];            // Zero padded
+    uint64_t checksum;          // xxHash64 of the fields above, so that a torn record is recognized
+};
+
+class VectorCollection
+{
+    /*
+    FILE FORMAT of a collection, version 1.0. Many vectors in one file, each stored exactly as VectorSerializer would write it on its
+    own, so that extracting one is a copy of its bytes, and its data is read in place like that of a single file.
+
+    +------------------+
+    | Magic identifier |  ("VCOLL") 5 characters
+    +------------------+
+    | Format Version   |  (uint32 length, then "1.0")
+    +------------------+
+    | Padding          |  (zeros, up to SERIALIZER_ALIGNMENT bytes)
+    +------------------+
+    | Stored files     |  (one after the other, each at a multiple of SERIALIZER_ALIGNMENT bytes, zeros in between)
+    +------------------+
+
+    The index is a sidecar file, the collection's name followed by ".idx": magic "VINDX", the version, the size of a record (uint64)
+    and padding up to SERIALIZER_ALIGNMENT bytes, then one CollectionEntry per stored file, in order. Queries only read the index.
+    Everything in the index comes from the metadata of the stored files, so it can always be rebuilt from the collection.
+
+    A vector is appended to the collection before its record is appended to the index, and both are synced in batches (every
+    COLLECTION_SYNC_RECORDS vectors or COLLECTION_SYNC_SECONDS seconds), the collection first. Opening a collection for writing
+    repairs what a crash may have left: index records that are torn or point past the end of the collection are dropped, the last
+    batch of stored files is verified against its checksums, and stored files that the index misses are indexed if they are complete
+    and cut off otherwise. Appends are serialized across processes with an exclusive lock on the collection, so that parallel jobs
+    may share one; each process only knows the vectors it appended or found when it opened the collection.
+    */
+public:
+    VectorCollection();
+    ~VectorCollection();                        // Syncs and closes the files
+
+    // Open the collection, created if it does not exist and writable is set. Returns the number of vectors. Throws std::runtime_error.
+    int open(const std::string& filename, bool writable);
+    // Store a vector as VectorSerializer::serialize would, with its metadata. Returns its index in the collection.
+    int append(const std::string& type, const ComplexView& vec, const std::string& description, int d, int N, const json& metadata);
+    int sync();                                 // Sync what was appended so far
+    static std::string indexFilename(const std::string& filename);
+
+    // Queries
+    size_t size();
+    CollectionEntry getEntry(size_t index);
+    std::vector<size_t> top(size_t k);          // Indices of the k vectors with the lowest entropy, lowest first
+    MappedData map(size_t index, bool verify = true); // The stored file, in place (see VectorSerializer::map)
+    int extract(size_t index, const std::string& filename); // Write the stored file on its own, after checking its checksum
+
+private:
+    std::string filename;
+    int data_fd, index_fd;
+    bool writable;
+    std::vector<CollectionEntry> entries;
+    std::shared_ptr<MappedFile> mapping;        // Of the collection, mapped again when it has grown past an entry
+    VectorSerializer serializer;
+    int unsynced;                               // Vectors appended since the last sync
+    std::chrono::steady_clock::time_point first_unsynced;
+    std::mutex mutex;                           // append may be called from the checkpoint writer's thread too
+
+    int repair(uint64_t data_size);             // Read the index and bring it in line with the collection, see above
+    std::shared_ptr<MappedFile> mapUpTo(uint64_t end); // The mapping, covering at least end bytes
+    static CollectionEntry describe(uint64_t offset, uint64_t size, const json& metadata); // Index record of a stored file
+    static uint64_t entryChecksum(const CollectionEntry& entry);
+    static std::string buildHeader(const std::string& magic, uint64_t record_size);
+    void writeAt(int fd, uint64_t offset, const char* bytes, size_t size);
+};
+
+#endif
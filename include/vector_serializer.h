@@ -2,12 +2,15 @@
 #define VECTOR_SERIALIZER_H
 
 #include "common_includes.h"
+#include "config.h"
+#include "complex_view.h"
+#include "checksum.h"
 #include "nlohmann/json.hpp"
 using json = nlohmann::json;
 
 // Data structure for deserialized data. Update if metadata changes.
 struct DeserializedData {
-    std::string type;          // Metadata: type ("vector" or "kraus")
+    std::string type;          // Metadata: type ("vector", "kraus", "state" or "channel")
     std::vector<std::complex<double>> vectorData;
     int d;                     // Metadata: d
     int N;                     // Metadata: N
@@ -15,26 +18,69 @@ struct DeserializedData {
     json metadata;   // Full metadata as JSON
 };
 
+// Doubles in JSON metadata, bit for bit (NaN and infinities included), as the uint64 of their IEEE 754 representation.
+// decodeDoubles throws std::runtime_error if the array does not have count entries.
+json encodeDouble(double value);
+double decodeDouble(const json& encoded);
+json encodeDoubles(const double* values, size_t count);
+int decodeDoubles(const json& encoded, double* values, size_t count);
+
+// Read-only shared mapping of a whole file, unmapped when the last copy of the shared_ptr holding it goes
+class MappedFile {
+public:
+    MappedFile(const std::string& fileName); // Throws if the file cannot be opened or mapped
+    ~MappedFile();
+    const uint8_t* bytes() const;
+    size_t size() const;
+private:
+    void* address;
+    size_t length;
+};
+
+// Same as DeserializedData, but the vector stays in the file: view points into the mapping, which is kept alive with it.
+// The pages are shared with every other process mapping the same file, and only read from disk when first touched.
+struct MappedData {
+    std::string type;
+    std::string version;                    // Format version of the file, "1.0" or "2.0"
+    ComplexView view;
+    int d;
+    int N;
+    std::string description;
+    json metadata;
+    size_t size;                            // Bytes from the magic identifier to the end of the checksum
+    uint64_t checksum;                      // As stored in the footer: a hash of the content (a byte sum in version 1.0)
+    bool zero_copy;                         // False if the data region was not aligned for std::complex<double> and had to be copied
+    std::shared_ptr<MappedFile> mapping;
+    std::shared_ptr<std::vector<std::complex<double> > > copy; // Only used when zero_copy is false
+};
+
 class VectorSerializer
 {
     /*
-    FILE FORMAT for serialized vector or Kraus operator
+    FILE FORMAT for serialized vector or Kraus operator, version 2.0 (written)
 
     +------------------+
-    | Magic identifier |  (always "VECTR" or "KRAUS") 5 characters
+    | Magic identifier |  ("VECTR", "KRAUS", "STATE" for run snapshots, or "CHANL" for channel caches) 5 characters
     +------------------+
-    | Format Version   |  (e.g., 1.0 - Variable length string)
+    | Format Version   |  (uint32 length, then "2.0")
     +------------------+
-    | Metadata Size    |  (size in bytes of metadata)
+    | Metadata Size    |  (uint64, size in bytes of metadata)
     +------------------+
     | Metadata         |  (JSON string with metadata)
     +------------------+
-    | Vector Size      |  (number of elements in vector)
+    | Vector Size      |  (uint64, number of elements in vector)
+    +------------------+
+    | Chunk Size       |  (uint64, bytes per chunk of the checksum)
     +------------------+
-    | Vector Data      |  (binary data of vector)
+    | Padding          |  (zeros, up to a multiple of SERIALIZER_ALIGNMENT bytes from the start of the file)
     +------------------+
-    | Footer (Optional)|  (checksum)
+    | Vector Data      |  (binary data of vector, 16 bytes per element)
     +------------------+
+    | Footer           |  (uint64 checksum: xxHash64 of the metadata and the chunked hash of the data, see checksum.h)
+    +------------------+
+
+    Version 1.0 (still read) has uint32 sizes, no chunk size nor padding, and a uint32 byte sum of the metadata and the data as footer.
+    All numbers are little-endian.
 
     */
 public:
@@ -43,17 +89,56 @@ public:
     ~VectorSerializer();
 
     // Serialize the vector to a file
-    static void serialize(const std::string& type, const std::string& fileName, const std::vector<std::complex<double>>& vec, 
-                          const std::string& description, int d, int N);
+    // Extra metadata (e.g. the random seed and streams that produced the data) is added to the JSON metadata
+    static void serialize(const std::string& type, const std::string& fileName, const ComplexView& vec, 
+                          const std::string& description, int d, int N, const json& extra_metadata = json::object());
+    // Same bytes, handed to write in three pieces (header, data, checksum) instead of a file. Returns the number of bytes.
+    static uint64_t serialize(const std::string& type, const std::function<void(const char*, size_t)>& write, const ComplexView& vec,
+                              const std::string& description, int d, int N, const json& extra_metadata = json::object());
     // Deserialize the vector from a file
     DeserializedData deserialize(const std::string& fileName);
+    // Map the file instead, without copying the vector. With verify, the checksum is checked (one sequential pass over the file).
+    MappedData map(const std::string& fileName, bool verify = true);
+    // Same for a file stored at offset begin of a larger one (see VectorCollection), that ends at end at the latest. The data is aligned
+    // in memory if begin is a multiple of SERIALIZER_ALIGNMENT.
+    MappedData map(const std::shared_ptr<MappedFile>& mapping, size_t begin, size_t end, bool verify = true);
 private:
-    // Calculate checksum for a byte buffer
-    static uint32_t calculateChecksum(const std::vector<uint8_t>& buffer);
+    // Calculate checksum for a byte buffer (version 1.0)
+    static uint32_t calculateChecksum(const uint8_t* bytes, size_t size);
+    // Checksum of version 2.0 files
+    static uint64_t calculateHash(const uint8_t* metadata, size_t metadataSize, const uint8_t* data, size_t dataSize, size_t chunkSize);
+    // Everything up to the data, shared with VectorStreamWriter
+    static std::string buildMetadata(const std::string& description, int d, int N, const json& extra_metadata);
+    static std::string buildHeader(const std::string& type, const std::string& metadataStr, uint64_t vectorSize);
+    friend class VectorStreamWriter;
 
 
 };
 
 
 
+// Writes the same file as VectorSerializer::serialize, but block by block: begin writes the header, append writes a block of data
+// and hashes it, finalize writes the checksum. The vector never has to be in memory as a whole. Throws std::runtime_error like
+// VectorSerializer; a file that was begun but not finalized is removed when the writer is destroyed.
+class VectorStreamWriter
+{
+public:
+    VectorStreamWriter();
+    ~VectorStreamWriter();
+
+    // The number of elements of the vector goes in the header, so it must be known in advance
+    void begin(const std::string& type, const std::string& fileName, uint64_t vectorSize,
+               const std::string& description, int d, int N, const json& extra_metadata = json::object());
+    void append(const std::complex<double>* block, size_t size);
+    void finalize();
+private:
+    std::ofstream outFile;
+    std::string fileName;
+    ChunkedHash dataHash;
+    uint64_t metadataHash;
+    uint64_t expected;
+    uint64_t written;
+    bool open;
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "common_includes.h"
+#include "attempt_ledger.h"
+#include <fcntl.h>      // open
+#include <unistd.h>     // write, fsync, ftruncate, close
+
+AttemptLedger::AttemptLedger(){
+    fd = -1;
+    unsynced = 0;
+}
+
+AttemptLedger::~AttemptLedger(){
+    if (fd >= 0){
+        sync();
+        close(fd);
+    }
+}
+
+bool AttemptLedger::readHeader(const std::string& filename, json* header){
+    std::ifstream in_file(filename);
+    std::string line;
+    if (!in_file || !std::getline(in_file, line)){
+        return false;
+    }
+    try {
+        *header = json::parse(line);
+    } catch (const json::exception&){
+        return false;
+    }
+    return header->contains("ledger_version");
+}
+
+int AttemptLedger::open(const std::string& file, const json& new_header){
+    filename = file;
+    records.clear();
+
+    // Step 1: read what is there. Only complete lines count: a crash can only cut the last one, which is written over.
+    size_t complete = 0;
+    std::ifstream in_file(filename, std::ios::binary);
+    if (in_file){
+        std::string content((std::istreambuf_iterator<char>(in_file)), std::istreambuf_iterator<char>());
+        size_t start = 0;
+        size_t end;
+        while ((end = content.find('\n', start)) != std::string::npos){
+            json line;
+            try {
+                line = json::parse(content.substr(start, end - start));
+            } catch (const json::exception&){
+                throw std::runtime_error("Line " + std::to_string(records.size() + 1 + (start > 0)) + " of " + filename + " is corrupted.");
+            }
+            if (start == 0){
+                header = line;
+            } else {
+                records.push_back(line);
+            }
+            start = end + 1;
+        }
+        complete = start;
+    }
+    if (complete > 0){
+        if (!header.contains("ledger_version") || header.value("channel", json()) != new_header.at("channel")){
+            throw std::runtime_error(filename + " is not a ledger of this channel.");
+        }
+    } else {
+        header = new_header;
+    }
+
+    // Step 2: open for appending, after the last complete line
+    std::filesystem::path path(filename);
+    if (path.has_parent_path()){
+        std::filesystem::create_directories(path.parent_path());
+    }
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, complete) != 0 || lseek(fd, complete, SEEK_SET) < 0){
+        throw std::runtime_error("Failed to open " + filename + " for appending.");
+    }
+    if (complete == 0){
+        writeLine(header);
+        sync();
+    }
+    return records.size();
+}
+
+int AttemptLedger::append(const json& record){
+    records.push_back(record);
+    writeLine(record);
+    if (unsynced == 0){
+        first_unsynced = std::chrono::steady_clock::now();
+    }
+    unsynced += 1;
+    if (unsynced >= LEDGER_SYNC_RECORDS || std::chrono::steady_clock::now() - first_unsynced >= std::chrono::seconds(LEDGER_SYNC_SECONDS)){
+        sync();
+    }
+    return 0;
+}
+
+int AttemptLedger::sync(){
+    if (fd < 0 || unsynced == 0){
+        return 0;
+    }
+    if (fsync(fd) != 0){
+        throw std::runtime_error("Failed to sync " + filename + ".");
+    }
+    unsynced = 0;
+    return 0;
+}
+
+int AttemptLedger::writeLine(const json& line){
+    // One write per line, so that a crash cuts at most the line being written
+    std::string text = line.dump() + "\n";
+    const char* p = text.data();
+    size_t left = text.size();
+    while (left > 0){
+        ssize_t written = write(fd, p, left);
+        if (written < 0){
+            throw std::runtime_error("Failed to write to " + filename + ".");
+        }
+        p += written;
+        left -= written;
+    }
+    return 0;
+}
+
+json AttemptLedger::encodeVector(const std::vector<std::complex<double> >& vector){
+    json encoded = json::array();
+    for (const std::complex<double>& entry : vector){
+        encoded.push_back({entry.real(), entry.imag()});
+    }
+    return encoded;
+}
+
+std::vector<std::complex<double> > AttemptLedger::decodeVector(const json& encoded){
+    std::vector<std::complex<double> > vector;
+    for (const json& entry : encoded){
+        vector.push_back(std::complex<double>(entry.at(0).get<double>(), entry.at(1).get<double>()));
+    }
+    return vector;
+}
+
+const json& AttemptLedger::getHeader(){
+    return header;
+}
+
+const std::vector<json>& AttemptLedger::getRecords(){
+    return records;
+}
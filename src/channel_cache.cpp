@@ -0,0 +1,129 @@
+#include "common_includes.h"
+#include "channel_cache.h"
+#include <unistd.h>     // getpid
+#include <sys/stat.h>   // stat
+
+ChannelCache::ChannelCache(){
+    d = 0;
+    N = 0;
+    verified = nullptr;
+    sections = json::object();
+}
+
+int ChannelCache::open(const std::string& kraus_file, const MappedData& kraus){
+    // Step 1: what the sidecar must have been written for
+    if (kraus.version == "1.0"){
+        throw std::runtime_error("Files of format version 1.0 have no content hash. Run moe convert on " + kraus_file + " to cache what is derived from it.");
+    }
+    kraus_filename = kraus_file;
+    filename = kraus_file + CHANNEL_CACHE_EXTENSION;
+    d = kraus.d;
+    N = kraus.N;
+    identity = {{"checksum", kraus.checksum}, {"d", d}, {"N", N}};
+    struct stat info;
+    if (stat(kraus_filename.c_str(), &info) != 0){
+        throw std::runtime_error("Failed to read the size of " + kraus_filename + ".");
+    }
+    file_state = {{"size", uint64_t(info.st_size)}, {"mtime", int64_t(info.st_mtim.tv_sec)*1000000000 + info.st_mtim.tv_nsec}};
+    verified = nullptr;
+    sections = json::object();
+    mapped = MappedData();
+
+    // Step 2: read the sidecar. A missing or damaged one, or one of other content, is as good as none.
+    VectorSerializer serializer;
+    MappedData cached;
+    try {
+        cached = serializer.map(filename, true);
+    } catch (const std::exception&){
+        return 1;
+    }
+    const json& metadata = cached.metadata;
+    if (cached.type != "channel" || metadata.value("cache_version", "") != CHANNEL_CACHE_VERSION || metadata.value("kraus", json()) != identity
+        || !metadata.contains("sections") || !metadata["sections"].is_object()){
+        return 1;
+    }
+    sections = metadata["sections"];
+    verified = metadata.value("verified", json());
+    mapped = cached;
+    return 0;
+}
+
+bool ChannelCache::isVerified(){
+    return verified == file_state;
+}
+
+int ChannelCache::setVerified(){
+    verified = file_state;
+    return write("", json(), nullptr);
+}
+
+bool ChannelCache::getSection(const std::string& name, const json& key, json* info, ComplexView* vectors){
+    if (!sections.contains(name) || sections[name].value("key", json()) != key){
+        return false;
+    }
+    const json& section = sections[name];
+    size_t offset = section.at("offset").get<size_t>();
+    size_t count = section.at("count").get<size_t>();
+    if (offset > mapped.view.size() || count > mapped.view.size() - offset){
+        return false;
+    }
+    *info = section.at("info");
+    *vectors = ComplexView(mapped.view.data() + offset, count);
+    return true;
+}
+
+int ChannelCache::storeSection(const std::string& name, const json& key, const json& info, const ComplexView& vectors){
+    return write(name, {{"key", key}, {"info", info}}, &vectors);
+}
+
+int ChannelCache::write(const std::string& replaced, const json& new_section, const ComplexView* vectors){
+    // Step 1: the data of the sections that are kept, copied out of the old sidecar, then the new section
+    std::vector<std::complex<double> > data;
+    json written = json::object();
+    for (auto& [name, section] : sections.items()){
+        if (name == replaced){
+            continue;
+        }
+        size_t offset = section.at("offset").get<size_t>();
+        size_t count = section.at("count").get<size_t>();
+        written[name] = section;
+        written[name]["offset"] = data.size();
+        data.insert(data.end(), mapped.view.begin() + offset, mapped.view.begin() + offset + count);
+    }
+    if (vectors != nullptr){
+        written[replaced] = new_section;
+        written[replaced]["offset"] = data.size();
+        written[replaced]["count"] = vectors->size();
+        data.insert(data.end(), vectors->begin(), vectors->end());
+    }
+
+    // Step 2: write it next to the old one, then take its place. The temporary name is per process, for concurrent runs.
+    json metadata = {
+        {"cache_version", CHANNEL_CACHE_VERSION},
+        {"kraus", identity},
+        {"verified", verified},
+        {"sections", written}
+    };
+    std::string temporary = filename + "." + std::to_string(getpid()) + ".tmp";
+    MappedData fresh;
+    try {
+        VectorSerializer::serialize("channel", temporary, data, "Derived data of the channel in " + kraus_filename, d, N, metadata);
+        // Mapped before the rename: the mapping stays with this very file, even if another run replaces the sidecar right after
+        VectorSerializer serializer;
+        fresh = serializer.map(temporary, false);
+        std::filesystem::rename(temporary, filename);
+    } catch (const std::exception& e){
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored);
+        throw std::runtime_error("Failed to write the channel cache " + filename + ": " + e.what());
+    }
+
+    // Step 3: use the new sidecar. Views handed out by getSection before point into the old mapping, and are no longer valid.
+    mapped = fresh;
+    sections = written;
+    return 0;
+}
+
+std::string ChannelCache::getFilename(){
+    return filename;
+}
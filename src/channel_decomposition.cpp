@@ -0,0 +1,229 @@
+#include "common_includes.h"
+#include "channel_decomposition.h"
+#include "config.h"
+#include "matrix_operations.h"
+#include "rng.h"
+
+ChannelDecomposition::ChannelDecomposition(ComplexView* kraus_ops, int kraus_number, int kraus_dimension){
+    // Kraus operators are stored as in Minimizer: d contiguous NxN matrices in column-major order. We do not copy them.
+    kraus_operators = kraus_ops;
+    d = kraus_number;
+    N = kraus_dimension;
+
+    // Until decompose() is called, the channel is treated as a single block in the computational basis
+    basis = new std::vector<std::complex<double> >(N*N, std::complex<double>(0.0f,0.0f));
+    for (int i=0; i<N; i++){
+        basis->at(i*N+i) = std::complex<double>(1.0f,0.0f);
+    }
+    block_dimensions = std::vector<int>(1, N);
+    block_offsets = std::vector<int>(1, 0);
+    commutant_dimension = 1;
+}
+
+int ChannelDecomposition::buildCommutantOperator(std::vector<std::complex<double> >* L){
+    // With vec(X) stacking columns (entry (i,j) at j*N+i), ad_K = I (x) K - K^T (x) I. Expanding the sum of the two Gram operators gives
+    //     L = I (x) P + P^T (x) I - 2 sum_k ( K_k^T (x) K_k^H + conj(K_k) (x) K_k ),     P = sum_k K_k^H K_k + K_k K_k^H
+    // so that entry ((j*N+i), (jj*N+ii)) reads
+    //     delta_{j,jj} P[i,ii] + P[jj,j] delta_{i,ii} - 2 sum_k ( K_k[jj,j] conj(K_k[ii,i]) + conj(K_k[j,jj]) K_k[i,ii] )
+    int NN = N*N;
+
+    // Step 1: compute P
+    std::vector<std::complex<double> > P(NN, std::complex<double>(0.0f,0.0f));
+    std::complex<double> one(1.0f,0.0f);
+    for (int k=0; k<d; k++){
+        const std::complex<double>* kraus_pointer = &(kraus_operators->at(k*NN));
+        // P += K^H K
+        cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, N, N, N, &one,
+            reinterpret_cast<const lapack_complex_t*>(kraus_pointer), N,
+            reinterpret_cast<const lapack_complex_t*>(kraus_pointer), N,
+            &one, reinterpret_cast<lapack_complex_t*>(P.data()), N);
+        // P += K K^H
+        cblas_zgemm(CblasColMajor, CblasNoTrans, CblasConjTrans, N, N, N, &one,
+            reinterpret_cast<const lapack_complex_t*>(kraus_pointer), N,
+            reinterpret_cast<const lapack_complex_t*>(kraus_pointer), N,
+            &one, reinterpret_cast<lapack_complex_t*>(P.data()), N);
+    }
+
+    // Step 2: fill in the identity terms
+    std::fill(L->begin(), L->end(), std::complex<double>(0.0f,0.0f));
+    for (int j=0; j<N; j++){
+        for (int i=0; i<N; i++){
+            for (int ii=0; ii<N; ii++){
+                // delta_{j,jj} P[i,ii]
+                L->at(size_t(j*N+ii)*NN + (j*N+i)) += P.at(ii*N+i);
+            }
+            for (int jj=0; jj<N; jj++){
+                // P[jj,j] delta_{i,ii}
+                L->at(size_t(jj*N+i)*NN + (j*N+i)) += P.at(j*N+jj);
+            }
+        }
+    }
+
+    // Step 3: subtract the cross terms, one Kraus operator at a time. This is O(d N^4).
+    for (int k=0; k<d; k++){
+        const std::complex<double>* K = &(kraus_operators->at(k*NN));
+        for (int jj=0; jj<N; jj++){
+            for (int ii=0; ii<N; ii++){
+                // Column (jj*N+ii) of L
+                std::complex<double>* column = &(L->at(size_t(jj*N+ii)*NN));
+                for (int j=0; j<N; j++){
+                    std::complex<double> a = K[j*N+jj];             // K[jj,j]
+                    std::complex<double> b = std::conj(K[jj*N+j]);  // conj(K[j,jj])
+                    for (int i=0; i<N; i++){
+                        column[j*N+i] -= 2.0*(a*std::conj(K[i*N+ii]) + b*K[ii*N+i]);
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int ChannelDecomposition::decompose(){
+    // Step 0: the commutant eigenproblem is N^2 x N^2. Give up on large channels.
+    if (N > DECOMPOSITION_MAX_DIMENSION){
+        return getBlockCount();
+    }
+    int NN = N*N;
+
+    // Step 1: build L and diagonalize it. Its kernel is the commutant.
+    std::vector<std::complex<double> >* L = new std::vector<std::complex<double> >(size_t(NN)*NN);
+    buildCommutantOperator(L);
+    std::vector<double> eigvals(NN);
+    zheev_wrapper('V', 'U', NN, L, NN, &eigvals);
+
+    // Step 2: count the kernel vectors. Eigenvalues are in ascending order, relative threshold against the largest one.
+    double scale = std::max(1.0, std::abs(eigvals.at(NN-1)));
+    commutant_dimension = 0;
+    while (commutant_dimension < NN && eigvals.at(commutant_dimension) < DECOMPOSITION_KERNEL_TOLERANCE*scale){
+        commutant_dimension++;
+    }
+    // The identity is always in the commutant. If it is all there is, the channel is irreducible.
+    if (commutant_dimension <= 1){
+        delete L;
+        return getBlockCount();
+    }
+
+    // Step 3: build a random Hermitian element of the commutant. The commutant is closed under ^H, so the Hermitian part of a random element is still in it.
+    RandomStream stream(RNG_DOMAIN_DECOMPOSITION, 0);
+    std::vector<std::complex<double> > X(NN, std::complex<double>(0.0f,0.0f));
+    for (int c=0; c<commutant_dimension; c++){
+        double weight = stream.normal();
+        for (int i=0; i<NN; i++){
+            X.at(i) += weight*L->at(size_t(c)*NN+i);
+        }
+    }
+    delete L;
+    std::vector<std::complex<double> >* H = new std::vector<std::complex<double> >(NN);
+    for (int j=0; j<N; j++){
+        for (int i=0; i<N; i++){
+            H->at(j*N+i) = 0.5*(X.at(j*N+i) + std::conj(X.at(i*N+j)));
+        }
+    }
+
+    // Step 4: its eigenspaces are the (minimal) invariant subspaces. Group eigenvalues that coincide up to the gap tolerance.
+    std::vector<double> block_eigvals(N);
+    zheev_wrapper('V', 'U', N, H, N, &block_eigvals);
+    double spread = std::max(std::abs(block_eigvals.at(N-1)-block_eigvals.at(0)), 1e-300);
+    block_dimensions.clear();
+    block_offsets.clear();
+    block_offsets.push_back(0);
+    block_dimensions.push_back(1);
+    for (int i=1; i<N; i++){
+        if ((block_eigvals.at(i)-block_eigvals.at(i-1))/spread > DECOMPOSITION_EIGENVALUE_GAP){
+            block_offsets.push_back(i);
+            block_dimensions.push_back(1);
+        } else {
+            block_dimensions.back() += 1;
+        }
+    }
+    // The eigenvectors are the new basis
+    *basis = *H;
+    delete H;
+
+    return getBlockCount();
+}
+
+int ChannelDecomposition::getBlockCount(){
+    return block_dimensions.size();
+}
+
+int ChannelDecomposition::getBlockDimension(int block){
+    return block_dimensions.at(block);
+}
+
+std::vector<std::complex<double> >* ChannelDecomposition::getBlockKraus(int block){
+    int n = block_dimensions.at(block);
+    std::complex<double>* Q = &(basis->at(block_offsets.at(block)*N)); // First column of the block, N x n
+    std::vector<std::complex<double> >* block_kraus = new std::vector<std::complex<double> >(d*n*n);
+    std::vector<std::complex<double> > tmp(N*n);
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    for (int k=0; k<d; k++){
+        // Step 1: tmp = K_k Q (N x n)
+        cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, n, N, &one,
+            reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*N))), N,
+            reinterpret_cast<lapack_complex_t*>(Q), N,
+            &zero, reinterpret_cast<lapack_complex_t*>(tmp.data()), N);
+        // Step 2: Q^H tmp (n x n). Since the block is invariant, nothing is lost in the projection.
+        cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, n, n, N, &one,
+            reinterpret_cast<lapack_complex_t*>(Q), N,
+            reinterpret_cast<lapack_complex_t*>(tmp.data()), N,
+            &zero, reinterpret_cast<lapack_complex_t*>(&(block_kraus->at(k*n*n))), n);
+    }
+    return block_kraus;
+}
+
+std::vector<std::complex<double> > ChannelDecomposition::embedVector(int block, const std::vector<std::complex<double> >& block_vector){
+    int n = block_dimensions.at(block);
+    std::vector<std::complex<double> > out(N, std::complex<double>(0.0f,0.0f));
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    cblas_zgemv(CblasColMajor, CblasNoTrans, N, n, &one,
+        reinterpret_cast<const lapack_complex_t*>(&(basis->at(block_offsets.at(block)*N))), N,
+        reinterpret_cast<const lapack_complex_t*>(block_vector.data()), 1,
+        &zero, reinterpret_cast<lapack_complex_t*>(out.data()), 1);
+    return out;
+}
+
+json ChannelDecomposition::getSnapshot(){
+    return {
+        {"block_dimensions", block_dimensions},
+        {"commutant_dimension", commutant_dimension}
+    };
+}
+
+const std::vector<std::complex<double> >& ChannelDecomposition::getBasis(){
+    return *basis;
+}
+
+int ChannelDecomposition::restoreSnapshot(const json& snapshot, const ComplexView& new_basis){
+    std::vector<int> dimensions = snapshot.at("block_dimensions").get<std::vector<int> >();
+    if (new_basis.size() != size_t(N)*N || dimensions.empty() || std::accumulate(dimensions.begin(), dimensions.end(), 0) != N){
+        throw std::runtime_error("Block decomposition does not fit the channel.");
+    }
+    basis->assign(new_basis.begin(), new_basis.end());
+    block_dimensions = dimensions;
+    block_offsets.clear();
+    int offset = 0;
+    for (int dimension : block_dimensions){
+        block_offsets.push_back(offset);
+        offset += dimension;
+    }
+    commutant_dimension = snapshot.at("commutant_dimension").get<int>();
+    return getBlockCount();
+}
+
+std::string ChannelDecomposition::describe(){
+    std::ostringstream oss;
+    oss << getBlockCount() << " block(s) of dimension";
+    for (int b=0; b<getBlockCount(); b++){
+        oss << (b == 0 ? " " : " + ") << block_dimensions.at(b);
+    }
+    oss << " (commutant dimension " << commutant_dimension << ")";
+    return oss.str();
+}
+
+ChannelDecomposition::~ChannelDecomposition(){
+    delete basis;
+}
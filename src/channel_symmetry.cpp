@@ -0,0 +1,276 @@
+#include "common_includes.h"
+#include "channel_symmetry.h"
+#include "config.h"
+#include "rng.h"
+
+ChannelSymmetry::ChannelSymmetry(ComplexView* kraus_ops, int kraus_number, int kraus_dimension){
+    // Kraus operators are stored as in Minimizer: d contiguous NxN matrices in column-major order. We do not copy them.
+    kraus_operators = kraus_ops;
+    d = kraus_number;
+    N = kraus_dimension;
+
+    // Step 1: draw the reference vector. Any generic vector will do.
+    RandomStream stream(RNG_DOMAIN_SYMMETRY, 0);
+    reference = std::vector<std::complex<double> >(N);
+    stream.fillComplexNormal(reference.data(), N);
+    double norm = 0.0f;
+    for (int i=0; i<N; i++){
+        norm += std::norm(reference.at(i));
+    }
+    for (int i=0; i<N; i++){
+        reference.at(i) /= std::sqrt(norm);
+    }
+
+    // Step 2: the trivial group
+    std::vector<std::complex<double> > identity(N*N, std::complex<double>(0.0f,0.0f));
+    for (int i=0; i<N; i++){
+        identity.at(i*N+i) = std::complex<double>(1.0f,0.0f);
+    }
+    group.push_back(identity);
+    reference_images.push_back(reference);
+}
+
+bool ChannelSymmetry::isCovariant(const std::vector<std::complex<double> >& unitary){
+    // Phi(U rho U^H) - V Phi(rho) V^H is linear in rho and pure states span all matrices, so unless the channel is covariant
+    // it is nonzero on a random pure state with probability one. For rho = |v><v| both sides are sums of d rank one terms:
+    //     sum_k (K_k U v)(K_k U v)^H     and     sum_k (V K_k v)(V K_k v)^H
+    // The same test inputs are used for every candidate, so that detection does not depend on the order of the candidates.
+    RandomStream stream(RNG_DOMAIN_SYMMETRY, 1);
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+
+    std::vector<std::complex<double> > conj_unitary(N*N);
+    for (int i=0; i<N*N; i++){
+        conj_unitary.at(i) = std::conj(unitary.at(i));
+    }
+
+    bool covariant_same = true;         // V = U
+    bool covariant_conjugate = true;    // V = conj(U)
+    std::vector<std::complex<double> > v(N), u(N), w(N), tmp(N);
+    std::vector<std::complex<double> > lhs(N*N), rhs_same(N*N), rhs_conjugate(N*N);
+    for (int t=0; t<SYMMETRY_COVARIANCE_TESTS; t++){
+        // Step 1: random input and its image under U
+        stream.fillComplexNormal(v.data(), N);
+        cblas_zgemv(CblasColMajor, CblasNoTrans, N, N, &one, reinterpret_cast<const lapack_complex_t*>(unitary.data()), N,
+            reinterpret_cast<lapack_complex_t*>(v.data()), 1, &zero, reinterpret_cast<lapack_complex_t*>(u.data()), 1);
+
+        // Step 2: accumulate both sides
+        std::fill(lhs.begin(), lhs.end(), zero);
+        std::fill(rhs_same.begin(), rhs_same.end(), zero);
+        std::fill(rhs_conjugate.begin(), rhs_conjugate.end(), zero);
+        for (int k=0; k<d; k++){
+            const lapack_complex_t* kraus_pointer = reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*N)));
+            // K_k U v
+            cblas_zgemv(CblasColMajor, CblasNoTrans, N, N, &one, kraus_pointer, N, reinterpret_cast<lapack_complex_t*>(u.data()), 1, &zero, reinterpret_cast<lapack_complex_t*>(w.data()), 1);
+            for (int j=0; j<N; j++){
+                for (int i=0; i<N; i++){
+                    lhs.at(j*N+i) += w.at(i)*std::conj(w.at(j));
+                }
+            }
+            // K_k v, then V K_k v for both candidates
+            cblas_zgemv(CblasColMajor, CblasNoTrans, N, N, &one, kraus_pointer, N, reinterpret_cast<lapack_complex_t*>(v.data()), 1, &zero, reinterpret_cast<lapack_complex_t*>(tmp.data()), 1);
+            cblas_zgemv(CblasColMajor, CblasNoTrans, N, N, &one, reinterpret_cast<const lapack_complex_t*>(unitary.data()), N, reinterpret_cast<lapack_complex_t*>(tmp.data()), 1, &zero, reinterpret_cast<lapack_complex_t*>(w.data()), 1);
+            for (int j=0; j<N; j++){
+                for (int i=0; i<N; i++){
+                    rhs_same.at(j*N+i) += w.at(i)*std::conj(w.at(j));
+                }
+            }
+            cblas_zgemv(CblasColMajor, CblasNoTrans, N, N, &one, reinterpret_cast<const lapack_complex_t*>(conj_unitary.data()), N, reinterpret_cast<lapack_complex_t*>(tmp.data()), 1, &zero, reinterpret_cast<lapack_complex_t*>(w.data()), 1);
+            for (int j=0; j<N; j++){
+                for (int i=0; i<N; i++){
+                    rhs_conjugate.at(j*N+i) += w.at(i)*std::conj(w.at(j));
+                }
+            }
+        }
+
+        // Step 3: compare in Frobenius norm, relative to the size of the output
+        double norm = 0.0f, diff_same = 0.0f, diff_conjugate = 0.0f;
+        for (int i=0; i<N*N; i++){
+            norm += std::norm(lhs.at(i));
+            diff_same += std::norm(lhs.at(i)-rhs_same.at(i));
+            diff_conjugate += std::norm(lhs.at(i)-rhs_conjugate.at(i));
+        }
+        covariant_same = covariant_same && std::sqrt(diff_same) <= SYMMETRY_TOLERANCE*std::sqrt(norm);
+        covariant_conjugate = covariant_conjugate && std::sqrt(diff_conjugate) <= SYMMETRY_TOLERANCE*std::sqrt(norm);
+    }
+    return covariant_same || covariant_conjugate;
+}
+
+int ChannelSymmetry::addGenerator(const std::vector<std::complex<double> >& unitary){
+    // Step 1: check the size
+    if (unitary.size() != size_t(N)*N){
+        return 1;
+    }
+    // Step 2: skip operators that are already in the group
+    if (inGroup(unitary)){
+        return 1;
+    }
+    // Step 3: keep it only if the channel is covariant under it
+    if (!isCovariant(unitary)){
+        return 1;
+    }
+    generators.push_back(unitary);
+    return 0;
+}
+
+int ChannelSymmetry::detectGenerators(){
+    // The Weyl-Heisenberg operators X^a Z^b act as X^a Z^b |j> = omega^(b*j) |j+a>. They cover the usual covariant families
+    // (dephasing, depolarizing, Pauli and Weyl-covariant channels). Testing each costs O(d N^2), so only do it for moderate N.
+    if (N > SYMMETRY_MAX_DETECTION_DIMENSION){
+        return 0;
+    }
+    int accepted = 0;
+    for (int a=0; a<N; a++){
+        for (int b=0; b<N; b++){
+            if (a == 0 && b == 0){
+                continue;
+            }
+            std::vector<std::complex<double> > weyl(N*N, std::complex<double>(0.0f,0.0f));
+            for (int j=0; j<N; j++){
+                weyl.at(j*N + (j+a)%N) = std::polar(1.0, 2*M_PI*b*j/N);
+            }
+            if (addGenerator(weyl) == 0){
+                // Close the group right away, so that the remaining candidates it already contains are skipped
+                generateGroup();
+                accepted++;
+            }
+        }
+    }
+    return accepted;
+}
+
+std::vector<std::complex<double> > ChannelSymmetry::getGenerators(){
+    std::vector<std::complex<double> > all;
+    for (const std::vector<std::complex<double> >& generator : generators){
+        all.insert(all.end(), generator.begin(), generator.end());
+    }
+    return all;
+}
+
+int ChannelSymmetry::restoreGenerators(const ComplexView& unitaries){
+    size_t NN = size_t(N)*N;
+    if (unitaries.size() % NN != 0){
+        throw std::runtime_error("Symmetry generators do not have the dimension of the channel.");
+    }
+    for (size_t offset = 0; offset < unitaries.size(); offset += NN){
+        generators.push_back(std::vector<std::complex<double> >(unitaries.begin() + offset, unitaries.begin() + offset + NN));
+    }
+    return unitaries.size()/NN;
+}
+
+int ChannelSymmetry::generateGroup(){
+    // Breadth first closure of the generators, elements told apart by inGroup
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    group.resize(1);
+    reference_images.resize(1);
+    std::vector<std::complex<double> > product(N*N);
+    for (int g=0; g<group.size() && group.size() < SYMMETRY_MAX_GROUP_ORDER; g++){
+        for (int s=0; s<generators.size() && group.size() < SYMMETRY_MAX_GROUP_ORDER; s++){
+            // New candidate s*g
+            cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, &one,
+                reinterpret_cast<lapack_complex_t*>(generators.at(s).data()), N,
+                reinterpret_cast<lapack_complex_t*>(group.at(g).data()), N,
+                &zero, reinterpret_cast<lapack_complex_t*>(product.data()), N);
+            if (!inGroup(product)){
+                group.push_back(product);
+                reference_images.push_back(applyToReference(product));
+            }
+        }
+    }
+    return getGroupOrder();
+}
+
+std::vector<std::complex<double> > ChannelSymmetry::applyToReference(const std::vector<std::complex<double> >& unitary){
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    std::vector<std::complex<double> > image(N);
+    cblas_zgemv(CblasColMajor, CblasNoTrans, N, N, &one, reinterpret_cast<const lapack_complex_t*>(unitary.data()), N,
+        reinterpret_cast<lapack_complex_t*>(reference.data()), 1, &zero, reinterpret_cast<lapack_complex_t*>(image.data()), 1);
+    return image;
+}
+
+bool ChannelSymmetry::inGroup(const std::vector<std::complex<double> >& unitary){
+    // Group elements are told apart by where they send the reference vector: for a generic reference vector,
+    // U r and U' r are the same ray only if U and U' agree up to a phase. This is O(N) per element instead of O(N^2).
+    std::vector<std::complex<double> > image = applyToReference(unitary);
+    for (int h=0; h<reference_images.size(); h++){
+        std::complex<double> overlap(0.0f,0.0f);
+        for (int i=0; i<N; i++){
+            overlap += std::conj(reference_images.at(h).at(i))*image.at(i);
+        }
+        if (std::abs(overlap) > 1-SYMMETRY_TOLERANCE){
+            return true;
+        }
+    }
+    return false;
+}
+
+int ChannelSymmetry::toFundamentalDomain(std::vector<std::complex<double> >* vector){
+    // Step 1: pick the group element maximizing |<r|U v>|
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    std::vector<std::complex<double> > image(N), best_image(*vector);
+    int best = 0;
+    double best_overlap = -1.0f;
+    for (int g=0; g<group.size(); g++){
+        cblas_zgemv(CblasColMajor, CblasNoTrans, N, N, &one, reinterpret_cast<lapack_complex_t*>(group.at(g).data()), N,
+            reinterpret_cast<lapack_complex_t*>(vector->data()), 1, &zero, reinterpret_cast<lapack_complex_t*>(image.data()), 1);
+        std::complex<double> overlap(0.0f,0.0f);
+        for (int i=0; i<N; i++){
+            overlap += std::conj(reference.at(i))*image.at(i);
+        }
+        if (std::abs(overlap) > best_overlap){
+            best_overlap = std::abs(overlap);
+            best = g;
+            best_image = image;
+        }
+    }
+    // Step 2: replace the vector with its representative
+    *vector = best_image;
+    return best;
+}
+
+int ChannelSymmetry::canonicalize(std::vector<std::complex<double> >* vector){
+    int g = toFundamentalDomain(vector);
+    // Fix the global phase so that <r|v> is real and positive
+    std::complex<double> overlap(0.0f,0.0f);
+    for (int i=0; i<N; i++){
+        overlap += std::conj(reference.at(i))*vector->at(i);
+    }
+    if (std::abs(overlap) > 0){
+        std::complex<double> phase = std::conj(overlap)/std::abs(overlap);
+        for (int i=0; i<N; i++){
+            vector->at(i) *= phase;
+        }
+    }
+    return g;
+}
+
+double ChannelSymmetry::orbitFidelity(const std::vector<std::complex<double> >& first, const std::vector<std::complex<double> >& second){
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    std::vector<std::complex<double> > image(N);
+    double best = 0.0f;
+    for (int g=0; g<group.size(); g++){
+        cblas_zgemv(CblasColMajor, CblasNoTrans, N, N, &one, reinterpret_cast<lapack_complex_t*>(group.at(g).data()), N,
+            reinterpret_cast<const lapack_complex_t*>(second.data()), 1, &zero, reinterpret_cast<lapack_complex_t*>(image.data()), 1);
+        std::complex<double> overlap(0.0f,0.0f);
+        for (int i=0; i<N; i++){
+            overlap += std::conj(first.at(i))*image.at(i);
+        }
+        best = std::max(best, std::abs(overlap));
+    }
+    return best;
+}
+
+int ChannelSymmetry::getGroupOrder(){
+    return group.size();
+}
+
+int ChannelSymmetry::getGeneratorCount(){
+    return generators.size();
+}
+
+ChannelSymmetry::~ChannelSymmetry(){
+}
@@ -0,0 +1,125 @@
+#include "common_includes.h"
+#include "checkpoint_writer.h"
+#include <fcntl.h>      // open
+#include <unistd.h>     // fsync, close
+
+CheckpointWriter::CheckpointWriter(){
+    has_pending = false;
+    busy = false;
+    stopping = false;
+    written = 0;
+    coalesced = 0;
+    thread = std::thread(&CheckpointWriter::work, this);
+}
+
+CheckpointWriter::~CheckpointWriter(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+int CheckpointWriter::submit(const std::string& type, const std::vector<std::complex<double> >& vec, const std::string& filename, const std::string& description, int d, int N, const json& metadata, VectorCollection* collection){
+    int replaced;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // The buffer keeps its capacity from earlier vectors, so this is a plain copy
+        replaced = has_pending;
+        coalesced += replaced;
+        pending.type = type;
+        pending.data.assign(vec.begin(), vec.end());
+        pending.filename = filename;
+        pending.description = description;
+        pending.d = d;
+        pending.N = N;
+        pending.metadata = metadata;
+        pending.collection = collection;
+        has_pending = true;
+    }
+    wake.notify_one();
+    return replaced;
+}
+
+int CheckpointWriter::flush(){
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]{ return !has_pending && !busy; });
+    return 0;
+}
+
+std::vector<std::string> CheckpointWriter::takeErrors(){
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> out;
+    out.swap(errors);
+    return out;
+}
+
+int CheckpointWriter::getWritten(){
+    std::lock_guard<std::mutex> lock(mutex);
+    return written;
+}
+
+int CheckpointWriter::getCoalesced(){
+    std::lock_guard<std::mutex> lock(mutex);
+    return coalesced;
+}
+
+int CheckpointWriter::work(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true){
+        // Step 1: wait for a vector, or for the end. What is pending is still written before stopping.
+        wake.wait(lock, [this]{ return has_pending || stopping; });
+        if (!has_pending){
+            return 0;
+        }
+        std::swap(pending, writing);
+        has_pending = false;
+        busy = true;
+
+        // Step 2: write it without holding the lock, so that submit never waits for the disk
+        lock.unlock();
+        std::string error;
+        try {
+            if (writing.collection != nullptr){
+                writing.collection->append(writing.type, writing.data, writing.description, writing.d, writing.N, writing.metadata);
+            } else {
+                writeAtomically(writing);
+            }
+        } catch (const std::exception& e){
+            error = "Checkpoint " + writing.filename + " could not be written: " + e.what();
+        }
+        lock.lock();
+        if (error.empty()){
+            written += 1;
+        } else {
+            errors.push_back(error);
+        }
+        busy = false;
+        idle.notify_all();
+    }
+}
+
+int CheckpointWriter::writeAtomically(const Job& job){
+    // Step 1: serialize to a temporary file, and make sure its content is on disk before it takes the place of the old one
+    std::string tmp_filename = job.filename + ".tmp";
+    VectorSerializer::serialize(job.type, tmp_filename, job.data, job.description, job.d, job.N, job.metadata);
+    int fd = open(tmp_filename.c_str(), O_RDONLY);
+    if (fd < 0 || fsync(fd) != 0){
+        if (fd >= 0){
+            close(fd);
+        }
+        throw std::runtime_error("Failed to sync " + tmp_filename + ".");
+    }
+    close(fd);
+
+    // Step 2: rename, then sync the directory so that the rename itself survives a crash
+    std::filesystem::rename(tmp_filename, job.filename);
+    std::filesystem::path directory = std::filesystem::path(job.filename).parent_path();
+    int dir_fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0){
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include "common_includes.h"
+#include "checksum.h"
+#include <cstring>
+
+namespace {
+
+const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotateLeft(uint64_t x, int r){
+    return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian reads, whatever the alignment
+inline uint64_t read64(const uint8_t* p){
+    uint64_t x;
+    std::memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+inline uint32_t read32(const uint8_t* p){
+    uint32_t x;
+    std::memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+inline uint64_t accumulate(uint64_t accumulator, uint64_t input){
+    accumulator += input*PRIME2;
+    return rotateLeft(accumulator, 31)*PRIME1;
+}
+
+inline uint64_t mergeRound(uint64_t hash, uint64_t accumulator){
+    hash ^= accumulate(0, accumulator);
+    return hash*PRIME1 + PRIME4;
+}
+
+// Step 2 and 3 of the hash: the last bytes, less than a stripe, and the avalanche
+uint64_t finish(uint64_t hash, const uint8_t* p, const uint8_t* end){
+    for (; p + 8 <= end; p += 8){
+        hash ^= accumulate(0, read64(p));
+        hash = rotateLeft(hash, 27)*PRIME1 + PRIME4;
+    }
+    if (p + 4 <= end){
+        hash ^= uint64_t(read32(p))*PRIME1;
+        hash = rotateLeft(hash, 23)*PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++){
+        hash ^= (*p)*PRIME5;
+        hash = rotateLeft(hash, 11)*PRIME1;
+    }
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t mergeAccumulators(const uint64_t* v){
+    uint64_t hash = rotateLeft(v[0], 1) + rotateLeft(v[1], 7) + rotateLeft(v[2], 12) + rotateLeft(v[3], 18);
+    for (int i=0; i<4; i++){
+        hash = mergeRound(hash, v[i]);
+    }
+    return hash;
+}
+
+}
+
+uint64_t xxHash64(const uint8_t* data, size_t length, uint64_t seed){
+    const uint8_t* p = data;
+    const uint8_t* end = data + length;
+    uint64_t hash;
+
+    // Step 1: stripes of 32 bytes into four accumulators
+    if (length >= 32){
+        uint64_t v[4] = {seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1};
+        const uint8_t* limit = end - 32;
+        do {
+            v[0] = accumulate(v[0], read64(p));
+            v[1] = accumulate(v[1], read64(p+8));
+            v[2] = accumulate(v[2], read64(p+16));
+            v[3] = accumulate(v[3], read64(p+24));
+            p += 32;
+        } while (p <= limit);
+        hash = mergeAccumulators(v);
+    } else {
+        hash = seed + PRIME5;
+    }
+    hash += length;
+
+    // Step 2: the remaining 8, 4 and 1 byte pieces, then the avalanche
+    return finish(hash, p, end);
+}
+
+XxHash64::XxHash64(uint64_t seed) : seed(seed), accumulators{seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1}, buffered(0), total(0){
+}
+
+void XxHash64::update(const uint8_t* data, size_t length){
+    const uint8_t* p = data;
+    const uint8_t* end = data + length;
+    total += length;
+
+    // Step 1: complete the stripe left over from the previous call
+    if (buffered > 0){
+        size_t taken = std::min(length, 32 - buffered);
+        std::memcpy(buffer + buffered, p, taken);
+        buffered += taken;
+        p += taken;
+        if (buffered < 32){
+            return;
+        }
+        for (int i=0; i<4; i++){
+            accumulators[i] = accumulate(accumulators[i], read64(buffer + 8*i));
+        }
+        buffered = 0;
+    }
+
+    // Step 2: whole stripes straight from the input, and keep the rest
+    for (; p + 32 <= end; p += 32){
+        for (int i=0; i<4; i++){
+            accumulators[i] = accumulate(accumulators[i], read64(p + 8*i));
+        }
+    }
+    std::memcpy(buffer, p, end - p);
+    buffered = end - p;
+}
+
+uint64_t XxHash64::digest() const{
+    uint64_t hash = total >= 32 ? mergeAccumulators(accumulators) : seed + PRIME5;
+    hash += total;
+    return finish(hash, buffer, buffer + buffered);
+}
+
+uint64_t chunkedHash(const uint8_t* data, size_t length, size_t chunk_size){
+    // Step 1: hash the chunks, thread t taking chunks t, t + threads, ...
+    size_t chunks = length == 0 ? 0 : (length - 1)/chunk_size + 1;
+    std::vector<uint64_t> hashes(chunks);
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), chunks);
+    auto work = [&](size_t first){
+        for (size_t c = first; c < chunks; c += threads){
+            size_t offset = c*chunk_size;
+            hashes[c] = xxHash64(data + offset, std::min(chunk_size, length - offset), c);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; t++){
+        workers.push_back(std::thread(work, t));
+    }
+    if (threads > 0){
+        work(0);
+    }
+    for (std::thread& worker : workers){
+        worker.join();
+    }
+
+    // Step 2: hash the hashes, with the length as seed
+    return xxHash64(reinterpret_cast<const uint8_t*>(hashes.data()), hashes.size()*sizeof(uint64_t), length);
+}
+
+ChunkedHash::ChunkedHash(size_t chunk_size) : chunk_size(chunk_size), filled(0), total(0), current(0){
+}
+
+void ChunkedHash::update(const uint8_t* data, size_t length){
+    // Pieces may straddle chunks: chunk c is hashed with seed c, as in chunkedHash
+    while (length > 0){
+        size_t taken = std::min(length, chunk_size - filled);
+        current.update(data, taken);
+        data += taken;
+        length -= taken;
+        filled += taken;
+        total += taken;
+        if (filled == chunk_size){
+            hashes.push_back(current.digest());
+            current = XxHash64(hashes.size());
+            filled = 0;
+        }
+    }
+}
+
+uint64_t ChunkedHash::digest() const{
+    std::vector<uint64_t> all(hashes);
+    if (filled > 0){
+        all.push_back(current.digest());
+    }
+    return xxHash64(reinterpret_cast<const uint8_t*>(all.data()), all.size()*sizeof(uint64_t), total);
+}
@@ -0,0 +1,44 @@
+#include "common_includes.h"
+#include "complex_view.h"
+
+ComplexView::ComplexView(){
+    first = nullptr;
+    length = 0;
+}
+
+ComplexView::ComplexView(const std::complex<double>* data, size_t size){
+    first = data;
+    length = size;
+}
+
+ComplexView::ComplexView(const std::vector<std::complex<double> >& vec){
+    first = vec.data();
+    length = vec.size();
+}
+
+const std::complex<double>& ComplexView::at(size_t i) const{
+    if (i >= length){
+        throw std::out_of_range("ComplexView::at: index " + std::to_string(i) + " out of range for size " + std::to_string(length));
+    }
+    return first[i];
+}
+
+const std::complex<double>* ComplexView::data() const{
+    return first;
+}
+
+const std::complex<double>* ComplexView::begin() const{
+    return first;
+}
+
+const std::complex<double>* ComplexView::end() const{
+    return first + length;
+}
+
+size_t ComplexView::size() const{
+    return length;
+}
+
+bool ComplexView::empty() const{
+    return length == 0;
+}
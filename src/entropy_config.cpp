@@ -10,6 +10,43 @@ EntropyConfig::EntropyConfig() {
     max_iterations = DEFAULT_MINIMIZER_MAX_ITERATIONS;
     epsilon = DEFAULT_MINIMIZER_EPSILON;
     minimization_attempts = DEFAULT_MINIMIZER_MINIMIZATION_ATTEMPTS;
+    objective = DEFAULT_MINIMIZER_OBJECTIVE;
+    renyi_p = DEFAULT_MINIMIZER_RENYI_P;
+    start_sequence = DEFAULT_MINIMIZER_START_SEQUENCE;
+    channel_start_count = DEFAULT_MINIMIZER_CHANNEL_STARTS;
+    compare_starts = false;
+    convergence = DEFAULT_MINIMIZER_CONVERGENCE;
+
+    // Entropy estimation
+    use_slq = false;
+    slq_max_probes = DEFAULT_SLQ_MAX_PROBES;
+    slq_lanczos_steps = DEFAULT_SLQ_LANCZOS_STEPS;
+    slq_tolerance = DEFAULT_SLQ_TOLERANCE;
+
+    // Kraus subsampling
+    use_subsampling = false;
+    subsampling_batch = DEFAULT_SUBSAMPLING_BATCH;
+    subsampling_growth = DEFAULT_SUBSAMPLING_GROWTH;
+
+    // Beam search
+    beam_width = DEFAULT_BEAM_WIDTH;
+    beam_branches = DEFAULT_BEAM_BRANCHES;
+
+    // Overrelaxation and portfolio racing
+    use_overrelaxation = false;
+    use_portfolio = false;
+    portfolio_stats_file = (std::filesystem::path(SAVE_DIRECTORY) / DEFAULT_PORTFOLIO_STATS_FILE).string();
+
+    // Basin deduplication
+    use_dedup = false;
+    dedup_interval = DEFAULT_DEDUP_INTERVAL;
+
+    // Basin hopping
+    use_hopping = false;
+    hopping_step = DEFAULT_HOPPING_STEP;
+    hopping_temperature = DEFAULT_HOPPING_TEMPERATURE;
+    hopping_restart_ratio = DEFAULT_HOPPING_RESTART_RATIO;
+    hopping_iterations = DEFAULT_HOPPING_ITERATIONS;
 
     // MOE prediction
     MOE_use_prediction = DEFAULT_MINIMIZER_USE_MOE_PREDICTION;
@@ -20,6 +57,7 @@ EntropyConfig::EntropyConfig() {
     checkpoint_interval = DEFAULT_MINIMIZER_CHECKPOINT_INTERVAL;
     checkpoint_file = DEFAULT_MINIMIZER_CHECKPOINT_FILE;
     use_custom_checkpoint_file = false;
+    snapshot_file = "";
 
 
 
@@ -43,6 +81,11 @@ int EntropyConfig::setCheckpointFile(const std::string& cf){
     return 0;
 }
 
+int EntropyConfig::setSnapshotFile(const std::string& sf){
+    snapshot_file = sf;
+    return 0;
+}
+
 int EntropyConfig::setCheckpointInterval(int ci){
     checkpoint_interval = ci;
     return 0;
@@ -74,6 +117,131 @@ int EntropyConfig::setEpsilon(double eps){
     return 0;
 }
 
+int EntropyConfig::setObjective(int obj){
+    objective = obj;
+    return 0;
+}
+
+int EntropyConfig::setRenyiP(int p){
+    renyi_p = p;
+    return 0;
+}
+
+int EntropyConfig::setStartSequence(int ss){
+    start_sequence = ss;
+    return 0;
+}
+
+int EntropyConfig::setChannelStartCount(int count){
+    channel_start_count = count;
+    return 0;
+}
+
+int EntropyConfig::setCompareStarts(bool cs){
+    compare_starts = cs;
+    return 0;
+}
+
+int EntropyConfig::setConvergence(int c){
+    convergence = c;
+    return 0;
+}
+
+int EntropyConfig::setSLQ(bool slq){
+    use_slq = slq;
+    return 0;
+}
+
+int EntropyConfig::setSLQMaxProbes(int probes){
+    slq_max_probes = probes;
+    return 0;
+}
+
+int EntropyConfig::setSLQLanczosSteps(int steps){
+    slq_lanczos_steps = steps;
+    return 0;
+}
+
+int EntropyConfig::setSLQTolerance(double tol){
+    slq_tolerance = tol;
+    return 0;
+}
+
+int EntropyConfig::setSubsampling(bool ss){
+    use_subsampling = ss;
+    return 0;
+}
+
+int EntropyConfig::setSubsamplingBatch(int batch){
+    subsampling_batch = batch;
+    return 0;
+}
+
+int EntropyConfig::setSubsamplingGrowth(double growth){
+    subsampling_growth = growth;
+    return 0;
+}
+
+int EntropyConfig::setBeamWidth(int width){
+    beam_width = width;
+    return 0;
+}
+
+int EntropyConfig::setBeamBranches(int branches){
+    beam_branches = branches;
+    return 0;
+}
+
+int EntropyConfig::setOverrelaxation(bool o){
+    use_overrelaxation = o;
+    return 0;
+}
+
+int EntropyConfig::setPortfolio(bool p){
+    use_portfolio = p;
+    return 0;
+}
+
+int EntropyConfig::setPortfolioStatsFile(const std::string& psf){
+    portfolio_stats_file = psf;
+    return 0;
+}
+
+int EntropyConfig::setDedup(bool dd){
+    use_dedup = dd;
+    return 0;
+}
+
+int EntropyConfig::setDedupInterval(int di){
+    dedup_interval = di;
+    return 0;
+}
+
+int EntropyConfig::setHopping(bool h){
+    use_hopping = h;
+    return 0;
+}
+
+int EntropyConfig::setHoppingStep(double step){
+    hopping_step = step;
+    return 0;
+}
+
+int EntropyConfig::setHoppingTemperature(double temperature){
+    hopping_temperature = temperature;
+    return 0;
+}
+
+int EntropyConfig::setHoppingRestartRatio(double ratio){
+    hopping_restart_ratio = ratio;
+    return 0;
+}
+
+int EntropyConfig::setHoppingIterations(int iterations){
+    hopping_iterations = iterations;
+    return 0;
+}
+
 int EntropyConfig::setLogging(bool l){
     log = l;
     return 0;
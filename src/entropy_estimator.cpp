@@ -164,3 +164,30 @@ EntropyEstimator::~EntropyEstimator(){
     delete[] X_matrix;
     delete[] Y_vector;
 }
+
+json EntropyEstimator::getSnapshot(){
+    // X_matrix and Y_vector are rebuilt from these by every fit
+    size_t filled = std::min(current_window_index, max_window_size);
+    size_t filled_deltas = current_window_index > 0 ? std::min(current_window_index-1, max_window_size-1) : 0;
+    return {
+        {"window_size", window_size},
+        {"index", current_window_index},
+        {"window", encodeDoubles(window, filled)},
+        {"deltas", encodeDoubles(deltas, filled_deltas)},
+        {"model_params", encodeDoubles(model_params, 2)}
+    };
+}
+
+int EntropyEstimator::restoreSnapshot(const json& snapshot){
+    window_size = snapshot.at("window_size").get<size_t>();
+    current_window_index = snapshot.at("index").get<size_t>();
+    if (window_size > max_window_size){
+        throw std::runtime_error("Entropy estimator window larger than the maximum.");
+    }
+    size_t filled = std::min(current_window_index, max_window_size);
+    size_t filled_deltas = current_window_index > 0 ? std::min(current_window_index-1, max_window_size-1) : 0;
+    decodeDoubles(snapshot.at("window"), window, filled);
+    decodeDoubles(snapshot.at("deltas"), deltas, filled_deltas);
+    decodeDoubles(snapshot.at("model_params"), model_params, 2);
+    return 0;
+}
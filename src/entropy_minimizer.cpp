@@ -4,16 +4,37 @@
 #include "config.h"
 #include "minimizer.h"
 #include "message_handler.h"
+#include "channel_decomposition.h"
+#include "rng.h"
 
 #include "uuid.h"
 
 
-EntropyMinimizer::EntropyMinimizer(std::vector<std::complex<double> >* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, EntropyConfig* conf){
+EntropyMinimizer::EntropyMinimizer(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, EntropyConfig* conf)
+    : EntropyMinimizer(new Minimizer(kraus_ops, kraus_number, kraus_in_dimension, kraus_out_dimension, conf->epsilon), kraus_ops, kraus_number, kraus_in_dimension, kraus_out_dimension, conf) {
+}
+
+EntropyMinimizer::EntropyMinimizer(Minimizer* min, ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, EntropyConfig* conf){
 
     // Save configuration
     config = conf;
 
-    minimizer = new Minimizer(kraus_ops, kraus_number, kraus_in_dimension, kraus_out_dimension, config->epsilon); // This avoids having to use initialize list
+    // Save the channel. The Kraus operators are not copied.
+    kraus_operators = kraus_ops;
+    d = kraus_number;
+    N = kraus_in_dimension;
+    M = kraus_out_dimension;
+
+    // The minimizer is owned from now on, and deleted with this instance
+    minimizer = min;
+    minimizer->setObjective(config->objective, config->renyi_p);
+    minimizer->setOverrelaxation(config->use_overrelaxation);
+    // Estimate entropies with stochastic Lanczos quadrature, if requested
+    slq_estimator = nullptr;
+    if (config->use_slq){
+        slq_estimator = new SLQEstimator(kraus_out_dimension, config->slq_max_probes, config->slq_lanczos_steps, config->slq_tolerance);
+        minimizer->setEntropyEstimator(slq_estimator);
+    }
 
     // Setup logging and messages
     message_handler = new MessageHandler();
@@ -33,14 +54,45 @@ EntropyMinimizer::EntropyMinimizer(std::vector<std::complex<double> >* kraus_ops
 
     // INITIALIZATION OF SERIALIZER
     serializer = new VectorSerializer();
+    checkpoint_writer = nullptr;
+    snapshot_writer = nullptr;
+    resume_pending = false;
+    ledger = nullptr;
+    collection = nullptr;
 
     // INITIALIZATION OF ENTROPY ESTIMATOR 
     entropy_estimator = new EntropyEstimator();
+    batch_estimator = new EntropyEstimator();
+    batch_estimator->window_size = SUBSAMPLING_FIT_WINDOW;
+    kraus_batch = 0;
+    subsampling_end = 0;
+
+    // No symmetry is known until one is set
+    symmetry = nullptr;
+    minima_registry = new MinimaRegistry();
+    channel_cache = nullptr;
+
+    // Random starts are drawn independently, unless a low-discrepancy sequence is requested
+    start_sequence = nullptr;
+    if (config->start_sequence == START_SEQUENCE_HALTON){
+        start_sequence = new HaltonSphere(N);
+    }
+    start_generator = nullptr;
+    portfolio = nullptr;
+    channel_starts_used = 0;
+    run_channel_start = false;
 
 
     // Initialize the current iteration and current MOE
     current_iteration = 0;
+    previous_gain = -1;
+    window_entropy = -1;
+    window_iteration = 0;
+    estimate_noise_reported = false;
+    run_count = 0;
+    run_stream = 0;
     MOE = -1;
+    resetSearch();
 
     // Initialize the signaling stuff
     self = this;
@@ -50,7 +102,35 @@ EntropyMinimizer::EntropyMinimizer(std::vector<std::complex<double> >* kraus_ops
 
 int EntropyMinimizer::initializeRun(){
     message_handler->message("Initializing new run. No starting vector detected, generating random one...");
-    int info = minimizer->initializeRandomVector();
+    // Every run draws from its own stream
+    run_stream = run_count++;
+    minimizer->setRandomStream(run_stream);
+    int info;
+    std::vector<std::complex<double> > start(N);
+    // Channel-informed starts come first. The pool is ranked when the first one is needed.
+    run_channel_start = false;
+    if (config->start_sequence == START_SEQUENCE_CHANNEL && channel_starts_used < config->channel_start_count){
+        if (start_generator == nullptr){
+            rankChannelStarts();
+        }
+        run_channel_start = start_generator->nextVector(&start) == 0;
+    }
+    if (run_channel_start){
+        channel_starts_used += 1;
+        info = minimizer->initializeVector(&start);
+        oss.str("");
+        oss << "Starting from " << start_generator->getLabel() << ", ranked with entropy " << std::fixed << std::setprecision(PRINT_PRECISION) << start_generator->getEntropy() << ".";
+        message_handler->message(oss.str());
+    } else if (start_sequence != nullptr){
+        start_sequence->nextVector(&start);
+        info = minimizer->initializeVector(&start);
+    } else {
+        info = minimizer->initializeRandomVector();
+    }
+    // Equivalent starts lead to equivalent minima: use the representative in the fundamental domain
+    if (symmetry != nullptr){
+        symmetry->toFundamentalDomain(minimizer->getVectorState());
+    }
     // print info
     if (info == 0){
         message_handler->message("Successfully initialized run with random vector!");
@@ -65,6 +145,11 @@ int EntropyMinimizer::initializeRun(){
     run_id = generate_uuid_v4();
 
     current_iteration = 0;
+    previous_gain = -1;
+    window_entropy = -1;
+    window_iteration = 0;
+    startSubsampling();
+    beam.clear();
 
     // Compute the entropy of the start vector and save it in the buffer
     minimizer->calculateEntropy();
@@ -75,15 +160,16 @@ int EntropyMinimizer::initializeRun(){
     entropy_estimator->appendEntropy(*minimizer->getEntropy());
 
     // Check if we have found a new MOE
-    if (MOE < 0 || entropy_buffer[0] < MOE) {
-        MOE = entropy_buffer[0];
-    }
+    updateMOE(entropy_buffer[0]);
 
     return info;
 }
 
 int EntropyMinimizer::initializeRun(std::vector<std::complex<double> >* start_vector){
     message_handler->message("Initializing new run. A vector was passed as input...");
+    run_channel_start = false;
+    run_stream = run_count++;
+    minimizer->setRandomStream(run_stream);
 
     // debug vector inof
     oss.str("");
@@ -104,6 +190,11 @@ int EntropyMinimizer::initializeRun(std::vector<std::complex<double> >* start_ve
     run_id = generate_uuid_v4();
     
     current_iteration = 0;
+    previous_gain = -1;
+    window_entropy = -1;
+    window_iteration = 0;
+    startSubsampling();
+    beam.clear();
 
     // Compute the entropy of the start vector and save it in the buffer
     minimizer->calculateEntropy();
@@ -115,16 +206,18 @@ int EntropyMinimizer::initializeRun(std::vector<std::complex<double> >* start_ve
 
 
     // Check if we have found a new MOE
-    if (MOE < 0 || entropy_buffer[0] < MOE) {
-        MOE = entropy_buffer[0];
-    }
+    updateMOE(entropy_buffer[0]);
 
     return info;
 }
 
 int EntropyMinimizer::stepMinimization(){
-    // Step 1: step through the algorithm
-    minimizer->step();
+    // Step 1: step through the algorithm, or through the beam. Subsampled steps are too noisy to rank branches: the beam starts after them.
+    if (config->beam_width > 1 && kraus_batch == 0){
+        stepBeam();
+    } else {
+        minimizer->step();
+    }
     current_iteration +=1;
 
     // Step 2: update the MOE if the newly found MOE is lower. No need to calculate the entropy, since it already is done when minimizer steps
@@ -132,12 +225,42 @@ int EntropyMinimizer::stepMinimization(){
     entropy_buffer[current_iteration % CONVERGENCE_ITERS] = *minimizer->getEntropy();
     entropy_estimator->appendEntropy(*minimizer->getEntropy());
     // 2.2: Check if we have found a new MOE
-    if (entropy_buffer[0] < MOE) {
-        MOE = entropy_buffer[current_iteration % CONVERGENCE_ITERS];
+    updateMOE(entropy_buffer[current_iteration % CONVERGENCE_ITERS]);
+    reportEstimateNoise();
+
+    // Subsampled steps are noisy and need not decrease the entropy: grow the batch instead of checking for convergence
+    if (kraus_batch > 0){
+        updateKrausBatch();
+        return 0;
     }
 
-    // Step 3: check if we need to stop.
-    if (current_iteration >= CONVERGENCE_ITERS){
+    // Step 3: check if we need to stop. Only entropies from full channel steps count.
+    double residual, gain, infidelity;
+    if (config->convergence == CONVERGENCE_RESIDUAL && minimizer->getStepResidual(&residual, &gain, &infidelity) == 0){
+        // 3.1: near a minimum the gains of consecutive steps shrink geometrically, with ratio q: what is left is about gain q/(1-q).
+        // The gain itself is a lower bound on the decrease of the entropy over the step, so it is not fooled by rounding in the entropies.
+        double remaining = -1;
+        if (previous_gain > 0 && gain < previous_gain){
+            double ratio = gain/previous_gain;
+            remaining = gain*ratio/(1-ratio);
+        }
+        previous_gain = gain;
+        // 3.2: stop if nothing is left to gain, or if the step did not move the vector: it was a fixed point to working precision
+        if (gain <= 0 || infidelity < RESIDUAL_FIDELITY_TOLERANCE || (remaining >= 0 && remaining < RESIDUAL_TOLERANCE)){
+            oss.str("");
+            oss << "[Iteration " << current_iteration << "] Fixed point residual " << std::scientific << std::setprecision(3) << residual
+                << ", step infidelity " << infidelity << ", estimated improvement left " << std::max(remaining, 0.0) << ".";
+            message_handler->message(oss.str());
+            return 1;
+        }
+        return 0;
+    }
+    // Otherwise (the beam and the product step do not measure their residual), look at the last CONVERGENCE_ITERS entropies
+    if (current_iteration - subsampling_end >= CONVERGENCE_ITERS){
+        // Estimated entropies are noisier than any improvement the window looks for: compare exact ones instead
+        if (!minimizer->isEntropyExact()){
+            return exactWindowCheck();
+        }
         // 3.1: stop if the new improvement is negative - we have reached numerical instability!
         for (int i=0; i < CONVERGENCE_ITERS-1; i++){
             // Only run through CONVERGENCE_ITERS-1 because we want the deltas.
@@ -167,7 +290,15 @@ int EntropyMinimizer::runMinimization(){
     // Perform the minimization
     message_handler->message("Starting minimization...");
 
-    while (stepMinimization() == 0 && current_iteration < config->max_iterations && !shouldTerminate()){
+    // A run resumed from a snapshot just goes on
+    resume_pending = false;
+    // With a portfolio, its variants race instead of the loop below. Termination is checked before every step, so that an
+    // interrupted run stops between two iterations and a snapshot of it resumes with the next one.
+    bool interrupted = false;
+    if (config->use_portfolio){
+        racePortfolio();
+    }
+    while (!config->use_portfolio && !(interrupted = shouldTerminate()) && stepMinimization() == 0 && current_iteration < config->max_iterations){
         // Print the current entropy from this run. 
         oss.str("");
         oss << "[Iteration " << current_iteration << "] Entropy: " << std::fixed << std::setprecision(PRINT_PRECISION) << *minimizer->getEntropy();
@@ -178,20 +309,29 @@ int EntropyMinimizer::runMinimization(){
             oss.str("");
             oss << "[Iteration " << current_iteration << "] Checkpoint reached. Saving current state..";
             message_handler->message(oss.str());
+            exactEntropyCheck();
             if (config->use_custom_checkpoint_file){
                 saveVector(config->checkpoint_file);
             } else {
                 saveVector();
             }
         }
+        if (!config->snapshot_file.empty() && current_iteration % config->checkpoint_interval == 0){
+            saveSnapshot(false, true);
+        }
 
     }
     if (terminate_requested){
         message_handler->message("Minimization stopped: termination requested.");
+        // Before the exact entropy check below, which changes the state when entropies are estimated
+        if (interrupted && !config->snapshot_file.empty()){
+            saveSnapshot(false, true);
+        }
         if (config->save_checkpoint){
             oss.str("");
             oss << "Checkpoints are enabled. Saving last checkpoint...";
             message_handler->message(oss.str());
+            exactEntropyCheck();
             if (config->use_custom_checkpoint_file){
                 saveVector(config->checkpoint_file);
             } else {
@@ -205,7 +345,11 @@ int EntropyMinimizer::runMinimization(){
         message_handler->message("We reached the tolerance: we have converged!");
     }
 
-    // We have finished the minimization attempts. Print the final MOE
+    // Checkpoints of this run are on disk before it is reported as finished
+    flushCheckpoints();
+
+    // We have finished the minimization attempts. Print the final MOE, exact even if entropies were estimated along the way
+    exactEntropyCheck();
     oss.str("");
     oss << "Final entropy: " << *minimizer->getEntropy();
     message_handler->message(oss.str());
@@ -222,9 +366,17 @@ int EntropyMinimizer::runMinimization(double target_entropy){
 
     // Perform the minimization
     message_handler->message("Starting minimization...");
-    // Initialize a flag that, if MOE prediction is used, will stop the minimization
-    bool predict_stop = false;
-    while (stepMinimization() == 0 && current_iteration < config->max_iterations && !predict_stop && !shouldTerminate()){
+    // Initialize the flag that, if MOE prediction is used, will stop the minimization. A run resumed from a snapshot keeps its own.
+    if (!resume_pending){
+        search.predict_stop = false;
+    }
+    resume_pending = false;
+    // With a portfolio, its variants race instead of the loop below. Termination is checked before every step, see runMinimization().
+    bool interrupted = false;
+    if (config->use_portfolio){
+        racePortfolio();
+    }
+    while (!config->use_portfolio && !(interrupted = shouldTerminate()) && stepMinimization() == 0 && current_iteration < config->max_iterations && !search.predict_stop){
         // Print the current entropy from this run. 
         oss.str("");
         oss << "[Iteration " << current_iteration << "] Entropy: " << std::fixed << std::setprecision(PRINT_PRECISION) << *minimizer->getEntropy();
@@ -249,7 +401,7 @@ int EntropyMinimizer::runMinimization(double target_entropy){
                     message_handler->message(oss.str());
                 }
                 if (predicted_entropy - target_entropy > config->MOE_prediction_tolerance){
-                    predict_stop = true;
+                    search.predict_stop = true;
                 }
 
             }                
@@ -261,19 +413,27 @@ int EntropyMinimizer::runMinimization(double target_entropy){
             oss.str("");
             oss << "[Iteration " << current_iteration << "] Checkpoint reached. Saving current state..";
             message_handler->message(oss.str());
+            exactEntropyCheck();
             if (config->use_custom_checkpoint_file){
                 saveVector(config->checkpoint_file);
             } else {
                 saveVector();
             }
         }
+        if (!config->snapshot_file.empty() && current_iteration % config->checkpoint_interval == 0){
+            saveSnapshot(false, true);
+        }
     }
     if (terminate_requested){
         message_handler->message("Minimization stopped: termination requested.");
+        if (interrupted && !config->snapshot_file.empty()){
+            saveSnapshot(false, true);
+        }
         if (config->save_checkpoint){
             oss.str("");
             oss << "Checkpoints are enabled. Saving last checkpoint...";
             message_handler->message(oss.str());
+            exactEntropyCheck();
             if (config->use_custom_checkpoint_file){
                 saveVector(config->checkpoint_file);
             } else {
@@ -283,13 +443,17 @@ int EntropyMinimizer::runMinimization(double target_entropy){
     }
     else if (current_iteration >= config->max_iterations){
         message_handler->message("We reached the maximum number of iterations! Aborting...");
-    } else if (predict_stop){
+    } else if (search.predict_stop){
         message_handler->message("Minimization stopped: predicted MOE is above target entropy.");
     } else {
         message_handler->message("We reached the tolerance: we have converged!");
     }
 
-    // We have finished the minimization attempts. Print the final MOE
+    // Checkpoints of this run are on disk before it is reported as finished
+    flushCheckpoints();
+
+    // We have finished the minimization attempts. Print the final MOE, exact even if entropies were estimated along the way
+    exactEntropyCheck();
     oss.str("");
     oss << "Final entropy: " << *minimizer->getEntropy();
     message_handler->message(oss.str());
@@ -303,33 +467,73 @@ int EntropyMinimizer::findMOE(){
     oss << "Will try to find MOE. Running" << config->minimization_attempts << " minimization attempts.";
     message_handler->message(oss.str());
 
+    // A search resumed from a snapshot continues with its attempts, basin hopping state and statistics
+    if (!resume_pending){
+        resetSearch();
+    }
+
     // Step through the minimization attempts
-    for (int i=0; i<config->minimization_attempts; i++){
-        if (shouldTerminate()){
+    for (int i=search.attempt; i<config->minimization_attempts; i++){
+        search.attempt = i;
+        // The first attempt of a search resumed inside it continues where the snapshot was taken
+        bool resuming = resume_pending && search.in_attempt;
+        resume_pending = false;
+        if (!resuming && !config->snapshot_file.empty()){
+            saveSnapshot(true, false);
+        }
+        if (!resuming && shouldTerminate()){
+            flushCheckpoints();
             message_handler->message("Termination requested. Aborting...");
             return 1;
         }
-        // Initialize a new run
-        initializeRun();
+        // Initialize a new run, from a perturbation of the basin hopping state unless a fresh restart is drawn
+        RandomStream hop_stream(RNG_DOMAIN_HOPPING, i);
+        if (resuming){
+            // The run is restored already: only draw what the start of the attempt drew, so that the acceptance test gets the same numbers
+            if (config->use_hopping && !search.hop_vector.empty()){
+                hop_stream.uniform();
+            }
+            if (search.hop_move){
+                std::vector<std::complex<double> > direction(N);
+                hop_stream.fillComplexNormal(direction.data(), direction.size());
+            }
+        } else {
+            search.hop_move = config->use_hopping && !search.hop_vector.empty() && hop_stream.uniform() >= config->hopping_restart_ratio;
+            if (search.hop_move){
+                std::vector<std::complex<double> > start = search.hop_vector;
+                perturbVector(&start, search.hop_step, &hop_stream);
+                initializeRun(&start);
+            } else {
+                initializeRun();
+            }
+            search.start_entropy = *minimizer->getEntropy();
+            search.predict_stop = false;
+            search.basin = -1;
+            search.hop_return = false;
+        }
+        // A hop move starts close to a minimum: it gets a budget of its own, so that moves cost less than restarts
+        int iteration_budget = search.hop_move ? std::min(config->max_iterations, config->hopping_iterations) : config->max_iterations;
+        std::chrono::steady_clock::time_point attempt_start = std::chrono::steady_clock::now();
+        double previous_MOE = MOE;
         // Print message
         oss.str("");
-        oss << "Initializing minimization attempt " << i+1 << " of " << config->minimization_attempts << ".";
+        oss << (resuming ? "Resuming" : "Initializing") << " minimization attempt " << i+1 << " of " << config->minimization_attempts << ".";
         message_handler->message(oss.str());
 
         // Perform the minimization
         message_handler->message("Starting minimization...");
-        // Initialize a flag that, if MOE prediction is used, will stop the minimization
-        bool predict_stop = false;
-        while (stepMinimization() == 0 && current_iteration < config->max_iterations && !predict_stop && !shouldTerminate()){
+        // With a portfolio, its variants race instead of the loop below. Termination is checked before every step, see runMinimization().
+        bool interrupted = false;
+        if (config->use_portfolio){
+            racePortfolio();
+        }
+        while (!config->use_portfolio && !(interrupted = shouldTerminate()) && stepMinimization() == 0 && current_iteration < iteration_budget && !search.predict_stop && search.basin < 0 && !search.hop_return){
             // Print the current entropy from this run. 
             oss.str("");
             oss << "[Iteration " << current_iteration << "] Entropy: " << std::fixed << std::setprecision(PRINT_PRECISION) << *minimizer->getEntropy();
             message_handler->message(oss.str());
             // If necessary, update the MOE
-            double new_entropy = *minimizer->getEntropy();
-            if (new_entropy < MOE){
-                MOE = new_entropy;
-            }
+            updateMOE(*minimizer->getEntropy());
             // Also print the current MOE
             oss.str("");
             oss << "Current MOE: " << MOE;
@@ -353,42 +557,566 @@ int EntropyMinimizer::findMOE(){
                         message_handler->message(oss.str());
                     }
                     if (predicted_entropy - MOE > config->MOE_prediction_tolerance){
-                        predict_stop = true;
+                        search.predict_stop = true;
                     }
 
                 }                
 
             }
+            // Check if we have entered the basin of a known minimum. An attempt that is already below it is heading somewhere else.
+            if (config->use_dedup && current_iteration % config->dedup_interval == 0){
+                search.basin = minima_registry->findMinimum(*minimizer->getVectorState(), BASIN_FIDELITY_THRESHOLD);
+                if (search.basin >= 0 && *minimizer->getEntropy() < minima_registry->getEntropy(search.basin)){
+                    search.basin = -1;
+                }
+            }
+            // Check if a hop move has fallen back into the basin it started from. The rest of it would only find that minimum again.
+            if (search.hop_move && current_iteration % HOPPING_RETURN_INTERVAL == 0){
+                search.hop_return = *minimizer->getEntropy() >= search.hop_entropy
+                    && minima_registry->fidelity(search.hop_vector, *minimizer->getVectorState()) > BASIN_FIDELITY_THRESHOLD;
+            }
+            if (!config->snapshot_file.empty() && current_iteration % config->checkpoint_interval == 0){
+                saveSnapshot(true, true);
+            }
         }
-        if (shouldTerminate()){
+        // Before the exact entropy check below, which changes the state when entropies are estimated
+        if (interrupted && !config->snapshot_file.empty()){
+            saveSnapshot(true, true);
+        }
+        // Entropies may have been estimated along the way: the attempt is judged on the exact one
+        exactEntropyCheck();
+        if (interrupted || (config->use_portfolio && shouldTerminate())){
+            flushCheckpoints();
             message_handler->message("Termination requested. Aborting...");
             return 1;
         }
-        else if (current_iteration >= config->max_iterations){
-            message_handler->message("We reached the maximum number of iterations! Aborting...");
+        // How the attempt ended, and at which minimum, for the ledger
+        std::string outcome;
+        int minimum = -1;
+        if (current_iteration >= iteration_budget){
+            outcome = "max_iterations";
+            if (iteration_budget < config->max_iterations){
+                oss.str("");
+                oss << "The hop move did not converge within " << iteration_budget << " iterations. Aborting...";
+                message_handler->message(oss.str());
+            } else {
+                message_handler->message("We reached the maximum number of iterations! Aborting...");
+            }
+        } else if (search.predict_stop){
+            outcome = "predicted";
+            message_handler->message("Attempt stopped: predicted entropy is above the current MOE.");
+        } else if (search.hop_return){
+            outcome = "returned";
+            oss.str("");
+            oss << "Attempt " << i+1 << " fell back into the basin of the basin hopping state at iteration " << current_iteration << ". Stopping it.";
+            message_handler->message(oss.str());
+        } else if (search.basin >= 0){
+            outcome = "basin";
+            minimum = search.basin;
+            minima_registry->recordBasinHit(search.basin);
+            oss.str("");
+            oss << "Attempt " << i+1 << " entered the basin of known minimum #" << search.basin+1 << (symmetry != nullptr ? " (up to symmetry)" : "") << " at iteration " << current_iteration << ". Stopping it.";
+            message_handler->message(oss.str());
         } else {
             message_handler->message("We reached the tolerance: we have converged!");
+            // Record which minimum we converged to
+            int previous_count = minima_registry->getMinimaCount();
+            int m = minima_registry->registerMinimum(*minimizer->getVectorState(), *minimizer->getEntropy());
+            outcome = "converged";
+            minimum = m;
+            oss.str("");
+            if (m == previous_count){
+                oss << "Attempt " << i+1 << " found a new minimum (#" << m+1 << ").";
+            } else {
+                oss << "Attempt " << i+1 << " converged to known minimum #" << m+1 << (symmetry != nullptr ? " (up to symmetry)" : "") << ", hit " << minima_registry->getHits(m) << " times.";
+            }
+            message_handler->message(oss.str());
+        }
+
+        // Keep track of where the attempt started and ended, to compare the kinds of starts. An attempt stopped in a basin ends at its minimum.
+        if (config->compare_starts){
+            search.start_entropies[run_channel_start].push_back(search.start_entropy);
+            search.final_entropies[run_channel_start].push_back(search.basin >= 0 ? minima_registry->getEntropy(search.basin) : *minimizer->getEntropy());
+        }
+
+        // Basin hopping: Metropolis test of the minimum this attempt reached against the current state.
+        // An attempt stopped in a known basin reached that minimum. One that fell back into the basin of the current state reached
+        // it again, which counts as accepted, so that the step grows. One stopped by prediction or by its iteration budget reached
+        // nothing and is rejected.
+        bool accept = false;
+        if (config->use_hopping){
+            std::vector<std::complex<double> > candidate;
+            double candidate_entropy = -1;
+            if (search.hop_return){
+                candidate = search.hop_vector;
+                candidate_entropy = search.hop_entropy;
+            } else if (search.basin >= 0){
+                candidate = minima_registry->getVector(search.basin);
+                candidate_entropy = minima_registry->getEntropy(search.basin);
+            } else if (!search.predict_stop && outcome != "max_iterations"){
+                candidate = *minimizer->getVectorState();
+                candidate_entropy = *minimizer->getEntropy();
+            }
+            accept = candidate_entropy >= 0 && (search.hop_vector.empty() || candidate_entropy <= search.hop_entropy
+                || hop_stream.uniform() < std::exp(-(candidate_entropy-search.hop_entropy)/config->hopping_temperature));
+            if (accept){
+                search.hop_vector = candidate;
+                search.hop_entropy = candidate_entropy;
+            }
+            // Only perturbations count for the acceptance rate, not fresh restarts
+            if (search.hop_move){
+                search.hop_moves += 1;
+                search.window_moves += 1;
+                search.hop_accepted += accept;
+                search.window_accepted += accept;
+            }
+            oss.str("");
+            oss << "Basin hopping: " << (search.hop_move ? "move" : "restart") << (accept ? " accepted" : " rejected") << ", current state has entropy " << std::fixed << std::setprecision(PRINT_PRECISION) << search.hop_entropy << ".";
+            message_handler->message(oss.str());
+            // Adapt the step: accepting many moves means they do not leave the basin often enough
+            if (search.window_moves == HOPPING_ADAPT_INTERVAL){
+                if (double(search.window_accepted)/search.window_moves > HOPPING_TARGET_ACCEPTANCE){
+                    search.hop_step = std::min(search.hop_step*HOPPING_STEP_FACTOR, HOPPING_MAX_STEP);
+                } else {
+                    search.hop_step = std::max(search.hop_step/HOPPING_STEP_FACTOR, HOPPING_MIN_STEP);
+                }
+                search.window_moves = 0;
+                search.window_accepted = 0;
+                oss.str("");
+                oss << "Basin hopping step set to " << search.hop_step << ".";
+                message_handler->message(oss.str());
+            }
+        }
+        if (ledger != nullptr){
+            recordAttempt(i, outcome, minimum, accept, std::chrono::duration<double>(std::chrono::steady_clock::now() - attempt_start).count(), MOE != previous_MOE);
+        }
+        if (collection != nullptr){
+            collectAttempt(i, outcome);
+        }
+
+    }
+
+    // We have finished the minimization attempts. Print the distinct minima, then the final MOE
+    oss.str("");
+    oss << "Distinct minima found" << (symmetry != nullptr ? " (up to symmetry): " : ": ") << minima_registry->getMinimaCount();
+    message_handler->message(oss.str());
+    for (int m=0; m<minima_registry->getMinimaCount(); m++){
+        oss.str("");
+        oss << "Minimum #" << m+1 << ": entropy " << std::fixed << std::setprecision(PRINT_PRECISION) << minima_registry->getEntropy(m) << ", hit " << minima_registry->getHits(m) << " times";
+        if (config->use_dedup){
+            oss << " (" << minima_registry->getBasinHits(m) << " stopped early in its basin)";
         }
+        oss << ".";
+        message_handler->message(oss.str());
+    }
+    if (config->compare_starts){
+        for (int kind=1; kind>=0; kind--){
+            int attempts = search.final_entropies[kind].size();
+            if (attempts == 0){
+                continue;
+            }
+            double mean_start = std::accumulate(search.start_entropies[kind].begin(), search.start_entropies[kind].end(), 0.0)/attempts;
+            double mean_final = std::accumulate(search.final_entropies[kind].begin(), search.final_entropies[kind].end(), 0.0)/attempts;
+            int reached = std::count_if(search.final_entropies[kind].begin(), search.final_entropies[kind].end(), [this](double entropy){ return entropy - MOE < START_COMPARISON_TOLERANCE; });
+            oss.str("");
+            oss << (kind ? "Channel-informed" : "Random") << " starts: " << attempts << " attempts, mean starting entropy " << std::fixed << std::setprecision(PRINT_PRECISION) << mean_start
+                << ", mean final entropy " << mean_final << ", best " << *std::min_element(search.final_entropies[kind].begin(), search.final_entropies[kind].end())
+                << ", reached the MOE " << reached << " times.";
+            message_handler->message(oss.str());
+        }
+    }
+    if (config->use_hopping){
+        oss.str("");
+        oss << "Basin hopping: " << search.hop_accepted << " of " << search.hop_moves << " moves accepted, final step " << search.hop_step << ".";
+        message_handler->message(oss.str());
+    }
+    oss.str("");
+    oss << "Final MOE: " << MOE;
+    message_handler->message(oss.str());
+    flushCheckpoints();
 
+    return 0;
+}
 
+int EntropyMinimizer::findMOEDecomposed(){
+    // Step 1: look for a common block structure of the Kraus operators
+    message_handler->message("Looking for common invariant subspaces of the Kraus operators...");
+    if (N > DECOMPOSITION_MAX_DIMENSION){
+        oss.str("");
+        oss << "Input dimension " << N << " is above " << DECOMPOSITION_MAX_DIMENSION << ", skipping the decomposition.";
+        message_handler->message(oss.str(), LOG_LEVEL_WARNING);
+    }
+    ChannelDecomposition decomposition(kraus_operators, d, N);
+    int blocks = 0;
+    json info;
+    ComplexView basis;
+    bool cacheable = channel_cache != nullptr && N <= DECOMPOSITION_MAX_DIMENSION;
+    if (cacheable && channel_cache->getSection("decomposition", json::object(), &info, &basis)){
+        try {
+            blocks = decomposition.restoreSnapshot(info, basis);
+            message_handler->message("Took the block structure from " + channel_cache->getFilename() + ".");
+        } catch (const std::exception& e){
+            message_handler->message("Could not use the block structure of the channel cache: " + std::string(e.what()), LOG_LEVEL_WARNING);
+        }
+    }
+    if (blocks == 0){
+        blocks = decomposition.decompose();
+        if (cacheable){
+            try {
+                channel_cache->storeSection("decomposition", json::object(), decomposition.getSnapshot(), ComplexView(decomposition.getBasis()));
+            } catch (const std::exception& e){
+                message_handler->message(e.what(), LOG_LEVEL_WARNING);
+            }
+        }
+    }
+    oss.str("");
+    oss << "Block structure: " << decomposition.describe();
+    message_handler->message(oss.str());
+    if (blocks == 1){
+        message_handler->message("The channel does not decompose. Running the usual minimization.");
+        return findMOE();
+    }
+
+    // Step 2: find the MOE of every block separately. Each block is a channel on its own, so we reuse the whole machinery.
+    std::vector<std::vector<std::complex<double> > > block_vectors;
+    for (int b=0; b<blocks; b++){
+        int n = decomposition.getBlockDimension(b);
+        oss.str("");
+        oss << "Minimizing block " << b+1 << " of " << blocks << " (dimension " << n << ")...";
+        message_handler->message(oss.str());
+        if (n == 1){
+            // A one dimensional block contains a single state: nothing to minimize.
+            block_vectors.push_back(decomposition.embedVector(b, std::vector<std::complex<double> >(1, std::complex<double>(1.0f,0.0f))));
+            continue;
+        }
+        std::vector<std::complex<double> >* block_kraus = decomposition.getBlockKraus(b);
+        ComplexView block_view(*block_kraus);
+        EntropyMinimizer* block_minimizer = new EntropyMinimizer(&block_view, d, n, n, config);
+        block_minimizer->findMOE();
+        bool terminated = block_minimizer->shouldTerminate();
+        oss.str("");
+        oss << "Block " << b+1 << " MOE (restricted channel): " << std::fixed << std::setprecision(PRINT_PRECISION) << block_minimizer->getMOE();
+        message_handler->message(oss.str());
+        block_vectors.push_back(decomposition.embedVector(b, block_minimizer->getMOEVector()));
+        delete block_minimizer;
+        delete block_kraus;
+        // The block minimizer registered itself as the signal handler target. Take it back.
+        self = this;
+        if (terminated){
+            requestTerminate();
+            message_handler->message("Termination requested. Aborting...");
+            return 1;
+        }
+    }
+
+    // Step 3: evaluate the block minimizers on the full channel. The restricted channels are perturbed by epsilon*I/n instead of epsilon*I/N, so polish them here.
+    std::vector<std::pair<double, int> > block_entropies;
+    for (int b=0; b<blocks; b++){
+        if (shouldTerminate()){
+            message_handler->message("Termination requested. Aborting...");
+            return 1;
+        }
+        initializeRun(&block_vectors.at(b));
+        runMinimization();
+        block_vectors.at(b) = *minimizer->getVectorState();
+        block_entropies.push_back(std::make_pair(*minimizer->getEntropy(), b));
+    }
+
+    // Step 4: the fixed point iteration never mixes blocks (Phi^*(log Phi(rho)) is block diagonal when rho lives in one block),
+    // so superpositions across blocks must be seeded explicitly. Only pair up the most promising blocks.
+    std::sort(block_entropies.begin(), block_entropies.end());
+    int paired_blocks = std::min(blocks, DECOMPOSITION_SUPERPOSITION_BLOCKS);
+    RandomStream stream(RNG_DOMAIN_SUPERPOSITION, 0);
+    for (int i=0; i<paired_blocks; i++){
+        for (int j=i+1; j<paired_blocks; j++){
+            std::vector<std::complex<double> >& first = block_vectors.at(block_entropies.at(i).second);
+            std::vector<std::complex<double> >& second = block_vectors.at(block_entropies.at(j).second);
+            for (int s=0; s<DECOMPOSITION_SUPERPOSITION_SEEDS; s++){
+                if (shouldTerminate()){
+                    message_handler->message("Termination requested. Aborting...");
+                    return 1;
+                }
+                oss.str("");
+                oss << "Trying superposition " << s+1 << " of " << DECOMPOSITION_SUPERPOSITION_SEEDS << " of blocks " << block_entropies.at(i).second+1 << " and " << block_entropies.at(j).second+1 << ".";
+                message_handler->message(oss.str());
+                // Weights spread over (0, pi/2), random relative phase
+                double theta = (s+1)*M_PI/(2*(DECOMPOSITION_SUPERPOSITION_SEEDS+1));
+                std::complex<double> relative_phase = std::polar(1.0, 2*M_PI*stream.uniform());
+                std::vector<std::complex<double> > seed(N);
+                for (int k=0; k<N; k++){
+                    seed.at(k) = std::cos(theta)*first.at(k) + relative_phase*std::sin(theta)*second.at(k);
+                }
+                initializeRun(&seed);
+                runMinimization(MOE);
+            }
+        }
     }
 
     // We have finished the minimization attempts. Print the final MOE
     oss.str("");
     oss << "Final MOE: " << MOE;
     message_handler->message(oss.str());
-    
+    return 0;
+}
+
+int EntropyMinimizer::setSymmetry(ChannelSymmetry* sym){
+    symmetry = sym;
+    minima_registry->setSymmetry(sym);
+    return 0;
+}
+
+int EntropyMinimizer::setChannelCache(ChannelCache* cache){
+    channel_cache = cache;
+    return 0;
+}
+
+int EntropyMinimizer::rankChannelStarts(){
+    start_generator = new StartGenerator(kraus_operators, d, N, M);
+    // The ranking depends on the objective the minimizer computes, not on how the search goes on
+    json key = {
+        {"epsilon", config->epsilon},
+        {"objective", config->objective},
+        {"renyi_p", config->renyi_p},
+        {"slq", {config->use_slq, config->slq_max_probes, config->slq_lanczos_steps, config->slq_tolerance}}
+    };
+    json info;
+    ComplexView ranked;
+    if (channel_cache != nullptr && channel_cache->getSection("starts", key, &info, &ranked)){
+        try {
+            oss.str("");
+            oss << "Took " << start_generator->restoreSnapshot(info, ranked) << " ranked channel-informed starting vectors from " << channel_cache->getFilename() << ".";
+            message_handler->message(oss.str());
+            return 0;
+        } catch (const std::exception& e){
+            message_handler->message("Could not use the channel-informed starts of the channel cache: " + std::string(e.what()), LOG_LEVEL_WARNING);
+        }
+    }
+    oss.str("");
+    oss << "Ranked " << start_generator->rankCandidates(minimizer) << " distinct channel-informed starting vectors.";
+    message_handler->message(oss.str());
+    if (channel_cache != nullptr){
+        try {
+            std::vector<std::complex<double> > candidates = start_generator->getCandidates();
+            channel_cache->storeSection("starts", key, start_generator->getSnapshot(), ComplexView(candidates));
+        } catch (const std::exception& e){
+            message_handler->message(e.what(), LOG_LEVEL_WARNING);
+        }
+    }
+    return 0;
+}
+
+int EntropyMinimizer::startSubsampling(){
+    subsampling_end = 0;
+    kraus_batch = 0;
+    if (config->use_subsampling && config->subsampling_batch < d){
+        kraus_batch = config->subsampling_batch;
+        batch_estimator->reset();
+    }
+    minimizer->setKrausBatch(kraus_batch);
+    return 0;
+}
 
+int EntropyMinimizer::updateKrausBatch(){
+    // Grow the batch geometrically, as in mini-batch methods. Once the entropy decays exponentially, the fixed point iteration has reached
+    // its asymptotic regime and the sampling noise would only slow it down: switch to the full channel, as when the batch reaches d.
+    batch_estimator->appendEntropy(*minimizer->getEntropy());
+    double Rsquared = batch_estimator->exponentialFit();
+    bool exponential = Rsquared > SUBSAMPLING_RSQUARED_THRESHOLD && batch_estimator->model_params[1] < 0;
+    kraus_batch = std::ceil(kraus_batch*config->subsampling_growth);
+    if (exponential || kraus_batch >= d){
+        oss.str("");
+        oss << "[Iteration " << current_iteration << "] Switching to the full channel: " << (exponential ? "the entropy decays exponentially." : "the batch covers all Kraus operators.");
+        message_handler->message(oss.str());
+        kraus_batch = 0;
+        subsampling_end = current_iteration;
+        // The final entropy is predicted from full channel steps only
+        entropy_estimator->reset();
+        entropy_estimator->appendEntropy(*minimizer->getEntropy());
+    }
+    minimizer->setKrausBatch(kraus_batch);
     return 0;
 }
 
+int EntropyMinimizer::racePortfolio(){
+    // Step 1: build the variants on first use. They registered themselves as signal handler targets: take it back.
+    if (portfolio == nullptr){
+        portfolio = new Portfolio(kraus_operators, d, N, M, config);
+        self = this;
+        int info = portfolio->loadStatistics();
+        if (info == 0){
+            message_handler->message("Loaded portfolio statistics from " + config->portfolio_stats_file + ".");
+        } else if (info == 2){
+            message_handler->message("The portfolio statistics in " + config->portfolio_stats_file + " do not parse. Racing without them, and keeping the file aside when saving.", LOG_LEVEL_WARNING);
+        }
+    }
+
+    // Step 2: race from the current vector
+    message_handler->message("Racing the portfolio...");
+    int winner = portfolio->race(*minimizer->getVectorState(), run_stream, this);
+    message_handler->message(portfolio->describe());
+    message_handler->message("Winner: " + portfolio->getName(winner) + ".");
+
+    // Step 3: continue from the winner's result
+    *minimizer->getVectorState() = portfolio->getVector(winner);
+    minimizer->calculateEntropy();
+    current_iteration = portfolio->getIterations(winner);
+    updateMOE(*minimizer->getEntropy());
+
+    // Step 4: record the winner, so that later runs on similar channels can start with it
+    int info = portfolio->saveStatistics();
+    if (info == 1){
+        message_handler->message("Could not save portfolio statistics to " + config->portfolio_stats_file + ".", LOG_LEVEL_WARNING);
+    } else if (info == 2){
+        message_handler->message("The portfolio statistics in " + config->portfolio_stats_file + " did not parse. They were moved to " + config->portfolio_stats_file + ".corrupt and started over.", LOG_LEVEL_WARNING);
+    }
+    return winner;
+}
+
+int EntropyMinimizer::stepBeam(){
+    // Step 1: the beam starts from the current vector
+    if (beam.empty()){
+        beam.push_back(*minimizer->getVectorState());
+    }
+
+    // Step 2: branch every vector of the beam on the top eigenvectors of its step operator, and rank the branches by entropy.
+    // The first branch of the best vector is the plain step, so the best entropy can only decrease.
+    std::vector<std::vector<std::complex<double> > > candidates;
+    std::vector<double> entropies;
+    std::vector<std::complex<double> > branches;
+    for (const std::vector<std::complex<double> >& member : beam){
+        *minimizer->getVectorState() = member;
+        int count = minimizer->branchVectors(config->beam_branches, &branches);
+        for (int j=0; j<count; j++){
+            candidates.push_back(std::vector<std::complex<double> >(branches.begin()+N*j, branches.begin()+N*(j+1)));
+            *minimizer->getVectorState() = candidates.back();
+            minimizer->calculateEntropy();
+            entropies.push_back(*minimizer->getEntropy());
+        }
+    }
+    std::vector<int> order(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&entropies](int a, int b){ return entropies.at(a) < entropies.at(b); });
+
+    // Step 3: keep the best beam_width distinct branches. Branches that coincide have merged: only the best copy is kept.
+    beam.clear();
+    for (int c : order){
+        if (beam.size() >= config->beam_width){
+            break;
+        }
+        bool merged = false;
+        for (const std::vector<std::complex<double> >& member : beam){
+            std::complex<double> overlap;
+            cblas_zdotc_sub(N, reinterpret_cast<const lapack_complex_t*>(member.data()), 1,
+                reinterpret_cast<const lapack_complex_t*>(candidates.at(c).data()), 1, reinterpret_cast<lapack_complex_t*>(&overlap));
+            if (std::abs(overlap) > BEAM_MERGE_FIDELITY){
+                merged = true;
+                break;
+            }
+        }
+        if (!merged){
+            beam.push_back(candidates.at(c));
+        }
+    }
+
+    // Step 4: the minimizer follows the best branch
+    *minimizer->getVectorState() = beam.front();
+    minimizer->calculateEntropy();
+    return 0;
+}
+
+int EntropyMinimizer::updateMOE(double entropy){
+    // Estimated entropies can be slightly below the true value: only exact ones make it into the MOE
+    if (!minimizer->isEntropyExact()){
+        return 0;
+    }
+    if (MOE < 0 || entropy < MOE){
+        MOE = entropy;
+        MOE_vector = *minimizer->getVectorState();
+        return 1;
+    }
+    return 0;
+}
+
+int EntropyMinimizer::exactEntropyCheck(){
+    // Nothing to do if the entropy is not estimated
+    if (minimizer->isEntropyExact()){
+        return 0;
+    }
+    double estimate = *minimizer->getEntropy();
+    minimizer->calculateExactEntropy();
+    oss.str("");
+    oss << "[Iteration " << current_iteration << "] Exact entropy: " << std::fixed << std::setprecision(PRINT_PRECISION) << *minimizer->getEntropy() << " (estimated: " << estimate << ", standard error " << std::scientific << std::setprecision(2) << slq_estimator->getStandardError() << " with " << slq_estimator->getProbesUsed() << " probes)";
+    message_handler->message(oss.str());
+    updateMOE(*minimizer->getEntropy());
+    return 1;
+}
+
+int EntropyMinimizer::exactWindowCheck(){
+    if (window_entropy >= 0 && current_iteration - window_iteration < CONVERGENCE_ITERS){
+        return 0;
+    }
+    minimizer->calculateExactEntropy();
+    double entropy = *minimizer->getEntropy();
+    updateMOE(entropy);
+    double previous = window_entropy;
+    window_entropy = entropy;
+    window_iteration = current_iteration;
+    // Same criterion as the window over exact entropies: an increase, or less than CONVERGENCE_TOLERANCE per iteration, stops the run
+    if (previous >= 0 && (previous - entropy) / CONVERGENCE_ITERS < CONVERGENCE_TOLERANCE){
+        return 1;
+    }
+    return 0;
+}
+
+int EntropyMinimizer::reportEstimateNoise(){
+    if (estimate_noise_reported || minimizer->isEntropyExact() || slq_estimator == nullptr){
+        return 0;
+    }
+    if (slq_estimator->getProbesUsed() < config->slq_max_probes || slq_estimator->getStandardError() <= config->slq_tolerance){
+        return 0;
+    }
+    estimate_noise_reported = true;
+    oss.str("");
+    oss << "[Iteration " << current_iteration << "] The entropy estimate still has a standard error of " << std::scientific << std::setprecision(2)
+        << slq_estimator->getStandardError() << " after " << slq_estimator->getProbesUsed() << " probes, above the tolerance of " << config->slq_tolerance
+        << ". Estimates only show progress; convergence is decided on exact entropies every " << CONVERGENCE_ITERS << " iterations.";
+    message_handler->message(oss.str(), LOG_LEVEL_WARNING);
+    return 1;
+}
+
+int EntropyMinimizer::perturbVector(std::vector<std::complex<double> >* vector, double step, RandomStream* stream){
+    // Step 1: uniformly random direction, from a complex Gaussian vector
+    std::vector<std::complex<double> > direction(vector->size());
+    stream->fillComplexNormal(direction.data(), direction.size());
+    double norm = cblas_dznrm2(direction.size(), reinterpret_cast<lapack_complex_t*>(direction.data()), 1);
+
+    // Step 2: add it with norm step, and go back to the sphere
+    std::complex<double> scale(step/norm, 0.0f);
+    cblas_zaxpy(direction.size(), reinterpret_cast<lapack_complex_t*>(&scale),
+        reinterpret_cast<lapack_complex_t*>(direction.data()), 1,
+        reinterpret_cast<lapack_complex_t*>(vector->data()), 1);
+    norm = cblas_dznrm2(vector->size(), reinterpret_cast<lapack_complex_t*>(vector->data()), 1);
+    for (int i=0; i<vector->size(); i++){
+        vector->at(i) /= norm;
+    }
+    return 0;
+}
+
+double EntropyMinimizer::getMOE(){
+    return MOE;
+}
+
+std::vector<std::complex<double> > EntropyMinimizer::getMOEVector(){
+    return MOE_vector;
+}
+
 int EntropyMinimizer::saveState(std::string filename){
     // First, get the state of the minimizer
     std::vector<std::complex<double> >* state = minimizer->getState();
     // Create temporary filename (make operation atomic)
     std::string tmp_filename = filename + ".tmp";
     // Then, serialize the state.  
-    serializer->serialize("vector", tmp_filename, *state, "Save state, custom path", 1, minimizer->getN());
+    serializer->serialize("vector", tmp_filename, *state, "Save state, custom path", 1, minimizer->getN(), vectorMetadata());
     // Rename the file
     std::filesystem::rename(tmp_filename, filename);
     // Print message
@@ -399,26 +1127,511 @@ int EntropyMinimizer::saveState(std::string filename){
 }
 
 int EntropyMinimizer::saveVector(std::string filename){
-    // First, get the vector from the minimizer
-    std::vector<std::complex<double> > vec = minimizer->getVector();
-    // Create temporary filename (make operation atomic)
-    std::string tmp_filename = filename + ".tmp";
-    // Then, serialize the vector.    
-    serializer->serialize("vector", tmp_filename, vec, "Save state, custom path", 1, minimizer->getN());
-    // Rename the file
-    std::filesystem::rename(tmp_filename, filename);
-    // Print message
+    return submitVector(filename, "Save state, custom path");
+}
+
+int EntropyMinimizer::submitVector(std::string filename, std::string description, VectorCollection* target){
+    if (checkpoint_writer == nullptr){
+        checkpoint_writer = new CheckpointWriter();
+    }
+    // Failures of earlier writes are only known now
+    for (const std::string& error : checkpoint_writer->takeErrors()){
+        message_handler->message(error, LOG_LEVEL_WARNING);
+    }
+    // The current vector is copied as it is: no need to recover it from the projector. Writing happens on the writer's thread.
+    int replaced = checkpoint_writer->submit("vector", *minimizer->getVectorState(), filename, description, 1, minimizer->getN(), vectorMetadata(), target);
     oss.str("");
-    oss << "Vector saved to " << filename;
+    oss << "Vector queued for saving to " << filename;
+    if (replaced){
+        oss << " (the previous checkpoint was still waiting and is skipped)";
+    }
     message_handler->message(oss.str());
     return 0;
+}
+
+int EntropyMinimizer::flushCheckpoints(){
+    std::vector<std::string> errors;
+    if (ledger != nullptr){
+        try {
+            ledger->sync();
+        } catch (const std::exception& e){
+            message_handler->message(e.what(), LOG_LEVEL_WARNING);
+            errors.push_back(e.what());
+        }
+    }
+    for (CheckpointWriter* writer : {checkpoint_writer, snapshot_writer}){
+        if (writer == nullptr){
+            continue;
+        }
+        writer->flush();
+        for (const std::string& error : writer->takeErrors()){
+            message_handler->message(error, LOG_LEVEL_WARNING);
+            errors.push_back(error);
+        }
+    }
+    // After the checkpoint writer, which may have appended to it
+    if (collection != nullptr){
+        try {
+            collection->sync();
+        } catch (const std::exception& e){
+            message_handler->message(e.what(), LOG_LEVEL_WARNING);
+            errors.push_back(e.what());
+        }
+    }
+    return errors.empty() ? 0 : 1;
+}
+
+int EntropyMinimizer::resetSearch(){
+    search.attempt = 0;
+    search.in_attempt = false;
+    search.start_entropy = -1;
+    search.predict_stop = false;
+    search.basin = -1;
+    search.hop_move = false;
+    search.hop_return = false;
+    search.hop_vector.clear();
+    search.hop_entropy = -1;
+    search.hop_step = config->hopping_step;
+    search.hop_moves = 0;
+    search.hop_accepted = 0;
+    search.window_moves = 0;
+    search.window_accepted = 0;
+    for (int kind=0; kind<2; kind++){
+        search.start_entropies[kind].clear();
+        search.final_entropies[kind].clear();
+    }
+    return 0;
+}
+
+json EntropyMinimizer::trajectoryConfig(){
+    // Not the iteration and attempt limits, nor the checkpoints and messages: a resumed search may change those
+    return {
+        {"epsilon", config->epsilon},
+        {"objective", config->objective},
+        {"renyi_p", config->renyi_p},
+        {"convergence", config->convergence},
+        {"start_sequence", config->start_sequence},
+        {"channel_start_count", config->channel_start_count},
+        {"slq", {config->use_slq, config->slq_max_probes, config->slq_lanczos_steps, config->slq_tolerance}},
+        {"subsampling", {config->use_subsampling, config->subsampling_batch, config->subsampling_growth}},
+        {"beam", {config->beam_width, config->beam_branches}},
+        {"overrelaxation", config->use_overrelaxation},
+        {"dedup", {config->use_dedup, config->dedup_interval}},
+        {"hopping", {config->use_hopping, config->hopping_step, config->hopping_temperature, config->hopping_restart_ratio, config->hopping_iterations}},
+        {"prediction", {config->MOE_use_prediction, config->MOE_prediction_tolerance}}
+    };
+}
+
+int EntropyMinimizer::openLedger(std::string filename){
+    // Step 1: open it, or create it with what identifies the search
+    json header = {
+        {"ledger_version", LEDGER_VERSION},
+        {"seed", getRandomSeed()},
+        {"channel", {{"d", d}, {"N", N}, {"M", M}}},
+        {"config", trajectoryConfig()}
+    };
+    ledger = new AttemptLedger();
+    int records;
+    try {
+        records = ledger->open(filename, header);
+    } catch (const std::exception& e){
+        message_handler->message("Could not use the ledger: " + std::string(e.what()), LOG_LEVEL_WARNING);
+        delete ledger;
+        ledger = nullptr;
+        return 1;
+    }
+    message_handler->message("Recording attempts in " + filename + ".");
 
+    // Step 2: continue after the attempts it has, unless a snapshot restored the search already
+    if (records == 0 || resume_pending){
+        return 0;
+    }
+    if (ledger->getHeader().value("seed", json()) != header.at("seed")){
+        message_handler->message("The random seed differs from the one of the ledger: the next attempts will not draw the numbers they would have.", LOG_LEVEL_WARNING);
+    }
+    if (ledger->getHeader().value("config", json()) != header.at("config")){
+        message_handler->message("The configuration differs from the one of the ledger.", LOG_LEVEL_WARNING);
+    }
+    return replayLedger();
+}
+
+int EntropyMinimizer::replayLedger(){
+    // Step 1: go through the attempts as findMOE did, to rebuild what the next ones depend on: the MOE, the known minima, the
+    // position of the start sequences and the basin hopping state
+    resetSearch();
+    long halton_starts = 0;
+    try {
+        for (const json& record : ledger->getRecords()){
+            std::vector<std::complex<double> > vector = AttemptLedger::decodeVector(record.at("vector"));
+            double entropy = record.at("entropy").get<double>();
+            std::string start = record.at("start").get<std::string>();
+            std::string outcome = record.at("outcome").get<std::string>();
+            int minimum = record.at("minimum").get<int>();
+            channel_starts_used += start == "channel";
+            halton_starts += start == "halton";
+            run_count = std::max<uint64_t>(run_count, record.at("stream").get<uint64_t>() + 1);
+            MOE = record.at("MOE").get<double>();
+            if (record.contains("MOE_vector")){
+                MOE_vector = AttemptLedger::decodeVector(record.at("MOE_vector"));
+            }
+            if (outcome == "converged"){
+                minima_registry->registerMinimum(vector, entropy);
+            } else if (outcome == "basin"){
+                minima_registry->recordBasinHit(minimum);
+            }
+            double final_entropy = outcome == "basin" ? minima_registry->getEntropy(minimum) : entropy;
+            if (config->compare_starts){
+                search.start_entropies[start == "channel"].push_back(record.at("start_entropy").get<double>());
+                search.final_entropies[start == "channel"].push_back(final_entropy);
+            }
+            if (record.contains("hop")){
+                const json& hop = record.at("hop");
+                bool accepted = hop.at("accepted").get<bool>();
+                // A move that fell back into the basin of the state kept it
+                if (accepted && outcome != "returned"){
+                    search.hop_vector = outcome == "basin" ? minima_registry->getVector(minimum) : vector;
+                    search.hop_entropy = final_entropy;
+                }
+                if (hop.at("move").get<bool>()){
+                    search.hop_moves += 1;
+                    search.window_moves += 1;
+                    search.hop_accepted += accepted;
+                    search.window_accepted += accepted;
+                }
+                if (search.window_moves == HOPPING_ADAPT_INTERVAL){
+                    search.window_moves = 0;
+                    search.window_accepted = 0;
+                }
+                search.hop_step = hop.at("step").get<double>();
+            }
+            search.attempt = record.at("attempt").get<int>() + 1;
+        }
+    } catch (const std::exception& e){
+        message_handler->message("Could not continue after the attempts of the ledger: " + std::string(e.what()), LOG_LEVEL_WARNING);
+        return 1;
+    }
+
+    // Step 2: the start sequences continue after the starts that were used
+    if (start_sequence != nullptr){
+        start_sequence->setNextIndex(1 + halton_starts);
+    }
+    if (channel_starts_used > 0){
+        rankChannelStarts();
+        start_generator->setPosition(channel_starts_used);
+    }
+
+    search.in_attempt = false;
+    resume_pending = true;
+    oss.str("");
+    oss << "Continuing after the " << ledger->getRecords().size() << " attempts of the ledger, MOE so far " << std::fixed << std::setprecision(PRINT_PRECISION) << MOE << ".";
+    message_handler->message(oss.str());
+    return 0;
+}
+
+int EntropyMinimizer::recordAttempt(int attempt, std::string outcome, int minimum, bool accepted, double duration, bool new_MOE){
+    // The random draws of the attempt are those of stream run_stream under the seed
+    std::string start = search.hop_move ? "hop" : run_channel_start ? "channel" : start_sequence != nullptr ? "halton" : "random";
+    json record = {
+        {"attempt", attempt},
+        {"seed", getRandomSeed()},
+        {"stream", run_stream},
+        {"start", start},
+        {"start_entropy", search.start_entropy},
+        {"entropy", *minimizer->getEntropy()},
+        {"iterations", current_iteration},
+        {"duration", duration},
+        {"outcome", outcome},
+        {"minimum", minimum},
+        {"vector", AttemptLedger::encodeVector(*minimizer->getVectorState())},
+        {"MOE", MOE}
+    };
+    // The MOE is the lowest entropy seen at any iteration, not necessarily at the end of an attempt
+    if (new_MOE){
+        record["MOE_vector"] = AttemptLedger::encodeVector(MOE_vector);
+    }
+    if (config->use_hopping){
+        record["hop"] = {{"move", search.hop_move}, {"accepted", accepted}, {"step", search.hop_step}};
+    }
+    try {
+        ledger->append(record);
+    } catch (const std::exception& e){
+        message_handler->message(e.what(), LOG_LEVEL_WARNING);
+        return 1;
+    }
+    return 0;
+}
+
+int EntropyMinimizer::openCollection(std::string filename){
+    collection = new VectorCollection();
+    int vectors;
+    try {
+        vectors = collection->open(filename, true);
+    } catch (const std::exception& e){
+        message_handler->message("Could not use the collection: " + std::string(e.what()), LOG_LEVEL_WARNING);
+        delete collection;
+        collection = nullptr;
+        return 1;
+    }
+    collection_file = filename;
+    message_handler->message("Saving vectors to collection " + filename + ", which holds " + std::to_string(vectors) + " vectors.");
+    return 0;
+}
+
+int EntropyMinimizer::collectAttempt(int attempt, std::string outcome){
+    json metadata = vectorMetadata();
+    metadata["attempt"] = attempt;
+    metadata["outcome"] = outcome;
+    try {
+        collection->append("vector", *minimizer->getVectorState(), "Final vector of an attempt", 1, minimizer->getN(), metadata);
+    } catch (const std::exception& e){
+        message_handler->message("The vector of the attempt could not be saved: " + std::string(e.what()), LOG_LEVEL_WARNING);
+        return 1;
+    }
+    return 0;
+}
+
+json EntropyMinimizer::vectorMetadata(){
+    return {
+        {"rng", rngMetadata(RNG_DOMAIN_START_VECTOR, run_stream, 1)},
+        {"entropy", *minimizer->getEntropy()},
+        {"iteration", current_iteration},
+        {"run_id", run_id}
+    };
+}
+
+int EntropyMinimizer::saveSnapshot(bool search_mode, bool in_attempt){
+    if (snapshot_writer == nullptr){
+        snapshot_writer = new CheckpointWriter();
+    }
+    for (const std::string& error : snapshot_writer->takeErrors()){
+        message_handler->message(error, LOG_LEVEL_WARNING);
+    }
+
+    // Step 1: the vectors, one after the other: the current one, the MOE vector, the beam, the basin hopping state and the known minima
+    std::vector<std::complex<double> > vectors(*minimizer->getVectorState());
+    auto append = [&vectors](const std::vector<std::complex<double> >& vector){
+        vectors.insert(vectors.end(), vector.begin(), vector.end());
+    };
+    append(MOE_vector);
+    for (const std::vector<std::complex<double> >& member : beam){
+        append(member);
+    }
+    append(search.hop_vector);
+    std::vector<double> minima_entropies;
+    std::vector<int> minima_hits, minima_basin_hits;
+    for (int m=0; m<minima_registry->getMinimaCount(); m++){
+        append(minima_registry->getVector(m));
+        minima_entropies.push_back(minima_registry->getEntropy(m));
+        minima_hits.push_back(minima_registry->getHits(m));
+        minima_basin_hits.push_back(minima_registry->getBasinHits(m));
+    }
+
+    // Step 2: everything else. Doubles are stored bit for bit.
+    json run = {
+        {"id", run_id},
+        {"count", run_count},
+        {"stream", run_stream},
+        {"iteration", current_iteration},
+        {"previous_gain", encodeDouble(previous_gain)},
+        {"window_entropy", encodeDouble(window_entropy)},
+        {"window_iteration", window_iteration},
+        {"entropy_buffer", encodeDoubles(entropy_buffer, CONVERGENCE_ITERS)},
+        {"kraus_batch", kraus_batch},
+        {"subsampling_end", subsampling_end},
+        {"channel_start", run_channel_start},
+        {"channel_starts_used", channel_starts_used},
+        {"channel_start_position", start_generator != nullptr ? start_generator->getPosition() : -1},
+        {"halton_index", start_sequence != nullptr ? start_sequence->getNextIndex() : 0},
+        {"MOE", encodeDouble(MOE)},
+        {"minimizer", minimizer->getSnapshot()},
+        {"estimator", entropy_estimator->getSnapshot()},
+        {"batch_estimator", batch_estimator->getSnapshot()}
+    };
+    json search_state = {
+        {"attempt", search.attempt},
+        {"in_attempt", in_attempt},
+        {"start_entropy", encodeDouble(search.start_entropy)},
+        {"predict_stop", search.predict_stop},
+        {"basin", search.basin},
+        {"hop_move", search.hop_move},
+        {"hop_return", search.hop_return},
+        {"hop_entropy", encodeDouble(search.hop_entropy)},
+        {"hop_step", encodeDouble(search.hop_step)},
+        {"hop_counts", {search.hop_moves, search.hop_accepted, search.window_moves, search.window_accepted}},
+        {"start_entropies", {encodeDoubles(search.start_entropies[0].data(), search.start_entropies[0].size()), encodeDoubles(search.start_entropies[1].data(), search.start_entropies[1].size())}},
+        {"final_entropies", {encodeDoubles(search.final_entropies[0].data(), search.final_entropies[0].size()), encodeDoubles(search.final_entropies[1].data(), search.final_entropies[1].size())}},
+        {"minima_entropies", encodeDoubles(minima_entropies.data(), minima_entropies.size())},
+        {"minima_hits", minima_hits},
+        {"minima_basin_hits", minima_basin_hits}
+    };
+    json snapshot = {
+        {"snapshot_version", "1.0"},
+        {"mode", search_mode ? "search" : "single"},
+        {"seed", getRandomSeed()},
+        {"channel", {{"d", d}, {"N", N}, {"M", M}}},
+        {"config", trajectoryConfig()},
+        {"vectors", {{"moe", MOE_vector.empty() ? 0 : 1}, {"beam", beam.size()}, {"hop", search.hop_vector.empty() ? 0 : 1}, {"minima", minima_registry->getMinimaCount()}}},
+        {"run", run},
+        {"search", search_state}
+    };
+
+    // Step 3: written from the snapshot writer's thread
+    int replaced = snapshot_writer->submit("state", vectors, config->snapshot_file, "Run snapshot", vectors.size()/N, N, {{"snapshot", snapshot}});
+    oss.str("");
+    oss << "[Iteration " << current_iteration << "] Snapshot queued for saving to " << config->snapshot_file;
+    if (replaced){
+        oss << " (the previous snapshot was still waiting and is skipped)";
+    }
+    message_handler->message(oss.str());
+    return 0;
+}
+
+int EntropyMinimizer::loadSnapshot(std::string filename, bool search_mode){
+    try {
+        // Step 1: read the file, and check that it belongs to this channel and to this kind of run
+        MappedData data = serializer->map(filename, true);
+        if (data.type != "state" || !data.metadata.contains("snapshot")){
+            message_handler->message(filename + " is not a snapshot.", LOG_LEVEL_WARNING);
+            return 1;
+        }
+        const json& snapshot = data.metadata.at("snapshot");
+        const json& channel = snapshot.at("channel");
+        if (channel.at("d").get<int>() != d || channel.at("N").get<int>() != N || channel.at("M").get<int>() != M){
+            message_handler->message("The snapshot " + filename + " was taken on a channel of different dimensions.", LOG_LEVEL_WARNING);
+            return 1;
+        }
+        if (snapshot.at("mode").get<std::string>() != (search_mode ? "search" : "single")){
+            message_handler->message("The snapshot " + filename + " was taken by " + (search_mode ? "singleshot" : "multishot") + ", it cannot be resumed here.", LOG_LEVEL_WARNING);
+            return 1;
+        }
+        // The same seed and configuration are needed for the resumed search to be the one that was stopped. Otherwise it is merely continued.
+        if (snapshot.at("seed").get<uint64_t>() != getRandomSeed()){
+            message_handler->message("The random seed differs from the one of the snapshot: the resumed run will not draw the same numbers.", LOG_LEVEL_WARNING);
+        }
+        if (snapshot.at("config") != trajectoryConfig()){
+            message_handler->message("The configuration differs from the one of the snapshot: the resumed run will not take the same steps.", LOG_LEVEL_WARNING);
+        }
+
+        // Step 2: the starting vectors. Ranking the channel-informed ones moves the minimizer, so it comes before the vectors.
+        const json& run = snapshot.at("run");
+        int position = run.at("channel_start_position").get<int>();
+        if (position >= 0){
+            delete start_generator;
+            rankChannelStarts();
+            start_generator->setPosition(position);
+        }
+        if (start_sequence != nullptr){
+            start_sequence->setNextIndex(run.at("halton_index").get<long>());
+        }
+
+        // Step 3: the vectors, in the order of saveSnapshot
+        const json& counts = snapshot.at("vectors");
+        int moe_count = counts.at("moe").get<int>();
+        int beam_count = counts.at("beam").get<int>();
+        int hop_count = counts.at("hop").get<int>();
+        int minima_count = counts.at("minima").get<int>();
+        if (data.view.size() != size_t(N)*(1 + moe_count + beam_count + hop_count + minima_count)){
+            throw std::runtime_error("The number of vectors does not match the metadata.");
+        }
+        const std::complex<double>* next = data.view.data();
+        auto take = [&next, this](){
+            std::vector<std::complex<double> > vector(next, next + N);
+            next += N;
+            return vector;
+        };
+        *minimizer->getVectorState() = take();
+        MOE_vector = moe_count > 0 ? take() : std::vector<std::complex<double> >();
+        beam.clear();
+        for (int b=0; b<beam_count; b++){
+            beam.push_back(take());
+        }
+        search.hop_vector = hop_count > 0 ? take() : std::vector<std::complex<double> >();
+        const json& saved_search = snapshot.at("search");
+        std::vector<double> minima_entropies(minima_count);
+        decodeDoubles(saved_search.at("minima_entropies"), minima_entropies.data(), minima_count);
+        std::vector<int> minima_hits = saved_search.at("minima_hits").get<std::vector<int> >();
+        std::vector<int> minima_basin_hits = saved_search.at("minima_basin_hits").get<std::vector<int> >();
+        minima_registry->reset();
+        for (int m=0; m<minima_count; m++){
+            minima_registry->restoreMinimum(take(), minima_entropies.at(m), minima_hits.at(m), minima_basin_hits.at(m));
+        }
+
+        // Step 4: the run
+        run_id = run.at("id").get<std::string>();
+        run_count = run.at("count").get<uint64_t>();
+        run_stream = run.at("stream").get<uint64_t>();
+        current_iteration = run.at("iteration").get<int>();
+        previous_gain = decodeDouble(run.at("previous_gain"));
+        window_entropy = run.contains("window_entropy") ? decodeDouble(run.at("window_entropy")) : -1;
+        window_iteration = run.value("window_iteration", 0);
+        decodeDoubles(run.at("entropy_buffer"), entropy_buffer, CONVERGENCE_ITERS);
+        kraus_batch = run.at("kraus_batch").get<int>();
+        subsampling_end = run.at("subsampling_end").get<int>();
+        run_channel_start = run.at("channel_start").get<bool>();
+        channel_starts_used = run.at("channel_starts_used").get<int>();
+        MOE = decodeDouble(run.at("MOE"));
+        minimizer->restoreSnapshot(run.at("minimizer"));
+        minimizer->setKrausBatch(kraus_batch);
+        entropy_estimator->restoreSnapshot(run.at("estimator"));
+        batch_estimator->restoreSnapshot(run.at("batch_estimator"));
+
+        // Step 5: the search
+        search.attempt = saved_search.at("attempt").get<int>();
+        search.in_attempt = saved_search.at("in_attempt").get<bool>();
+        search.start_entropy = decodeDouble(saved_search.at("start_entropy"));
+        search.predict_stop = saved_search.at("predict_stop").get<bool>();
+        search.basin = saved_search.at("basin").get<int>();
+        search.hop_move = saved_search.at("hop_move").get<bool>();
+        search.hop_return = saved_search.value("hop_return", false);
+        search.hop_entropy = decodeDouble(saved_search.at("hop_entropy"));
+        search.hop_step = decodeDouble(saved_search.at("hop_step"));
+        std::vector<int> hop_counts = saved_search.at("hop_counts").get<std::vector<int> >();
+        search.hop_moves = hop_counts.at(0);
+        search.hop_accepted = hop_counts.at(1);
+        search.window_moves = hop_counts.at(2);
+        search.window_accepted = hop_counts.at(3);
+        for (int kind=0; kind<2; kind++){
+            const json& saved_start = saved_search.at("start_entropies").at(kind);
+            const json& saved_final = saved_search.at("final_entropies").at(kind);
+            search.start_entropies[kind].resize(saved_start.size());
+            search.final_entropies[kind].resize(saved_final.size());
+            decodeDoubles(saved_start, search.start_entropies[kind].data(), saved_start.size());
+            decodeDoubles(saved_final, search.final_entropies[kind].data(), saved_final.size());
+        }
+    } catch (const std::exception& e){
+        message_handler->message("Could not resume from " + filename + ": " + e.what(), LOG_LEVEL_WARNING);
+        return 1;
+    }
+
+    resume_pending = true;
+    oss.str("");
+    oss << "Resuming from " << filename << " at iteration " << current_iteration;
+    if (search_mode){
+        oss << " of attempt " << search.attempt+1;
+    }
+    oss << ", MOE so far " << std::fixed << std::setprecision(PRINT_PRECISION) << MOE << ".";
+    message_handler->message(oss.str());
+    return 0;
 }
 
 int EntropyMinimizer::saveState(){
     // Save the state of the minimizer to a file.
     // First, get the state of the minimizer
     std::vector<std::complex<double> >* state = minimizer->getState();
+    // With a collection, it goes there instead of a file of its own
+    if (collection != nullptr){
+        try {
+            int index = collection->append("vector", *state, "Save state", 1, minimizer->getN(), vectorMetadata());
+            collection->sync();
+            oss.str("");
+            oss << "State saved to " << collection_file << " as vector #" << index << ".";
+            message_handler->message(oss.str());
+        } catch (const std::exception& e){
+            message_handler->message("The state could not be saved: " + std::string(e.what()), LOG_LEVEL_WARNING);
+            return 1;
+        }
+        return 0;
+    }
     // Now, serialize the state
     // File is is SAVE_DIRECTORY/VECTORS_DIRECTORY/minimizer_id/run_id/state_timestamp.dat
     // use a path object then convert to string
@@ -440,7 +1653,7 @@ int EntropyMinimizer::saveState(){
     // create the tmp filename (make the operation atomic)
     std::string tmp_filename = save_path.string() + "/state_" + timestamp + ".tmp";
     // serialize    
-    serializer->serialize("vector", tmp_filename, *state,"Save state", 1, minimizer->getN());
+    serializer->serialize("vector", tmp_filename, *state,"Save state", 1, minimizer->getN(), vectorMetadata());
     // rename the file
     std::filesystem::rename(tmp_filename, filename);
 
@@ -452,10 +1665,11 @@ int EntropyMinimizer::saveState(){
 }
 
 int EntropyMinimizer::saveVector(){
+    // With a collection, the vector goes there instead of a file of its own
+    if (collection != nullptr){
+        return submitVector(collection_file, "Save state", collection);
+    }
     // Save the vector from the minimizer to a file.
-    // First, get the vector from the minimizer
-    std::vector<std::complex<double> > vec = minimizer->getVector();
-    // Now, serialize the state
     // File is is SAVE_DIRECTORY/VECTORS_DIRECTORY/minimizer_id/run_id/state_timestamp.dat
     // use a path object then convert to string
     std::filesystem::path save_path = std::filesystem::path(SAVE_DIRECTORY) / std::filesystem::path(VECTORS_DIRECTORY) / std::filesystem::path(minimizer_id) / std::filesystem::path(run_id);
@@ -474,18 +1688,7 @@ int EntropyMinimizer::saveVector(){
     // create the filename
     std::string filename = save_path.string() + "/vec_" + timestamp + ".dat";
 
-    // create the tmp filename (make the operation atomic)
-    std::string tmp_filename = save_path.string() + "/vec_" + timestamp + ".tmp";
-    // serialize    
-    serializer->serialize("vector", tmp_filename, vec,"Save state", 1, minimizer->getN());
-    // rename the file
-    std::filesystem::rename(tmp_filename, filename);
-
-    // Print message
-    oss.str("");
-    oss << "Vector saved to " << filename;
-    message_handler->message(oss.str());
-    return 0;
+    return submitVector(filename, "Save state");
 }
 
 void EntropyMinimizer::requestTerminate(){
@@ -506,9 +1709,19 @@ EntropyMinimizer* EntropyMinimizer::self = nullptr;
 
 EntropyMinimizer::~EntropyMinimizer()
 {
+    delete checkpoint_writer; // Writes the last checkpoint first
+    delete snapshot_writer;
+    delete ledger; // Syncs it
+    delete collection; // Also synced, after the checkpoint writer is done with it
     delete minimizer;
     delete serializer;
     delete entropy_estimator;
+    delete batch_estimator;
+    delete start_sequence;
+    delete start_generator;
+    delete portfolio;
+    delete minima_registry;
+    delete slq_estimator;
 
 }
 
@@ -1,35 +1,113 @@
 #include "common_includes.h"
 #include "matrix_operations.h"
 #include "generate_haar_unitary.h"
+#include "rng.h"
 
-std::vector<std::complex<double> >* generateHaarRandomUnitary(int N){
-    // Step 0: Initialize output
+std::vector<std::complex<double> >* generateHaarRandomUnitary(int N, uint64_t stream_index){
     std::vector<std::complex<double> >* out = new std::vector<std::complex<double> >(N*N);
+    HaarWorkspace workspace;
+    generateHaarRandomUnitary(N, stream_index, out, &workspace);
+    return out;
+}
+
+int generateHaarRandomUnitary(int N, uint64_t stream_index, std::vector<std::complex<double> >* out, HaarWorkspace* workspace){
+    // Step 0: Initialize output
+    out->resize(N*N);
     // Step 1: Set up random number generator
-    std::random_device rd;                  // Random device to seed the generator
-    std::mt19937 gen(rd());                 // Mersenne Twister generator, seeded by rd()
-    std::normal_distribution<double> dist(0.0f, 1.0f); // Normal distribution with mean and stddev
+    RandomStream stream(RNG_DOMAIN_HAAR, stream_index);
 
     // Step 2: Generate random real and imaginary parts
-    for (int i=0; i < N*N; i++){
-        double real_part = dist(gen);  // Generate the real part (normal distribution)
-        double imag_part = dist(gen);  // Generate the imaginary part (normal distribution)
-        out->at(i) = std::complex<double>(real_part, imag_part);
+    stream.fillComplexNormal(out->data(), N*N);
+
+    // Step 3: Query the optimal work size of the QR decomposition and of the reconstruction of Q, once per workspace
+    std::vector<std::complex<double> >& tau = workspace->tau;
+    std::vector<std::complex<double> >& work = workspace->work;
+    if (tau.size() != N || work.empty()){
+        tau.resize(N);
+        std::complex<double> qr_size, q_size;
+        zgeqrfp_wrapper(N, N, out, N, &tau, &qr_size, -1);
+        zungqr_wrapper(N, N, N, out, N, &tau, &q_size, -1);
+        work.resize(std::max(1, std::max(static_cast<int>(qr_size.real()), static_cast<int>(q_size.real()))));
     }
 
-    // Step 3: Perform QR decomposition
-    std::vector<std::complex<double> > tau(N);
-    std::complex<double> work_size;
-    // Query the optimal work size    
-    zgeqrfp_wrapper(N, N, out, N, &tau, &work_size,-1);
-    // Actually perform QR
-    int lwork = static_cast<int>(work_size.real());
-    std::vector<std::complex<double>> work(lwork);
-    zgeqrfp_wrapper(N, N, out, N, &tau, &work, lwork);
-    // Query optimal work size to reconstruct Q
-    zungqr_wrapper(N,N,N,out,N,&tau,&work_size,-1);
-    lwork = static_cast<int>(work_size.real());
-    work.resize(lwork);
-    zungqr_wrapper(N,N,N,out,N,&tau,&work, lwork);
+    // Step 4: Perform QR, and reconstruct Q
+    zgeqrfp_wrapper(N, N, out, N, &tau, &work, work.size());
+    zungqr_wrapper(N, N, N, out, N, &tau, &work, work.size());
+    return 0;
+}
+
+int generateHaarChannel(int N, int d, int threads, VectorStreamWriter* writer){
+    if (threads <= 0){
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, d);
+    size_t operator_size = size_t(N)*N;
+    int batch = std::max<size_t>(threads, std::min<size_t>(d, HAAR_BATCH_BYTES/(operator_size*sizeof(std::complex<double>))));
+    double sqrt_d = std::sqrt(double(d));
+
+    // Step 1: buffers for one batch of operators, and a workspace per thread
+    std::vector<std::vector<std::complex<double> > > unitaries(batch);
+    std::vector<HaarWorkspace> workspaces(threads);
+
+    for (int first = 0; first < d; first += batch){
+        int count = std::min(batch, d - first);
+        // Step 2: thread t draws the operators t, t + threads, ... of the batch
+        auto work = [&](int t){
+            for (int i = t; i < count; i += threads){
+                generateHaarRandomUnitary(N, first + i, &unitaries.at(i), &workspaces.at(t));
+                for (std::complex<double>& entry : unitaries.at(i)){
+                    entry /= sqrt_d;
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; t++){
+            workers.push_back(std::thread(work, t));
+        }
+        work(0);
+        for (std::thread& worker : workers){
+            worker.join();
+        }
+        // Step 3: write the batch in order
+        for (int i = 0; i < count; i++){
+            writer->append(unitaries.at(i).data(), operator_size);
+        }
+    }
+    return 0;
+}
+
+std::vector<std::complex<double> >* generateHaarRandomIsometry(int rows, int columns, uint64_t stream_index){
+    // Step 0: Initialize output
+    std::vector<std::complex<double> >* out = new std::vector<std::complex<double> >(size_t(rows)*columns);
+    // Step 1: Gaussian matrix
+    RandomStream stream(RNG_DOMAIN_STIEFEL, stream_index);
+    stream.fillComplexNormal(out->data(), out->size());
+
+    // Step 2: One tall QR decomposition. LAPACK blocks it, so this is much faster than rows/columns square ones.
+    std::vector<std::complex<double> > tau(columns);
+    std::complex<double> qr_size, q_size;
+    zgeqrfp_wrapper(rows, columns, out, rows, &tau, &qr_size, -1);
+    zungqr_wrapper(rows, columns, columns, out, rows, &tau, &q_size, -1);
+    std::vector<std::complex<double> > work(std::max(1, std::max(static_cast<int>(qr_size.real()), static_cast<int>(q_size.real()))));
+    zgeqrfp_wrapper(rows, columns, out, rows, &tau, &work, work.size());
+
+    // Step 3: The first columns of Q are the isometry
+    zungqr_wrapper(rows, columns, columns, out, rows, &tau, &work, work.size());
     return out;
 }
+
+int generateStiefelChannel(int N, int d, VectorStreamWriter* writer){
+    std::vector<std::complex<double> >* isometry = generateHaarRandomIsometry(d*N, N, 0);
+
+    // Kraus operator m is made of rows mN, ..., mN + N - 1 of the isometry: copy it out column by column
+    size_t rows = size_t(d)*N;
+    std::vector<std::complex<double> > kraus_operator(size_t(N)*N);
+    for (int m = 0; m < d; m++){
+        for (int j = 0; j < N; j++){
+            std::copy_n(isometry->begin() + j*rows + size_t(m)*N, N, kraus_operator.begin() + size_t(j)*N);
+        }
+        writer->append(kraus_operator.data(), kraus_operator.size());
+    }
+    delete isometry;
+    return 0;
+}
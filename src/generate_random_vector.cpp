@@ -1,20 +1,16 @@
 #include "common_includes.h"
 #include "generate_random_vector.h"
+#include "rng.h"
+#include <limits>
 
 std::vector<std::complex<double> >* generateUniformRandomVector(int N){
     // Step 0: Initialize output
     std::vector<std::complex<double> >* out = new std::vector<std::complex<double> >(N);
     // Step 1: Set up random number generator
-    std::random_device rd;                  // Random device to seed the generator
-    std::mt19937 gen(rd());                 // Mersenne Twister generator, seeded by rd()
-    std::normal_distribution<double> dist(0.0f, 1.0f); // Normal distribution with mean and stddev
+    RandomStream stream(RNG_DOMAIN_VECTOR, 0);
 
     // Step 2: Generate random real and imaginary parts
-    for (int i=0; i < N; i++){
-        double real_part = dist(gen);  // Generate the real part (normal distribution)
-        double imag_part = dist(gen);  // Generate the imaginary part (normal distribution)
-        out->at(i) = std::complex<double>(real_part, imag_part);
-    }
+    stream.fillComplexNormal(out->data(), N);
 
     // Step 3: Renormalize the vector
     double norm = 0;
@@ -28,3 +24,110 @@ std::vector<std::complex<double> >* generateUniformRandomVector(int N){
     // Return the pointer    
     return out;
 }
+
+double inverseNormalCDF(double p){
+    // Acklam's algorithm: a rational approximation in the central region, and in the variable sqrt(-2 log p) in the tails
+    const double a[6] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    const double b[5] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01};
+    const double c[6] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    const double d[4] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00};
+    const double p_low = 0.02425;
+    if (p < p_low){
+        double q = std::sqrt(-2*std::log(p));
+        return (((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) / ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1);
+    }
+    if (p > 1-p_low){
+        double q = std::sqrt(-2*std::log(1-p));
+        return -(((((c[0]*q+c[1])*q+c[2])*q+c[3])*q+c[4])*q+c[5]) / ((((d[0]*q+d[1])*q+d[2])*q+d[3])*q+1);
+    }
+    double q = p-0.5;
+    double r = q*q;
+    return (((((a[0]*r+a[1])*r+a[2])*r+a[3])*r+a[4])*r+a[5])*q / (((((b[0]*r+b[1])*r+b[2])*r+b[3])*r+b[4])*r+1);
+}
+
+HaltonSphere::HaltonSphere(int dimension){
+    N = dimension;
+    next_index = 1;
+    // Step 1: the first 2N primes, by trial division
+    for (int candidate=2; bases.size() < 2*N; candidate++){
+        bool prime = true;
+        for (int base : bases){
+            if (base*base > candidate){
+                break;
+            }
+            if (candidate % base == 0){
+                prime = false;
+                break;
+            }
+        }
+        if (prime){
+            bases.push_back(candidate);
+        }
+    }
+    // Step 2: draw the scrambling: an affine map of the digits for every coordinate and digit position, down to double precision
+    RandomStream stream(RNG_DOMAIN_HALTON_SCRAMBLE, 0);
+    multipliers.resize(2*N);
+    offsets.resize(2*N);
+    for (int i=0; i<2*N; i++){
+        int base = bases.at(i);
+        int digits = int(std::ceil(std::numeric_limits<double>::digits/std::log2(base)));
+        for (int k=0; k<digits; k++){
+            multipliers.at(i).push_back(1 + int(stream() % (base-1)));
+            offsets.at(i).push_back(int(stream() % base));
+        }
+    }
+}
+
+double HaltonSphere::radicalInverse(long index, int coordinate){
+    // Mirror the scrambled digits of index in the base of the coordinate around the radix point. The zeros past its last digit are scrambled too.
+    int base = bases.at(coordinate);
+    std::vector<int>& a = multipliers.at(coordinate);
+    std::vector<int>& c = offsets.at(coordinate);
+    double value = 0.0f;
+    double scale = 1.0f/base;
+    for (size_t k=0; k<a.size(); k++){
+        value += ((long(a.at(k))*(index % base) + c.at(k)) % base)*scale;
+        index /= base;
+        scale /= base;
+    }
+    return value;
+}
+
+int HaltonSphere::getVector(long index, std::vector<std::complex<double> >* out){
+    // Step 1: scrambled point of the cube, mapped to Gaussian coordinates. Keep away from 0, where the quantile diverges.
+    out->resize(N);
+    std::vector<double> gaussian(2*N);
+    for (int i=0; i<2*N; i++){
+        double u = radicalInverse(index, i);
+        u = std::max(u, std::numeric_limits<double>::min());
+        gaussian.at(i) = inverseNormalCDF(u);
+    }
+    // Step 2: normalize
+    double norm = 0.0f;
+    for (int i=0; i<2*N; i++){
+        norm += gaussian.at(i)*gaussian.at(i);
+    }
+    norm = std::sqrt(norm);
+    for (int i=0; i<N; i++){
+        out->at(i) = std::complex<double>(gaussian.at(2*i), gaussian.at(2*i+1))/norm;
+    }
+    return 0;
+}
+
+int HaltonSphere::nextVector(std::vector<std::complex<double> >* out){
+    getVector(next_index, out);
+    next_index += 1;
+    return 0;
+}
+
+long HaltonSphere::getNextIndex(){
+    return next_index;
+}
+
+int HaltonSphere::setNextIndex(long index){
+    next_index = index;
+    return 0;
+}
+
+HaltonSphere::~HaltonSphere(){
+}
@@ -6,13 +6,19 @@
 
 #include "minimizer.h"
 #include "entropy_minimizer.h"
+#include "product_minimizer.h"
+#include "mps_minimizer.h"
 #include "vector_serializer.h"
+#include "vector_collection.h"
 #include "entropy_estimator.h"
+#include "channel_symmetry.h"
+#include "channel_cache.h"
 
 #include "message_handler.h"
 #include "logger.h"
 
 #include "generate_haar_unitary.h"
+#include "rng.h"
 #include "generate_random_vector.h"
 
 #include "uuid.h"
@@ -22,6 +28,243 @@
 
 
 
+bool checkFactors(const std::vector<int>& factors, int N, MessageHandler* message_handler){
+    // The factors of a product input must be positive and multiply to the input dimension
+    int product = 1;
+    for (int factor : factors){
+        if (factor < 1){
+            message_handler->message("Factors must be positive integers.", LOG_LEVEL_WARNING);
+            return false;
+        }
+        product *= factor;
+    }
+    if (product != N){
+        message_handler->message("The factors multiply to " + std::to_string(product) + ", but the input dimension is N = " + std::to_string(N) + ".", LOG_LEVEL_WARNING);
+        return false;
+    }
+    return true;
+}
+
+bool setObjective(argparse::ArgumentParser* subparser, EntropyConfig* config, MessageHandler* message_handler){
+    // Translate --objective and --renyi_p into the configuration
+    std::string objective = subparser->get<std::string>("--objective");
+    if (objective == "renyi"){
+        int p = subparser->get<int>("--renyi_p");
+        if (p < 2){
+            message_handler->message("The order of the Renyi entropy must be an integer p >= 2. For p = 1, use the von Neumann entropy.", LOG_LEVEL_WARNING);
+            return false;
+        }
+        config->setObjective(OBJECTIVE_RENYI);
+        config->setRenyiP(p);
+        message_handler->message("Objective: Renyi-" + std::to_string(p) + " entropy.");
+    } else if (objective == "min"){
+        config->setObjective(OBJECTIVE_MIN_ENTROPY);
+        message_handler->message("Objective: min-entropy.");
+    } else {
+        config->setObjective(OBJECTIVE_VON_NEUMANN);
+    }
+    return true;
+}
+
+bool setEntropyEstimator(argparse::ArgumentParser* subparser, EntropyConfig* config, MessageHandler* message_handler){
+    // Translate the --slq flags into the configuration
+    if (!subparser->get<bool>("--slq")){
+        return true;
+    }
+    if (config->objective != OBJECTIVE_VON_NEUMANN){
+        message_handler->message("The entropy estimator only applies to the von Neumann entropy. Ignoring --slq.", LOG_LEVEL_WARNING);
+        return true;
+    }
+    if (subparser->get<int>("--slq_probes") < 2 || subparser->get<int>("--slq_steps") < 1 || subparser->get<double>("--slq_tolerance") < 0){
+        message_handler->message("The entropy estimator needs at least 2 probes, 1 Lanczos step and a non-negative tolerance.", LOG_LEVEL_WARNING);
+        return false;
+    }
+    config->setSLQ(true);
+    config->setSLQMaxProbes(subparser->get<int>("--slq_probes"));
+    config->setSLQLanczosSteps(subparser->get<int>("--slq_steps"));
+    config->setSLQTolerance(subparser->get<double>("--slq_tolerance"));
+    message_handler->message("Estimating entropies with stochastic Lanczos quadrature.");
+    return true;
+}
+
+bool setKrausSubsampling(argparse::ArgumentParser* subparser, EntropyConfig* config, MessageHandler* message_handler){
+    // Translate the --subsample flags into the configuration
+    if (!subparser->get<bool>("--subsample")){
+        return true;
+    }
+    // The Renyi step and the product step already avoid the O(d N^3) channel applications that subsampling saves
+    if (config->objective == OBJECTIVE_RENYI || subparser->is_used("--factors")){
+        message_handler->message("Kraus subsampling only applies to full input steps for the von Neumann or min-entropy. Ignoring --subsample.", LOG_LEVEL_WARNING);
+        return true;
+    }
+    if (subparser->get<int>("--subsample_batch") < 1 || subparser->get<double>("--subsample_growth") <= 1){
+        message_handler->message("Kraus subsampling needs a batch of at least 1 and a growth factor above 1.", LOG_LEVEL_WARNING);
+        return false;
+    }
+    config->setSubsampling(true);
+    config->setSubsamplingBatch(subparser->get<int>("--subsample_batch"));
+    config->setSubsamplingGrowth(subparser->get<double>("--subsample_growth"));
+    return true;
+}
+
+bool setBeamSearch(argparse::ArgumentParser* subparser, EntropyConfig* config, MessageHandler* message_handler){
+    // Translate the --beam flags into the configuration
+    if (subparser->get<int>("--beam") == 1){
+        return true;
+    }
+    // The Renyi step has no eigenvectors to branch on, and the product step updates one factor at a time
+    if (config->objective == OBJECTIVE_RENYI || subparser->is_used("--factors")){
+        message_handler->message("Beam search only applies to full input steps for the von Neumann or min-entropy. Ignoring --beam.", LOG_LEVEL_WARNING);
+        return true;
+    }
+    if (subparser->get<int>("--beam") < 1 || subparser->get<int>("--beam_branches") < 1){
+        message_handler->message("Beam search needs a width and a number of branches of at least 1.", LOG_LEVEL_WARNING);
+        return false;
+    }
+    config->setBeamWidth(subparser->get<int>("--beam"));
+    config->setBeamBranches(subparser->get<int>("--beam_branches"));
+    return true;
+}
+
+bool setPortfolio(argparse::ArgumentParser* subparser, EntropyConfig* config, MessageHandler* message_handler){
+    // Translate the --overrelax and --portfolio flags into the configuration
+    if (!subparser->get<bool>("--overrelax") && !subparser->get<bool>("--portfolio")){
+        return true;
+    }
+    // Extrapolated vectors are not products, and the variants minimize over all inputs
+    if (subparser->is_used("--factors")){
+        message_handler->message("Overrelaxation and portfolio racing only apply to full input steps. Ignoring --overrelax and --portfolio.", LOG_LEVEL_WARNING);
+        return true;
+    }
+    config->setOverrelaxation(subparser->get<bool>("--overrelax"));
+    config->setPortfolio(subparser->get<bool>("--portfolio"));
+    if (!config->use_portfolio){
+        return true;
+    }
+    // The variants are the portfolio's own, and every race runs them to convergence: nothing else stops the steps
+    std::vector<std::string> ignored;
+    if (config->beam_width > 1){
+        ignored.push_back("--beam");
+    }
+    if (config->use_overrelaxation){
+        ignored.push_back("--overrelax");
+    }
+    if (config->use_subsampling){
+        ignored.push_back("--subsample");
+    }
+    if (config->use_dedup){
+        ignored.push_back("--dedup");
+    }
+    if (!ignored.empty()){
+        std::string flags;
+        for (const std::string& flag : ignored){
+            flags += (flags.empty() ? "" : ", ") + flag;
+        }
+        message_handler->message("Portfolio racing runs its own plain, overrelaxed, beam and subsampled variants, each until it converges. Ignoring " + flags + ".", LOG_LEVEL_WARNING);
+    }
+    if (config->MOE_use_prediction){
+        message_handler->message("Portfolio races are not stopped by the prediction of the final entropy.", LOG_LEVEL_WARNING);
+    }
+    if (subparser->is_used("--portfolio_stats")){
+        config->setPortfolioStatsFile(subparser->get<std::string>("--portfolio_stats"));
+    }
+    return true;
+}
+
+void reportMapping(const MappedData& data, MessageHandler* message_handler){
+    // The Kraus operators are read in place unless their data region is misaligned, which version 1.0 files allow
+    if (!data.zero_copy){
+        message_handler->message("The data region of the file is not aligned: the Kraus operators were copied to memory. Run moe convert on the file to avoid this.");
+    }
+}
+
+MappedData mapKraus(argparse::ArgumentParser* subparser, ChannelCache* cache, bool* cached, MessageHandler* message_handler){
+    // Map the Kraus operators. With --channel_cache, the checksum is not verified again if an earlier run verified this very file.
+    VectorSerializer serializer = VectorSerializer();
+    std::string filename = subparser->get<std::string>("-k");
+    bool verify = !subparser->get<bool>("--no_verify");
+    *cached = false;
+    if (!subparser->get<bool>("--channel_cache")){
+        return serializer.map(filename, verify);
+    }
+    MappedData data = serializer.map(filename, false);
+    try {
+        if (cache->open(filename, data) == 0){
+            message_handler->message("Using the channel cache " + cache->getFilename() + ".");
+        } else {
+            message_handler->message("The channel cache " + cache->getFilename() + " has nothing for these Kraus operators yet.");
+        }
+        *cached = true;
+    } catch (const std::exception& e){
+        message_handler->message(std::string(e.what()) + " Ignoring --channel_cache.", LOG_LEVEL_WARNING);
+        return verify ? serializer.map(filename, true) : data;
+    }
+    if (verify && cache->isVerified()){
+        message_handler->message("The checksum was verified by an earlier run.");
+    } else if (verify){
+        data = serializer.map(filename, true);
+        try {
+            cache->setVerified();
+        } catch (const std::exception& e){
+            message_handler->message(e.what(), LOG_LEVEL_WARNING);
+        }
+    }
+    return data;
+}
+
+void setSeed(argparse::ArgumentParser* subparser, MessageHandler* message_handler){
+    // Use --seed if given. Otherwise a random seed is drawn: print it either way.
+    if (subparser->is_used("--seed")){
+        setRandomSeed(subparser->get<unsigned long long>("--seed"));
+    }
+    message_handler->message("Random seed: " + std::to_string(getRandomSeed()));
+}
+
+void setResumeSeed(argparse::ArgumentParser* subparser, MessageHandler* message_handler){
+    // A resumed run draws from the seed of the run that was stopped. The seed is fixed once, so this comes before setSeed.
+    if (!subparser->is_used("--resume")){
+        return;
+    }
+    try {
+        MappedData snapshot = VectorSerializer().map(subparser->get<std::string>("--resume"), false);
+        uint64_t seed = snapshot.metadata.at("snapshot").at("seed").get<uint64_t>();
+        if (subparser->is_used("--seed") && seed != subparser->get<unsigned long long>("--seed")){
+            message_handler->message("Ignoring --seed: a resumed run uses the seed of its snapshot.", LOG_LEVEL_WARNING);
+        }
+        setRandomSeed(seed);
+    } catch (const std::exception&){
+        // The snapshot is checked, and the problem reported, when it is loaded
+    }
+}
+
+void setLedgerSeed(argparse::ArgumentParser* subparser, MessageHandler* message_handler){
+    // A search continued from a ledger draws from its seed, unless it is resumed from a snapshot. The seed is fixed once, so this comes before setSeed.
+    json header;
+    if (!subparser->is_used("--ledger") || subparser->is_used("--resume") || !AttemptLedger::readHeader(subparser->get<std::string>("--ledger"), &header) || !header.contains("seed")){
+        return;
+    }
+    uint64_t seed = header.at("seed").get<uint64_t>();
+    if (subparser->is_used("--seed") && seed != subparser->get<unsigned long long>("--seed")){
+        message_handler->message("Ignoring --seed: a search continued from a ledger uses the seed of the ledger.", LOG_LEVEL_WARNING);
+    }
+    setRandomSeed(seed);
+}
+
+bool setSnapshot(argparse::ArgumentParser* subparser, EntropyConfig* config, bool resumable, MessageHandler* message_handler){
+    // Snapshots only cover the plain search. Returns whether the run resumes from one.
+    if (!resumable){
+        if (subparser->is_used("--snapshot") || subparser->is_used("--resume")){
+            message_handler->message("Snapshots do not cover portfolio races, product inputs or block decompositions. Ignoring --snapshot and --resume.", LOG_LEVEL_WARNING);
+        }
+        return false;
+    }
+    if (subparser->is_used("--snapshot")){
+        config->setSnapshotFile(subparser->get<std::string>("--snapshot"));
+        message_handler->message("Snapshots are saved to " + subparser->get<std::string>("--snapshot") + " every " + std::to_string(config->checkpoint_interval) + " iterations.");
+    }
+    return subparser->is_used("--resume");
+}
+
 int main(int argc, char** argv){
 
     // Get general purpose message handler
@@ -51,6 +294,8 @@ int main(int argc, char** argv){
                 full_command += " ";
             }
             message_handler->message(full_command);
+            // fix the seed, so that the run can be reproduced
+            setSeed(&parser->at<argparse::ArgumentParser>("kraus").at<argparse::ArgumentParser>("haar"), message_handler);
             // Now explicitly print the options
             message_handler->message("Parsed option N: " + std::to_string(parser->at<argparse::ArgumentParser>("kraus").at<argparse::ArgumentParser>("haar").get<int>("-N")));
             message_handler->message("Parsed option k: " + std::to_string(parser->at<argparse::ArgumentParser>("kraus").at<argparse::ArgumentParser>("haar").get<int>("-d")));
@@ -74,25 +319,62 @@ int main(int argc, char** argv){
             }
 
 
-            // generate the Kraus operators
-            std::vector<std::complex<double> >* kraus_operators = new std::vector<std::complex<double> >(d*N*N); // kraus_operators is the pointer.
-            for (int m = 0; m < d; m++){
-                message_handler->message("Generating Haar random unitary " + std::to_string(m+1) + " of " + std::to_string(d) + "...");
-                // append a new unitary at position i of the kraus operator.
-                std::vector<std::complex<double> >* new_haar_unitary = generateHaarRandomUnitary(N);
-                for (int i = 0; i < N*N ;i++){
-                    kraus_operators->at(m*N*N+i) = new_haar_unitary->at(i)/std::sqrt(double(d));
-                }
-                message_handler->message("Done!");
-                delete new_haar_unitary;
+            // generate the Kraus operators in parallel, and write them batch by batch as they are drawn
+            int threads = parser->at<argparse::ArgumentParser>("kraus").at<argparse::ArgumentParser>("haar").get<int>("--threads");
+            message_handler->message("Generating " + std::to_string(d) + " Haar random unitaries with " + (threads > 0 ? std::to_string(threads) : "one per core") + " threads...");
+            VectorStreamWriter writer = VectorStreamWriter();
+            writer.begin("kraus", output, uint64_t(d)*N*N, "Kraus operators for a random unitary channel", d, N, {{"rng", rngMetadata(RNG_DOMAIN_HAAR, 0, d)}});
+            generateHaarChannel(N, d, threads, &writer);
+            writer.finalize();
+            message_handler->message("Done!");
+            // print exit message
+            message_handler->message("Kraus operators saved to " + output + ".");
+            return 0;
+        }
+
+        // Case 2: stiefel was called
+        if (parser->at<argparse::ArgumentParser>("kraus").is_subcommand_used("stiefel")){
+            argparse::ArgumentParser* subparser;
+            subparser = &parser->at<argparse::ArgumentParser>("kraus").at<argparse::ArgumentParser>("stiefel");
+
+            // check printing and logging options and create logger or printer accordingly. Don't give file names or anything.
+            if (subparser->get<bool>("-l")){
+                message_handler->createLogger();
+            } 
+            if (!subparser->get<bool>("-s")){
+                message_handler->createPrinter();
             }
 
-            // save the kraus operators
-            VectorSerializer serializer = VectorSerializer();
-            serializer.serialize("kraus", output, *kraus_operators, "Kraus operators for a random unitary channel", d, N);
-            // print exit message
+            // first print the full command line
+            std::string full_command = "Command called: ";
+            for (int i = 0; i < argc; i++){
+                full_command += argv[i];
+                full_command += " ";
+            }
+            message_handler->message(full_command);
+            // fix the seed, so that the run can be reproduced
+            setSeed(subparser, message_handler);
+            N = subparser->get<int>("-N");
+            d = subparser->get<int>("-d");
+            std::string output = subparser->get<std::string>("-o");
+            message_handler->message("Parsed option N: " + std::to_string(N));
+            message_handler->message("Parsed option d: " + std::to_string(d));
+            message_handler->message("Parsed output: " + output);
+
+            // check that the output directory exists
+            std::filesystem::path output_directory = std::filesystem::path(output).parent_path();
+            if (!output_directory.empty() && !std::filesystem::exists(output_directory)){
+                message_handler->message("Output directory does not exist. Please create it first.");
+                return 1;
+            }
+
+            // one isometry of dN x N, then its blocks are written one by one
+            message_handler->message("Generating a Haar random isometry of " + std::to_string(d*N) + " x " + std::to_string(N) + "...");
+            VectorStreamWriter writer = VectorStreamWriter();
+            writer.begin("kraus", output, uint64_t(d)*N*N, "Kraus operators for a random channel from a Haar random isometry", d, N, {{"rng", rngMetadata(RNG_DOMAIN_STIEFEL, 0, 1)}});
+            generateStiefelChannel(N, d, &writer);
+            writer.finalize();
             message_handler->message("Kraus operators saved to " + output + ".");
-            delete kraus_operators;
             return 0;
         }
 
@@ -121,19 +403,24 @@ int main(int argc, char** argv){
             full_command += " ";
         }
         message_handler->message(full_command);
+        // fix the seed, so that the run can be reproduced
+        setResumeSeed(subparser, message_handler);
+        setSeed(subparser, message_handler);
         // Now explicitly print the options
         message_handler->message("Parsed Kraus operators: " + subparser->get<std::string>("-k"));
         // Also print logging and printing options,
         message_handler->message("Logging is: " + std::to_string(subparser->get<bool>("-l")));
         message_handler->message("Printing is: " + std::to_string(subparser->get<bool>("-s") ));
 
-        // Get the kraus operators from file
-        std::vector<std::complex<double> >* kraus_operators = new std::vector<std::complex<double> >();
+        // Map the kraus operators from file. The minimizers read them in place.
         VectorSerializer serializer = VectorSerializer();
-        DeserializedData deserialized_data = serializer.deserialize(subparser->get<std::string>("-k"));
-        kraus_operators = &deserialized_data.vectorData;
+        ChannelCache channel_cache = ChannelCache();
+        bool cached;
+        MappedData deserialized_data = mapKraus(subparser, &channel_cache, &cached, message_handler);
+        ComplexView* kraus_operators = &deserialized_data.view;
         // Print exit message
         message_handler->message("Kraus operators loaded from " + subparser->get<std::string>("-k") + ".");
+        reportMapping(deserialized_data, message_handler);
         // Get N and d from metadata
         N = deserialized_data.N;
         d = deserialized_data.d;
@@ -150,8 +437,32 @@ int main(int argc, char** argv){
         // set logging and printing
         config.setLogging(subparser->get<bool>("-l"));
         config.setPrinting(!subparser->get<bool>("-s"));
+        // set the objective
+        if (!setObjective(subparser, &config, message_handler)){
+            return 1;
+        }
+        // set the stopping criterion
+        if (subparser->get<std::string>("--convergence") == "residual"){
+            config.setConvergence(CONVERGENCE_RESIDUAL);
+        }
+        // set the entropy estimator
+        if (!setEntropyEstimator(subparser, &config, message_handler)){
+            return 1;
+        }
+        // set Kraus subsampling
+        if (!setKrausSubsampling(subparser, &config, message_handler)){
+            return 1;
+        }
+        // set beam search
+        if (!setBeamSearch(subparser, &config, message_handler)){
+            return 1;
+        }
         // set prediction
         config.setMOEUsePrediction(subparser->get<bool>("--predict"));
+        // set overrelaxation and portfolio racing
+        if (!setPortfolio(subparser, &config, message_handler)){
+            return 1;
+        }
         // set checkpointing
         config.setCheckpointing(subparser->get<bool>("-c"));
         if (subparser->is_used("-cf")){
@@ -164,16 +475,41 @@ int main(int argc, char** argv){
             // debug
             message_handler->message("Checkpoint interval set to " + std::to_string(subparser->get<int>("-ci")));
         }
+        // set snapshots, to resume the run
+        bool resume = setSnapshot(subparser, &config, !subparser->get<bool>("--portfolio") && !subparser->is_used("--factors"), message_handler);
 
-        // finally, create a minimizer
-        EntropyMinimizer* minimizer = new EntropyMinimizer(kraus_operators, d, N, N, &config);
+        // finally, create a minimizer. If factors are given, only product inputs are considered.
+        EntropyMinimizer* minimizer;
+        if (subparser->is_used("--factors")){
+            std::vector<int> factors = subparser->get<std::vector<int> >("--factors");
+            if (!checkFactors(factors, N, message_handler)){
+                return 1;
+            }
+            minimizer = new EntropyMinimizer(new ProductMinimizer(kraus_operators, d, N, N, config.epsilon, factors), kraus_operators, d, N, N, &config);
+        } else {
+            minimizer = new EntropyMinimizer(kraus_operators, d, N, N, &config);
+        }
 
         signal(SIGTERM, minimizer->signal_handler);
+        // the derived data of the channel only holds for full inputs
+        if (cached && !subparser->is_used("--factors")){
+            minimizer->setChannelCache(&channel_cache);
+        }
+
+        // store the saved vectors in a collection, if requested
+        if (subparser->is_used("--collection") && minimizer->openCollection(subparser->get<std::string>("--collection")) != 0){
+            return 1;
+        }
 
         // Initialize run
         // Check if we have a starting vector specified in the command line
         std::vector<std::complex<double> >* start_vector = new std::vector<std::complex<double> >();
-        if (subparser->is_used("--vector")){
+        if (resume){
+            // continue the run of the snapshot
+            if (minimizer->loadSnapshot(subparser->get<std::string>("--resume"), false) != 0){
+                return 1;
+            }
+        } else if (subparser->is_used("--vector")){
             // load the vector
             DeserializedData deserialized_vector = serializer.deserialize(subparser->get<std::string>("--vector"));
             start_vector = &deserialized_vector.vectorData;
@@ -238,6 +574,10 @@ int main(int argc, char** argv){
             full_command += " ";
         }
         message_handler->message(full_command);
+        // fix the seed, so that the run can be reproduced
+        setResumeSeed(subparser, message_handler);
+        setLedgerSeed(subparser, message_handler);
+        setSeed(subparser, message_handler);
         // Now explicitly print the options
         message_handler->message("Parsed Kraus operators: " + subparser->get<std::string>("-k"));
         // print logging and printing options,
@@ -245,13 +585,15 @@ int main(int argc, char** argv){
         message_handler->message("Printing is: " + std::to_string(subparser->get<bool>("-s") ));
 
         // Try to load kraus
-        std::vector<std::complex<double> >* kraus_operators = new std::vector<std::complex<double> >();
         VectorSerializer serializer = VectorSerializer();
-        // get the kraus operators
-        DeserializedData deserialized_data = serializer.deserialize(subparser->get<std::string>("-k"));
-        kraus_operators = &deserialized_data.vectorData;
+        // map the kraus operators. The minimizers read them in place.
+        ChannelCache channel_cache = ChannelCache();
+        bool cached;
+        MappedData deserialized_data = mapKraus(subparser, &channel_cache, &cached, message_handler);
+        ComplexView* kraus_operators = &deserialized_data.view;
         // print exit message
         message_handler->message("Kraus operators loaded from " + subparser->get<std::string>("-k") + ".");
+        reportMapping(deserialized_data, message_handler);
         // get N and d from metadata
         N = deserialized_data.N;
         d = deserialized_data.d;
@@ -272,18 +614,175 @@ int main(int argc, char** argv){
         // set logging and printing
         config.setLogging(subparser->get<bool>("-l"));
         config.setPrinting(!subparser->get<bool>("-s"));
+        // set the objective
+        if (!setObjective(subparser, &config, message_handler)){
+            return 1;
+        }
+        // set the stopping criterion
+        if (subparser->get<std::string>("--convergence") == "residual"){
+            config.setConvergence(CONVERGENCE_RESIDUAL);
+        }
+        // set the entropy estimator
+        if (!setEntropyEstimator(subparser, &config, message_handler)){
+            return 1;
+        }
+        // set Kraus subsampling
+        if (!setKrausSubsampling(subparser, &config, message_handler)){
+            return 1;
+        }
+        // set beam search
+        if (!setBeamSearch(subparser, &config, message_handler)){
+            return 1;
+        }
+        // set the sequence of starting vectors
+        if (subparser->get<std::string>("--starts") == "halton"){
+            config.setStartSequence(START_SEQUENCE_HALTON);
+        }
+        if (subparser->get<std::string>("--starts") == "channel"){
+            if (subparser->get<int>("--channel_starts") < 0){
+                message_handler->message("The number of channel-informed starts cannot be negative.", LOG_LEVEL_WARNING);
+                return 1;
+            }
+            config.setStartSequence(START_SEQUENCE_CHANNEL);
+            config.setChannelStartCount(subparser->get<int>("--channel_starts"));
+        }
+        config.setCompareStarts(subparser->get<bool>("--compare_starts"));
+        // set basin deduplication
+        if (subparser->get<bool>("--dedup")){
+            if (subparser->get<int>("--dedup_interval") < 1){
+                message_handler->message("The deduplication interval must be at least 1.", LOG_LEVEL_WARNING);
+                return 1;
+            }
+            config.setDedup(true);
+            config.setDedupInterval(subparser->get<int>("--dedup_interval"));
+        }
+        // set basin hopping
+        if (subparser->get<bool>("--hop")){
+            if (subparser->get<double>("--hop_step") <= 0 || subparser->get<double>("--hop_temperature") <= 0){
+                message_handler->message("The basin hopping step and temperature must be positive.", LOG_LEVEL_WARNING);
+                return 1;
+            }
+            if (subparser->get<double>("--hop_restarts") < 0 || subparser->get<double>("--hop_restarts") > 1){
+                message_handler->message("The ratio of fresh restarts must be between 0 and 1.", LOG_LEVEL_WARNING);
+                return 1;
+            }
+            if (subparser->get<int>("--hop_iters") < 1){
+                message_handler->message("The iteration budget of a hop move must be at least 1.", LOG_LEVEL_WARNING);
+                return 1;
+            }
+            config.setHopping(true);
+            config.setHoppingStep(subparser->get<double>("--hop_step"));
+            config.setHoppingTemperature(subparser->get<double>("--hop_temperature"));
+            config.setHoppingRestartRatio(subparser->get<double>("--hop_restarts"));
+            config.setHoppingIterations(subparser->get<int>("--hop_iters"));
+        }
+        // set overrelaxation and portfolio racing
+        if (!setPortfolio(subparser, &config, message_handler)){
+            return 1;
+        }
 
-        // finally, create a minimizer
-        EntropyMinimizer* minimizer = new EntropyMinimizer(kraus_operators, d, N, N, &config);
+        // set snapshots, to resume the search
+        if (subparser->is_used("-ci")){
+            config.setCheckpointInterval(subparser->get<int>("-ci"));
+        }
+        bool resume = setSnapshot(subparser, &config, !subparser->get<bool>("--portfolio") && !subparser->is_used("--factors") && !subparser->get<bool>("--decompose"), message_handler);
+
+        // finally, create a minimizer. If factors are given, only product inputs are considered.
+        EntropyMinimizer* minimizer;
+        bool product_inputs = subparser->is_used("--factors");
+        if (product_inputs){
+            std::vector<int> factors = subparser->get<std::vector<int> >("--factors");
+            if (!checkFactors(factors, N, message_handler)){
+                return 1;
+            }
+            minimizer = new EntropyMinimizer(new ProductMinimizer(kraus_operators, d, N, N, config.epsilon, factors), kraus_operators, d, N, N, &config);
+        } else {
+            minimizer = new EntropyMinimizer(kraus_operators, d, N, N, &config);
+        }
 
 
         signal(SIGTERM, minimizer->signal_handler);
-        
+        // the derived data of the channel only holds for full inputs
+        if (cached && !product_inputs){
+            minimizer->setChannelCache(&channel_cache);
+        }
+
+        // Symmetries and block decompositions do not preserve product inputs
+        if (product_inputs && (subparser->is_used("--symmetry_generators") || subparser->get<bool>("--symmetry") || subparser->get<bool>("--decompose"))){
+            message_handler->message("Symmetries and block decompositions are not used with product inputs. Ignoring them.", LOG_LEVEL_WARNING);
+        }
+
+        // Symmetries of the channel, if requested
+        ChannelSymmetry symmetry = ChannelSymmetry(kraus_operators, d, N);
+        if (!product_inputs && subparser->is_used("--symmetry_generators")){
+            DeserializedData deserialized_generators = serializer.deserialize(subparser->get<std::string>("--symmetry_generators"));
+            if (deserialized_generators.N != N){
+                message_handler->message("Symmetry generators have wrong dimensions. Expected N = " + std::to_string(N) + ". Got N = " + std::to_string(deserialized_generators.N) + ".");
+                return 1;
+            }
+            for (int g=0; g<deserialized_generators.d; g++){
+                std::vector<std::complex<double> > generator(deserialized_generators.vectorData.begin()+g*N*N, deserialized_generators.vectorData.begin()+(g+1)*N*N);
+                if (symmetry.addGenerator(generator) != 0){
+                    message_handler->message("Generator " + std::to_string(g+1) + " is not a symmetry of the channel (or is redundant). Ignoring it.", LOG_LEVEL_WARNING);
+                }
+            }
+        }
+        if (!product_inputs && subparser->get<bool>("--symmetry")){
+            // Which generators are detected depends on those given, so only the detection on its own is cached
+            bool cacheable = cached && !subparser->is_used("--symmetry_generators");
+            json info;
+            ComplexView generators;
+            if (cacheable && channel_cache.getSection("symmetry", json::object(), &info, &generators)){
+                message_handler->message("Took " + std::to_string(symmetry.restoreGenerators(generators)) + " Weyl-Heisenberg symmetry generators from " + channel_cache.getFilename() + ".");
+            } else {
+                message_handler->message("Detected " + std::to_string(symmetry.detectGenerators()) + " Weyl-Heisenberg symmetry generators.");
+                if (cacheable){
+                    try {
+                        std::vector<std::complex<double> > detected = symmetry.getGenerators();
+                        channel_cache.storeSection("symmetry", json::object(), {{"count", symmetry.getGeneratorCount()}}, ComplexView(detected));
+                    } catch (const std::exception& e){
+                        message_handler->message(e.what(), LOG_LEVEL_WARNING);
+                    }
+                }
+            }
+        }
+        if (symmetry.getGeneratorCount() > 0){
+            symmetry.generateGroup();
+            message_handler->message("Symmetry group of order " + std::to_string(symmetry.getGroupOrder()) + (symmetry.getGroupOrder() >= SYMMETRY_MAX_GROUP_ORDER ? " (truncated)." : "."));
+            minimizer->setSymmetry(&symmetry);
+        }
+
         //log with message handler
         message_handler->message("Subcommand multishot was used");
 
-        // run multishot
-        minimizer->findMOE();
+        // continue the search of the snapshot, if requested
+        if (resume && minimizer->loadSnapshot(subparser->get<std::string>("--resume"), true) != 0){
+            return 1;
+        }
+        // record the attempts, and continue after those already recorded
+        if (subparser->is_used("--ledger")){
+            if (!product_inputs && subparser->get<bool>("--decompose")){
+                message_handler->message("The ledger does not cover block decompositions. Ignoring --ledger.", LOG_LEVEL_WARNING);
+            } else if (minimizer->openLedger(subparser->get<std::string>("--ledger")) != 0){
+                return 1;
+            }
+        }
+        // store the vectors of the attempts in a collection. The blocks of a decomposition are searched by minimizers of their own.
+        if (subparser->is_used("--collection")){
+            if (!product_inputs && subparser->get<bool>("--decompose")){
+                message_handler->message("The attempts on the blocks of a decomposition are not stored in the collection, only the vector saved with --save.", LOG_LEVEL_WARNING);
+            }
+            if (minimizer->openCollection(subparser->get<std::string>("--collection")) != 0){
+                return 1;
+            }
+        }
+
+        // run multishot, block by block if requested
+        if (!product_inputs && subparser->get<bool>("--decompose")){
+            minimizer->findMOEDecomposed();
+        } else {
+            minimizer->findMOE();
+        }
         // save the state if selected
         if (subparser->is_used("-S")){
             minimizer->saveState();
@@ -314,6 +813,8 @@ int main(int argc, char** argv){
             full_command += " ";
         }
         message_handler->message(full_command);
+        // fix the seed, so that the run can be reproduced
+        setSeed(subparser, message_handler);
         // Now explicitly print the options
         message_handler->message("Parsed option N: " + std::to_string(subparser->get<int>("-N")));
         message_handler->message("Parsed output: " + subparser->get<std::string>("--output"));
@@ -335,16 +836,194 @@ int main(int argc, char** argv){
             return 1;
         }
 
-        // generate random vector
-        std::vector<std::complex<double> >* random_vector = generateUniformRandomVector(N);
+        // generate random vector. The Halton scrambling depends on the seed only, so that vectors saved with the same --seed and --index 1, 2, ... form one low-discrepancy set.
+        std::vector<std::complex<double> >* random_vector;
+        json vector_metadata = {{"rng", rngMetadata(RNG_DOMAIN_VECTOR, 0, 1)}};
+        if (subparser->get<std::string>("--starts") == "halton"){
+            if (subparser->get<int>("--index") < 1){
+                message_handler->message("The index of a Halton point must be at least 1.", LOG_LEVEL_WARNING);
+                return 1;
+            }
+            random_vector = new std::vector<std::complex<double> >(N);
+            HaltonSphere sequence = HaltonSphere(N);
+            sequence.getVector(subparser->get<int>("--index"), random_vector);
+            vector_metadata = {{"rng", rngMetadata(RNG_DOMAIN_HALTON_SCRAMBLE, 0, 1)}, {"halton_index", subparser->get<int>("--index")}};
+        } else {
+            random_vector = generateUniformRandomVector(N);
+        }
 
         // save the vector
         VectorSerializer serializer = VectorSerializer();
-        serializer.serialize("vector", output, *random_vector, "Random vector for the minimization algorithm", 1, N);
+        serializer.serialize("vector", output, *random_vector, "Random vector for the minimization algorithm", 1, N, vector_metadata);
         // print exit message
         message_handler->message("Random vector saved to " + output + ".");
         delete random_vector;
     }
+
+    // Option 5: tensorpower was called
+    if (parser->is_subcommand_used("tensorpower")){
+        // get the selected parser
+        argparse::ArgumentParser* subparser;
+        subparser = &parser->at<argparse::ArgumentParser>("tensorpower");
+
+        // check printing and logging options and create logger or printer accordingly. Don't give file names or anything.
+        if (subparser->get<bool>("-l")){
+            message_handler->createLogger();
+        } 
+        if (!subparser->get<bool>("-s")){
+            message_handler->createPrinter();
+        }
+
+        // first print the full command line
+        std::string full_command = "Command called: ";
+        for (int i = 0; i < argc; i++){
+            full_command += argv[i];
+            full_command += " ";
+        }
+        message_handler->message(full_command);
+        // fix the seed, so that the run can be reproduced
+        setSeed(subparser, message_handler);
+        message_handler->message("Parsed Kraus operators: " + subparser->get<std::string>("-k"));
+
+        // Map the Kraus operators of a single copy
+        VectorSerializer serializer = VectorSerializer();
+        MappedData deserialized_data = serializer.map(subparser->get<std::string>("-k"), !subparser->get<bool>("--no_verify"));
+        ComplexView* kraus_operators = &deserialized_data.view;
+        message_handler->message("Kraus operators loaded from " + subparser->get<std::string>("-k") + ".");
+        reportMapping(deserialized_data, message_handler);
+        N = deserialized_data.N;
+        d = deserialized_data.d;
+        int copies = subparser->get<int>("-n");
+        int bond_dimension = subparser->get<int>("-D");
+        if (copies < 1 || bond_dimension < 1){
+            message_handler->message("The number of copies and the bond dimension must be positive.", LOG_LEVEL_WARNING);
+            return 1;
+        }
+        message_handler->message("N: " + std::to_string(N));
+        message_handler->message("d: " + std::to_string(d));
+        message_handler->message("Copies: " + std::to_string(copies) + ", bond dimension: " + std::to_string(bond_dimension));
+
+        // initialize configuration. Iterations are sweeps here.
+        EntropyConfig config = EntropyConfig();
+        config.setMaxIterations(subparser->is_used("-i") ? subparser->get<int>("-i") : DEFAULT_TENSOR_POWER_MAX_SWEEPS);
+        if (subparser->is_used("-a")){
+            config.setMinimizationAttempts(subparser->get<int>("-a"));
+        }
+        config.setLogging(subparser->get<bool>("-l"));
+        config.setPrinting(!subparser->get<bool>("-s"));
+
+        MPSMinimizer* minimizer = new MPSMinimizer(kraus_operators, d, N, N, copies, bond_dimension, &config);
+        minimizer->findMOE();
+        delete minimizer;
+    }
+
+    // Option 6: convert was called
+    if (parser->is_subcommand_used("convert")){
+        // get the selected parser
+        argparse::ArgumentParser* subparser;
+        subparser = &parser->at<argparse::ArgumentParser>("convert");
+
+        // check printing and logging options and create logger or printer accordingly. Don't give file names or anything.
+        if (subparser->get<bool>("-l")){
+            message_handler->createLogger();
+        } 
+        if (!subparser->get<bool>("-s")){
+            message_handler->createPrinter();
+        }
+
+        std::string input = subparser->get<std::string>("input");
+        std::string output = subparser->is_used("-o") ? subparser->get<std::string>("-o") : input;
+
+        // Read the file, checksum included, so that a damaged file is not given a fresh checksum
+        VectorSerializer serializer = VectorSerializer();
+        MappedData deserialized_data = serializer.map(input);
+        message_handler->message("Read " + deserialized_data.type + " file " + input + ", format version " + deserialized_data.version + ".");
+        if (deserialized_data.version == SERIALIZER_FORMAT_VERSION && output == input){
+            message_handler->message("The file is already in the current format.");
+        } else {
+            // Write to a temporary file first: the input may still be mapped, and may be the output
+            std::string temporary = output + ".tmp";
+            serializer.serialize(deserialized_data.type, temporary, deserialized_data.view, deserialized_data.description,
+                                 deserialized_data.d, deserialized_data.N, deserialized_data.metadata);
+            std::filesystem::rename(temporary, output);
+            message_handler->message("Written in format version " SERIALIZER_FORMAT_VERSION " to " + output + ".");
+        }
+    }
+
+    if (parser->is_subcommand_used("collection")){
+        argparse::ArgumentParser* collection_parser = &parser->at<argparse::ArgumentParser>("collection");
+        // get the selected subparser
+        argparse::ArgumentParser* subparser = nullptr;
+        for (std::string command : {"list", "top", "extract"}){
+            if (collection_parser->is_subcommand_used(command)){
+                subparser = &collection_parser->at<argparse::ArgumentParser>(command);
+            }
+        }
+        if (subparser == nullptr){
+            std::cerr << *collection_parser;
+            return 1;
+        }
+
+        // check printing and logging options and create logger or printer accordingly. Don't give file names or anything.
+        if (subparser->get<bool>("-l")){
+            message_handler->createLogger();
+        } 
+        if (!subparser->get<bool>("-s")){
+            message_handler->createPrinter();
+        }
+
+        // Only the index is read, except to extract a vector
+        std::string file = subparser->get<std::string>("collection");
+        VectorCollection collection = VectorCollection();
+        try {
+            collection.open(file, false);
+        } catch (const std::exception& e){
+            message_handler->message("Could not read the collection: " + std::string(e.what()), LOG_LEVEL_WARNING);
+            return 1;
+        }
+        auto describe = [&collection](size_t index){
+            CollectionEntry entry = collection.getEntry(index);
+            std::ostringstream line;
+            line << "#" << index << ": entropy " << std::fixed << std::setprecision(PRINT_PRECISION) << entry.entropy << ", iteration " << entry.iteration
+                 << ", seed " << entry.seed << ", stream " << entry.stream << ", run " << (entry.run_id[0] != '\0' ? entry.run_id : "unknown") << ".";
+            return line.str();
+        };
+
+        if (collection_parser->is_subcommand_used("list")){
+            message_handler->message("Collection " + file + " holds " + std::to_string(collection.size()) + " vectors.");
+            for (size_t index = 0; index < collection.size(); index++){
+                message_handler->message(describe(index));
+            }
+        }
+        if (collection_parser->is_subcommand_used("top")){
+            int k = subparser->get<int>("-k");
+            if (k < 1){
+                message_handler->message("The number of vectors must be positive.", LOG_LEVEL_WARNING);
+                return 1;
+            }
+            std::vector<size_t> top = collection.top(k);
+            message_handler->message("The " + std::to_string(top.size()) + " vectors with the lowest entropy out of " + std::to_string(collection.size()) + ":");
+            for (size_t index : top){
+                message_handler->message(describe(index));
+            }
+        }
+        if (collection_parser->is_subcommand_used("extract")){
+            int index = subparser->get<int>("index");
+            std::string output = subparser->get<std::string>("-o");
+            if (index < 0 || size_t(index) >= collection.size()){
+                message_handler->message("There is no vector #" + std::to_string(index) + ": the collection holds " + std::to_string(collection.size()) + ".", LOG_LEVEL_WARNING);
+                return 1;
+            }
+            try {
+                collection.extract(index, output);
+            } catch (const std::exception& e){
+                message_handler->message("Could not extract the vector: " + std::string(e.what()), LOG_LEVEL_WARNING);
+                return 1;
+            }
+            message_handler->message("Vector #" + std::to_string(index) + " written to " + output + ".");
+        }
+    }
+
     // Delete the parser
     delete parser;
     delete message_handler;
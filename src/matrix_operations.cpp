@@ -72,6 +72,41 @@ void zheev_wrapper(char jobz, char uplo, int N, std::vector<std::complex<double>
     #endif
 }
 
+void zheevr_wrapper(char uplo, int N, std::vector<std::complex<double> >* A, int lda, int il, int iu, std::vector<double>* w, std::vector<std::complex<double> >* Z, int ldz){
+    // Only a subset of the eigenpairs: after the reduction to tridiagonal form, this costs O(N^2) per eigenvector instead of O(N^3) for all of them
+    char jobz = 'V';
+    char range = 'I';
+    double vl = 0.0f;
+    double vu = 0.0f;
+    double abstol = 0.0f;   // Default tolerance
+    int m = 0;
+    std::vector<int> isuppz(2*std::max(1, iu-il+1));
+    #ifdef LAPACK_ACCELERATE
+    int info = 0;
+    int lwork = -1, lrwork = -1, liwork = -1;  // First query to get optimal work sizes
+    std::vector<lapack_complex_t> work(1);
+    std::vector<double> rwork(1);
+    std::vector<int> iwork(1);
+    zheevr_(&jobz, &range, &uplo, &N, reinterpret_cast<lapack_complex_t*>(A->data()), &lda, &vl, &vu, &il, &iu, &abstol, &m, w->data(),
+            reinterpret_cast<lapack_complex_t*>(Z->data()), &ldz, isuppz.data(), work.data(), &lwork, rwork.data(), &lrwork, iwork.data(), &liwork, &info);
+    if (info != 0) {
+        std::cerr << "Error during workspace query: info = " << info << std::endl;
+        return;
+    }
+    lwork = static_cast<int>(work[0].real());
+    lrwork = static_cast<int>(rwork[0]);
+    liwork = iwork[0];
+    work.resize(lwork);
+    rwork.resize(lrwork);
+    iwork.resize(liwork);
+    zheevr_(&jobz, &range, &uplo, &N, reinterpret_cast<lapack_complex_t*>(A->data()), &lda, &vl, &vu, &il, &iu, &abstol, &m, w->data(),
+            reinterpret_cast<lapack_complex_t*>(Z->data()), &ldz, isuppz.data(), work.data(), &lwork, rwork.data(), &lrwork, iwork.data(), &liwork, &info);
+    #elif defined(LAPACK_MKL) || defined(LAPACK_OPENBLAS) || defined(LAPACK_AMD)
+        LAPACKE_zheevr(LAPACK_COL_MAJOR, jobz, range, uplo, N, reinterpret_cast<lapack_complex_t*>(A->data()), lda, vl, vu, il, iu, abstol, &m, w->data(),
+            reinterpret_cast<lapack_complex_t*>(Z->data()), ldz, isuppz.data());
+    #endif
+}
+
 void dgesv_wrapper(int N, int NRHS, double* A, int lda, int* ipiv, double* B, int ldb){
     #ifdef LAPACK_ACCELERATE
         int info = 0;
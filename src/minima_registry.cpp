@@ -0,0 +1,101 @@
+#include "common_includes.h"
+#include "minima_registry.h"
+#include "config.h"
+
+MinimaRegistry::MinimaRegistry(){
+    symmetry = nullptr;
+}
+
+int MinimaRegistry::setSymmetry(ChannelSymmetry* sym){
+    symmetry = sym;
+    return 0;
+}
+
+double MinimaRegistry::fidelity(const std::vector<std::complex<double> >& first, const std::vector<std::complex<double> >& second){
+    if (symmetry != nullptr){
+        return symmetry->orbitFidelity(first, second);
+    }
+    std::complex<double> overlap(0.0f,0.0f);
+    for (int i=0; i<first.size(); i++){
+        overlap += std::conj(first.at(i))*second.at(i);
+    }
+    return std::abs(overlap);
+}
+
+int MinimaRegistry::findMinimum(const std::vector<std::complex<double> >& vector){
+    return findMinimum(vector, MINIMA_FIDELITY_THRESHOLD);
+}
+
+int MinimaRegistry::findMinimum(const std::vector<std::complex<double> >& vector, double threshold){
+    for (int m=0; m<minima.size(); m++){
+        if (fidelity(minima.at(m), vector) > threshold){
+            return m;
+        }
+    }
+    return -1;
+}
+
+int MinimaRegistry::registerMinimum(const std::vector<std::complex<double> >& vector, double entropy){
+    // Step 1: is it a known minimum? Keep the best entropy seen for it.
+    int m = findMinimum(vector);
+    if (m >= 0){
+        hits.at(m) += 1;
+        entropies.at(m) = std::min(entropies.at(m), entropy);
+        return m;
+    }
+    // Step 2: new minimum. Store it in canonical form if we can.
+    std::vector<std::complex<double> > stored = vector;
+    if (symmetry != nullptr){
+        symmetry->canonicalize(&stored);
+    }
+    minima.push_back(stored);
+    entropies.push_back(entropy);
+    hits.push_back(1);
+    basin_hits.push_back(0);
+    return minima.size()-1;
+}
+
+int MinimaRegistry::recordBasinHit(int index){
+    hits.at(index) += 1;
+    basin_hits.at(index) += 1;
+    return 0;
+}
+
+int MinimaRegistry::restoreMinimum(const std::vector<std::complex<double> >& vector, double entropy, int hit_count, int basin_hit_count){
+    minima.push_back(vector);
+    entropies.push_back(entropy);
+    hits.push_back(hit_count);
+    basin_hits.push_back(basin_hit_count);
+    return 0;
+}
+
+int MinimaRegistry::reset(){
+    minima.clear();
+    entropies.clear();
+    hits.clear();
+    basin_hits.clear();
+    return 0;
+}
+
+int MinimaRegistry::getMinimaCount(){
+    return minima.size();
+}
+
+int MinimaRegistry::getHits(int index){
+    return hits.at(index);
+}
+
+int MinimaRegistry::getBasinHits(int index){
+    return basin_hits.at(index);
+}
+
+double MinimaRegistry::getEntropy(int index){
+    return entropies.at(index);
+}
+
+std::vector<std::complex<double> > MinimaRegistry::getVector(int index){
+    return minima.at(index);
+}
+
+MinimaRegistry::~MinimaRegistry(){
+}
@@ -3,11 +3,12 @@
 #include "minimizer.h"
 #include "config.h"
 #include "matrix_operations.h"
+#include "rng.h"
 
-Minimizer::Minimizer(std::vector<std::complex<double> >* kraus_ops, 
+Minimizer::Minimizer(ComplexView* kraus_ops, 
                         int kraus_number, int kraus_in_dimension, int kraus_out_dimension,double eps) {
     // PARAMETERS ASSIGNMENT
-    // kraus_operators stores the pointer to a vector of double precision complex numbers. I don't want to have two large objects in memory so this is the way to go.
+    // kraus_operators stores the pointer to a view of double precision complex numbers (a vector, or a mapped file). I don't want to have two large objects in memory so this is the way to go.
     // It consists of a list of d contiguous NxN matrices, each stored in column-major order.
     // So entry (i,j) of matrix k corresponds to index k*N*N+j*N+i
     // TODO: introduce a check that kraus_ops has the right size?
@@ -18,6 +19,21 @@ Minimizer::Minimizer(std::vector<std::complex<double> >* kraus_ops,
     M = kraus_out_dimension;
     // Assign precision
     epsilon = eps; 
+    // Minimize the von Neumann entropy unless told otherwise
+    objective = OBJECTIVE_VON_NEUMANN;
+    renyi_p = DEFAULT_MINIMIZER_RENYI_P;
+    // Entropies are computed exactly unless an estimator is set
+    slq_estimator = nullptr;
+    entropy_exact = true;
+    // Steps use the full channel unless a batch is set
+    kraus_batch = 0;
+    // Plain steps unless overrelaxation is requested
+    overrelax = false;
+    overrelaxation = 1.0f;
+    // No step has been taken yet
+    residual_valid = false;
+    // Random draws come from stream 0 until told otherwise
+    setRandomStream(0);
 
     // INITIALIZATION OF MATRICES AND VECTORS
     // Start by initializing the vector_state to a zero vector, to avoid seg faults.
@@ -50,6 +66,8 @@ int Minimizer::initializeVector(std::vector<std::complex<double> >* pointer) {
         std::cout << "The input vector has the right dimension" << std::endl;
         // Copy data over, keep the pointer
         *vector_state = *pointer;
+        overrelaxation = 1.0f;
+        residual_valid = false;
         return 0;
     } else {
         // If it doesn't, generate a random vector as a fallback.
@@ -65,17 +83,13 @@ int Minimizer::initializeVector(std::vector<std::complex<double> >* pointer) {
 int Minimizer::initializeRandomVector(){
     // By construction, the pointer points to a valid vector of the right size. Note that N is fixed and cannot change.
 
-    // Step 1: Set up random number generator
-    std::random_device rd;                  // Random device to seed the generator
-    std::mt19937 gen(rd());                 // Mersenne Twister generator, seeded by rd()
-    std::normal_distribution<double> dist(0.0f, 1.0f); // Normal distribution with mean and stddev
+    // Step 1: Set up random number generator. A new run starts with plain steps.
+    RandomStream stream(RNG_DOMAIN_START_VECTOR, random_stream, random_draws++);
+    overrelaxation = 1.0f;
+    residual_valid = false;
 
     // Step 2: Generate random real and imaginary parts
-    for (int i=0; i < N; i++){
-        double real_part = dist(gen);  // Generate the real part (normal distribution)
-        double imag_part = dist(gen);  // Generate the imaginary part (normal distribution)
-        vector_state->at(i) = std::complex<double>(real_part, imag_part);
-    }
+    stream.fillComplexNormal(vector_state->data(), N);
     // Step 3: Renormalize the vector
     double norm = 0.0f;
     for (std::complex<double> entry : *vector_state){
@@ -103,7 +117,7 @@ int Minimizer::updateProjector(){
     return 0;
 }
 
-int Minimizer::applyChannel(std::vector<std::complex<double> >* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension){
+int Minimizer::applyChannel(ComplexView* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension){
     // The three pointers are for: - where kraus ops are stored; - where input matrix is stored; where output matrix needs to be stored
     // Then we need to know how many kraus operators there are, and what is their size.
     std::complex<double> one(1.0f,0.0f);
@@ -118,7 +132,7 @@ int Minimizer::applyChannel(std::vector<std::complex<double> >* kraus,std::vecto
     // Iterate over all kraus operators
     for (int m=0; m<number_kraus; m++){
         // Work with the m-th Kraus operator (update the pointer)
-        std::complex<double>* kraus_pointer = &(kraus->at(m*in_dimension*out_dimension));
+        const std::complex<double>* kraus_pointer = &(kraus->at(m*in_dimension*out_dimension));
   
         // Step 1: create temporary value Kraus[i] * in_matrix. Save in "channel_application_intermediate matrix".
         cblas_zgemm(CblasColMajor,
@@ -126,7 +140,7 @@ int Minimizer::applyChannel(std::vector<std::complex<double> >* kraus,std::vecto
             CblasNoTrans,                      // No transpose for B
             out_dimension, in_dimension, in_dimension,                  // Matrix dimensions (#rows of C, #cols of C, contracted dimension)
             &one,                    // Scalar alpha
-            reinterpret_cast<lapack_complex_t*>(kraus_pointer),  // Matrix A
+            reinterpret_cast<const lapack_complex_t*>(kraus_pointer),  // Matrix A
             out_dimension,                        // Leading dimension of A (=how many elements to skip to get to next column) (=number of rows). K is MxN so it has M rows
             reinterpret_cast<lapack_complex_t*>(in_matrix->data()),  // Matrix B
             in_dimension,                        // Leading dimension of B. in_matrix is NxN so N
@@ -142,7 +156,7 @@ int Minimizer::applyChannel(std::vector<std::complex<double> >* kraus,std::vecto
             &one,                    // Scalar alpha
             reinterpret_cast<lapack_complex_t*>(tmp_pointer->data()),  // Matrix A
             out_dimension,                        // Leading dimension of A (=how many elements to skip to get to next column) (=number of rows). K*in_matrix is MxN so it has M rows
-            reinterpret_cast<lapack_complex_t*>(kraus_pointer),  // Matrix B
+            reinterpret_cast<const lapack_complex_t*>(kraus_pointer),  // Matrix B
             in_dimension,                        // Leading dimension of B. K^H is NxM, so N
             &one,                     // Scalar beta
             reinterpret_cast<lapack_complex_t*>(out_matrix->data()),  // Matrix C (result)
@@ -152,7 +166,7 @@ int Minimizer::applyChannel(std::vector<std::complex<double> >* kraus,std::vecto
     return 0;
 }
     
-int Minimizer::applyDualChannel(std::vector<std::complex<double> >* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension){
+int Minimizer::applyDualChannel(ComplexView* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension){
     // The three pointers are for: - where kraus ops are stored; - where input matrix is stored; where output matrix needs to be stored
     // Then we need to know how many kraus operators there are, and what is their size.
     std::complex<double> one(1.0f,0.0f);
@@ -167,7 +181,7 @@ int Minimizer::applyDualChannel(std::vector<std::complex<double> >* kraus,std::v
     // Iterate over all kraus operators
     for (int m=0; m<number_kraus; m++){
         // Work with the m-th Kraus operator (update the pointer)
-        std::complex<double>* kraus_pointer = &(kraus->at(m*in_dimension*out_dimension));
+        const std::complex<double>* kraus_pointer = &(kraus->at(m*in_dimension*out_dimension));
   
         // Step 1: create temporary value Kraus[i] * in_matrix. Save in "channel_application_intermediate matrix".
         cblas_zgemm(CblasColMajor,
@@ -175,7 +189,7 @@ int Minimizer::applyDualChannel(std::vector<std::complex<double> >* kraus,std::v
             CblasNoTrans,                      // No transpose for B
             out_dimension, in_dimension, in_dimension,                  // Matrix dimensions (#rows of C, #cols of C, contracted dimension)
             &one,                    // Scalar alpha
-            reinterpret_cast<lapack_complex_t*>(kraus_pointer),  // Matrix A
+            reinterpret_cast<const lapack_complex_t*>(kraus_pointer),  // Matrix A
             out_dimension,                        // Leading dimension of A (=how many elements to skip to get to next column) (=number of rows). K is MxN so it has M rows
             reinterpret_cast<lapack_complex_t*>(in_matrix->data()),  // Matrix B
             in_dimension,                        // Leading dimension of B. in_matrix is NxN so N
@@ -191,7 +205,7 @@ int Minimizer::applyDualChannel(std::vector<std::complex<double> >* kraus,std::v
             &one,                    // Scalar alpha
             reinterpret_cast<lapack_complex_t*>(tmp_pointer->data()),  // Matrix A
             out_dimension,                        // Leading dimension of A (=how many elements to skip to get to next column) (=number of rows). K*in_matrix is MxN so it has M rows
-            reinterpret_cast<lapack_complex_t*>(kraus_pointer),  // Matrix B
+            reinterpret_cast<const lapack_complex_t*>(kraus_pointer),  // Matrix B
             in_dimension,                        // Leading dimension of B. K^H is NxM, so N
             &one,                     // Scalar beta
             reinterpret_cast<lapack_complex_t*>(out_matrix->data()),  // Matrix C (result)
@@ -201,7 +215,7 @@ int Minimizer::applyDualChannel(std::vector<std::complex<double> >* kraus,std::v
     return 0;
 }
 
-int Minimizer::applyEpsilonChannel(std::vector<std::complex<double> >* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension, double epsilon){
+int Minimizer::applyEpsilonChannel(ComplexView* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension, double epsilon){
     // Step 1: apply the channel without the epsilon
     applyChannel(kraus,in_matrix,out_matrix,number_kraus,in_dimension,out_dimension);
 
@@ -215,7 +229,7 @@ int Minimizer::applyEpsilonChannel(std::vector<std::complex<double> >* kraus,std
     return 0;
 }
 
-int Minimizer::applyDualEpsilonChannel(std::vector<std::complex<double> >* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension, double epsilon){
+int Minimizer::applyDualEpsilonChannel(ComplexView* kraus,std::vector<std::complex<double> >* in_matrix,std::vector<std::complex<double> >* out_matrix, int number_kraus, int in_dimension, int out_dimension, double epsilon){
     // Step 1: apply the channel without the epsilon
     applyDualChannel(kraus,in_matrix,out_matrix,number_kraus,in_dimension,out_dimension);
 
@@ -229,27 +243,21 @@ int Minimizer::applyDualEpsilonChannel(std::vector<std::complex<double> >* kraus
     return 0;
 }
 
-int Minimizer::stepAlgorithm(){
-    // Step 1: update the projector based on the vector
-    updateProjector();
-
-    // Step 2: compute Phi_e(rho)
-    applyEpsilonChannel(kraus_operators,input_matrix, output_matrix, d, N, M, epsilon);
-
-    // Step 3: compute log(Phi_e(rho))
-    // Step 3.1: diagonalize output matrix
+int Minimizer::logOutputMatrix(){
+    // Replace output_matrix (Hermitian, positive definite) with its matrix logarithm.
+    // Step 1: diagonalize output matrix
     std::vector<double> eigvals(M);
     zheev_wrapper('V', 'U', M, output_matrix,M,&eigvals);
-    // Step 3.2: compute log(eigs)
-    std::vector<std::complex<double> >* eig_mat = new std::vector<std::complex<double> >(N*N,std::complex<double>(0.0f,0.0f));
+    // Step 2: compute log(eigs)
+    std::vector<std::complex<double> >* eig_mat = new std::vector<std::complex<double> >(M*M,std::complex<double>(0.0f,0.0f));
     for (int i=0; i<M; i++){
-        eig_mat->at(N*i+i) = std::log(eigvals.at(i));
+        eig_mat->at(M*i+i) = std::log(eigvals.at(i));
     }
 
-    // Step 3.3: reconstruct the matrix
+    // Step 3: reconstruct the matrix
     //output matrix contains the eigenvectors as columns. Perform matrix multiplication.
     // First perform diag * eigs, store result in another temp mat
-    std::vector<std::complex<double> >* tmp_mat = new std::vector<std::complex<double> >(N*N);
+    std::vector<std::complex<double> >* tmp_mat = new std::vector<std::complex<double> >(M*M);
     std::complex<double> one(1.0f,0.0f);
     std::complex<double> zero(0.0f,0.0f);
     cblas_zgemm(CblasColMajor,CblasNoTrans,CblasConjTrans,M,M,M,&one,reinterpret_cast<lapack_complex_t*>(eig_mat->data()),M,reinterpret_cast<lapack_complex_t*>(output_matrix->data()),M,&zero,reinterpret_cast<lapack_complex_t*>(tmp_mat->data()),M);
@@ -261,16 +269,413 @@ int Minimizer::stepAlgorithm(){
     delete eig_mat;
     delete tmp_mat;
 
+    return 0;
+}
+
+int Minimizer::setObjective(int obj, int p){
+    objective = obj;
+    renyi_p = p;
+    return 0;
+}
+
+int Minimizer::setEntropyEstimator(SLQEstimator* estimator){
+    slq_estimator = estimator;
+    return 0;
+}
+
+bool Minimizer::useEntropyEstimator(){
+    // Only the von Neumann entropy is estimated: the Renyi path is already cheap, and the min-entropy is not a trace function
+    return slq_estimator != nullptr && objective == OBJECTIVE_VON_NEUMANN;
+}
+
+int Minimizer::estimateEntropy(){
+    std::vector<std::complex<double> > W(M*d);
+    krausImages(&W);
+    // Diagonalizing the Gram matrix of W is exact, and cheaper than even the fewest probes unless d is much larger than M
+    int r = std::min(d, M);
+    int steps = std::min(slq_estimator->getLanczosSteps(), d+1);
+    double gram_cost = double(r)*r*(std::max(d, M) + r);
+    double probes_cost = double(SLQ_MIN_PROBES)*steps*M*(d + steps);
+    if (gram_cost <= probes_cost){
+        return imagesEntropy(&W);
+    }
+    entropy = slq_estimator->estimateEntropy(&W, d, epsilon);
+    entropy_exact = false;
+    return 0;
+}
+
+int Minimizer::calculateImageEntropy(){
+    if (objective == OBJECTIVE_RENYI){
+        return calculateRenyiEntropy();
+    }
+    std::vector<std::complex<double> > W(M*d);
+    krausImages(&W);
+    return imagesEntropy(&W);
+}
+
+int Minimizer::gramMatrix(std::vector<std::complex<double> >* images, std::vector<std::complex<double> >* gram){
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    int r = std::min(d, M);
+    gram->resize(r*r);
+    if (d <= M){
+        cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, d, d, M, &one,
+            reinterpret_cast<lapack_complex_t*>(images->data()), M,
+            reinterpret_cast<lapack_complex_t*>(images->data()), M,
+            &zero, reinterpret_cast<lapack_complex_t*>(gram->data()), d);
+    } else {
+        cblas_zgemm(CblasColMajor, CblasNoTrans, CblasConjTrans, M, M, d, &one,
+            reinterpret_cast<lapack_complex_t*>(images->data()), M,
+            reinterpret_cast<lapack_complex_t*>(images->data()), M,
+            &zero, reinterpret_cast<lapack_complex_t*>(gram->data()), M);
+    }
+    return r;
+}
+
+int Minimizer::imagesEntropy(std::vector<std::complex<double> >* images){
+    // The nonzero spectrum of W W^H is that of the Gram matrix: sigma has eigenvalues (1-e) lambda_i + e/M, and e/M for the other M-r
+    std::vector<std::complex<double> > C;
+    int r = gramMatrix(images, &C);
+    std::vector<double> eigvals(r);
+    zheev_wrapper('N', 'U', r, &C, r, &eigvals);
+    double e = epsilon/M;
+    entropy_exact = true;
+    if (objective == OBJECTIVE_MIN_ENTROPY){
+        entropy = -std::log((1-epsilon)*std::max(eigvals.at(r-1), 0.0) + e);
+        return 0;
+    }
+    entropy = 0.0f;
+    for (int i=0; i<r; i++){
+        double x = (1-epsilon)*std::max(eigvals.at(i), 0.0) + e;
+        if (x > 0){
+            entropy -= x*std::log(x);
+        }
+    }
+    if (e > 0){
+        entropy -= (M-r)*e*std::log(e);
+    }
+    return 0;
+}
+
+int Minimizer::calculateExactEntropy(){
+    SLQEstimator* estimator = slq_estimator;
+    slq_estimator = nullptr;
+    calculateEntropy();
+    slq_estimator = estimator;
+    return 0;
+}
+
+bool Minimizer::isEntropyExact(){
+    return entropy_exact;
+}
+
+int Minimizer::setRandomStream(uint64_t stream){
+    random_stream = stream;
+    random_draws = 0;
+    return 0;
+}
+
+int Minimizer::setKrausBatch(int batch){
+    kraus_batch = batch;
+    return 0;
+}
+
+int Minimizer::objectiveOutputMatrix(){
+    // The gradient of the objective at rho is (a positive multiple of) Phi_e^*(X), with X a function of sigma = Phi_e(rho):
+    //      von Neumann:    X = -log(sigma)
+    //      Renyi-p:        X = sigma^{p-1}
+    //      min-entropy:    X = |u><u|, u the top eigenvector of sigma
+    // Since the step maximizes <v|Phi^*(X)|v>, we store log(sigma) rather than -log(sigma): its top eigenvector is the one we want.
+    if (objective == OBJECTIVE_RENYI){
+        // sigma^{p-1} with GEMMs only
+        std::complex<double> one(1.0f,0.0f);
+        std::complex<double> zero(0.0f,0.0f);
+        std::vector<std::complex<double> > sigma(*output_matrix);
+        std::vector<std::complex<double> > tmp(M*M);
+        for (int k=2; k<renyi_p; k++){
+            cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, M, M, &one,
+                reinterpret_cast<lapack_complex_t*>(output_matrix->data()), M,
+                reinterpret_cast<lapack_complex_t*>(sigma.data()), M,
+                &zero, reinterpret_cast<lapack_complex_t*>(tmp.data()), M);
+            output_matrix->swap(tmp);
+        }
+        return 0;
+    }
+    if (objective == OBJECTIVE_MIN_ENTROPY){
+        std::vector<double> eigvals(M);
+        zheev_wrapper('V', 'U', M, output_matrix, M, &eigvals);
+        std::vector<std::complex<double> > u(output_matrix->begin()+M*(M-1), output_matrix->end());
+        for (int j=0; j<M; j++){
+            for (int i=0; i<M; i++){
+                output_matrix->at(j*M+i) = u.at(i)*std::conj(u.at(j));
+            }
+        }
+        return 0;
+    }
+    return logOutputMatrix();
+}
+
+int Minimizer::outputEntropy(){
+    entropy_exact = true;
+    // Renyi-p: S_p = log(Tr sigma^p)/(1-p), with Tr sigma^p = Tr(sigma^{p-1} sigma). No eigensolver needed.
+    if (objective == OBJECTIVE_RENYI){
+        std::vector<std::complex<double> > sigma(*output_matrix);
+        objectiveOutputMatrix();
+        double trace = 0.0f;
+        for (int i=0; i < M*M; i++){
+            // Both matrices are Hermitian, so Tr(AB) = sum_ij A_ij conj(B_ij)
+            trace += (output_matrix->at(i)*std::conj(sigma.at(i))).real();
+        }
+        output_matrix->swap(sigma);
+        entropy = std::log(trace)/(1-renyi_p);
+        return 0;
+    }
+    std::vector<double> eigvals = std::vector<double>(M);
+    std::vector<std::complex<double> > tmp(*output_matrix);
+    zheev_wrapper('N', 'U', M,&tmp,M,&eigvals);
+    if (objective == OBJECTIVE_MIN_ENTROPY){
+        entropy = -std::log(eigvals.at(M-1));
+        return 0;
+    }
+    entropy = 0.0f;
+    for (int i = 0; i< M; i++){
+        // WARNING: We are assuming that the diagonal here is real (which it is since it contains the eigs of a hermitian matrix)
+        entropy -= eigvals.at(i)*std::log(eigvals.at(i));
+    }
+    return 0;
+}
+
+int Minimizer::krausImages(std::vector<std::complex<double> >* images){
+    // Column k is K_k v. Then Phi(|v><v|) = images images^H, which has rank at most d.
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    for (int k=0; k<d; k++){
+        cblas_zgemv(CblasColMajor, CblasNoTrans, M, N, &one,
+            reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*M))), M,
+            reinterpret_cast<lapack_complex_t*>(vector_state->data()), 1,
+            &zero, reinterpret_cast<lapack_complex_t*>(&(images->at(k*M))), 1);
+    }
+    return 0;
+}
+
+int Minimizer::imagesOutputMatrix(std::vector<std::complex<double> >* images, int rank){
+    std::complex<double> zero(0.0f,0.0f);
+    std::complex<double> scale(1-epsilon, 0.0f);
+    cblas_zgemm(CblasColMajor, CblasNoTrans, CblasConjTrans, M, M, rank, &scale,
+        reinterpret_cast<lapack_complex_t*>(images->data()), M,
+        reinterpret_cast<lapack_complex_t*>(images->data()), M,
+        &zero, reinterpret_cast<lapack_complex_t*>(output_matrix->data()), M);
+    for (int i=0; i<M; i++){
+        output_matrix->at(i*M+i) += std::complex<double>(epsilon/M, 0.0f);
+    }
+    return 0;
+}
+
+int Minimizer::updateOutputMatrix(){
+    // For rho = |v><v|, Phi(rho) = W W^H where the columns of W (M x d) are w_k = K_k v. This is O(d M N + d M^2) instead of O(d N^3).
+    std::vector<std::complex<double> > W(M*d);
+    krausImages(&W);
+    return imagesOutputMatrix(&W, d);
+}
+
+int Minimizer::stepSubsampled(){
+    // Far from a minimum, the step does not need the exact channel. Draw b = kraus_batch Kraus operators with probability p_k proportional
+    // to |K_k|_F^2, so that
+    //      Phi(rho) ~ 1/b sum_s K_{k_s} rho K_{k_s}^H / p_{k_s}
+    // is unbiased, and rescale the sample so that the estimate of Phi(rho) has unit trace. The step is then the usual one on the sampled
+    // channel, which costs O(b N^2 M) instead of O(d N^2 M).
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+
+    // Step 1: importance weights, once per channel
+    if (kraus_weights.empty()){
+        for (int k=0; k<d; k++){
+            double norm = cblas_dznrm2(N*M, reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*M))), 1);
+            kraus_weights.push_back(norm*norm);
+        }
+    }
+    double total_weight = 0.0f;
+    for (double weight : kraus_weights){
+        total_weight += weight;
+    }
+
+    // Step 2: Set up random number generator
+    RandomStream stream(RNG_DOMAIN_SUBSAMPLING, random_stream, random_draws++);
+    std::discrete_distribution<int> pick(kraus_weights.begin(), kraus_weights.end());
+
+    // Step 3: draw the sample, with the weights 1/sqrt(b p_k) absorbed into the operators, and its images of v
+    std::vector<std::complex<double> > sampled(size_t(kraus_batch)*N*M);
+    std::vector<std::complex<double> > W(M*kraus_batch);
+    for (int s=0; s<kraus_batch; s++){
+        int k = pick(stream);
+        double weight = std::sqrt(total_weight/(kraus_batch*kraus_weights.at(k)));
+        for (int i=0; i<N*M; i++){
+            sampled.at(size_t(s)*N*M+i) = weight*kraus_operators->at(k*N*M+i);
+        }
+        cblas_zgemv(CblasColMajor, CblasNoTrans, M, N, &one,
+            reinterpret_cast<lapack_complex_t*>(&(sampled.at(size_t(s)*N*M))), M,
+            reinterpret_cast<lapack_complex_t*>(vector_state->data()), 1,
+            &zero, reinterpret_cast<lapack_complex_t*>(&(W.at(s*M))), 1);
+    }
+
+    // Step 4: normalize the sampled output. If v is annihilated by the whole sample, there is nothing to step on.
+    double trace = std::pow(cblas_dznrm2(M*kraus_batch, reinterpret_cast<lapack_complex_t*>(W.data()), 1), 2);
+    if (trace == 0){
+        return 1;
+    }
+    for (std::complex<double>& entry : sampled){
+        entry /= std::sqrt(trace);
+    }
+    for (std::complex<double>& entry : W){
+        entry /= std::sqrt(trace);
+    }
+
+    // Step 5: the usual step, on the sampled channel
+    imagesOutputMatrix(&W, kraus_batch);
+    objectiveOutputMatrix();
+    ComplexView sampled_view(sampled);
+    applyDualChannel(&sampled_view, output_matrix, input_matrix, kraus_batch, M, N);
+    std::vector<double> eigvals(N);
+    zheev_wrapper('V', 'U', N, input_matrix, N, &eigvals);
+    for (int i=0; i<N; i++){
+        vector_state->at(i) = input_matrix->at(N*(N-1)+i);
+    }
+    return 0;
+}
+
+int Minimizer::stepRenyi(){
+    // For integer p, the gradient of Tr sigma^p at v is proportional to G v, with G = Phi^*(sigma^{p-1}) positive semidefinite.
+    // Instead of diagonalizing G we take v <- G v / |G v|. Since <Gv|G|Gv>/<Gv|Gv> >= <v|G|v> for positive G, and Tr sigma^p is convex,
+    // the objective still cannot get worse. G v is never formed as a matrix:
+    //      G v = sum_k K_k^H sigma^{p-1} K_k v,    sigma = (1-e) W W^H + e/M I,   W = [K_0 v, ..., K_{d-1} v]
+    // so the whole step only needs M x d and d x d products: O(d M N + p M d^2) instead of O(d N^3 + M^3).
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    std::complex<double> scale(1-epsilon, 0.0f);
+    std::complex<double> shift(epsilon/M, 0.0f);
+
+    // Step 1: Kraus images of the vector
+    std::vector<std::complex<double> > W(M*d);
+    krausImages(&W);
+
+    // Step 2: Y = sigma^{p-1} W, one application of sigma at a time
+    std::vector<std::complex<double> > Y(W);
+    std::vector<std::complex<double> > gram(d*d);
+    std::vector<std::complex<double> > next(M*d);
+    for (int k=1; k<renyi_p; k++){
+        // gram = W^H Y, then next = (1-e) W gram + e/M Y
+        cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, d, d, M, &one,
+            reinterpret_cast<lapack_complex_t*>(W.data()), M,
+            reinterpret_cast<lapack_complex_t*>(Y.data()), M,
+            &zero, reinterpret_cast<lapack_complex_t*>(gram.data()), d);
+        next = Y;
+        cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, d, d, &scale,
+            reinterpret_cast<lapack_complex_t*>(W.data()), M,
+            reinterpret_cast<lapack_complex_t*>(gram.data()), d,
+            &shift, reinterpret_cast<lapack_complex_t*>(next.data()), M);
+        Y.swap(next);
+    }
+
+    // Step 3: G v = sum_k K_k^H y_k
+    std::vector<std::complex<double> > previous(*vector_state);
+    std::fill(vector_state->begin(), vector_state->end(), zero);
+    for (int k=0; k<d; k++){
+        cblas_zgemv(CblasColMajor, CblasConjTrans, M, N, &one,
+            reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*M))), M,
+            reinterpret_cast<lapack_complex_t*>(&(Y.at(k*M))), 1,
+            &one, reinterpret_cast<lapack_complex_t*>(vector_state->data()), 1);
+    }
+
+    // Step 4: how far v was from a fixed point. With mu = <v|G|v> and r = |G v - mu v|, the Rayleigh quotient of the next vector
+    // is at least |G v|^2/mu = mu + r^2/mu, so r^2/mu is a lower bound on the gain of the step.
+    std::complex<double> mu;
+    cblas_zdotc_sub(N, reinterpret_cast<lapack_complex_t*>(previous.data()), 1, reinterpret_cast<lapack_complex_t*>(vector_state->data()), 1, reinterpret_cast<lapack_complex_t*>(&mu));
+    double norm = cblas_dznrm2(N, reinterpret_cast<lapack_complex_t*>(vector_state->data()), 1);
+    double residual = 0.0f;
+    for (int i=0; i<N; i++){
+        residual += std::norm(vector_state->at(i) - mu.real()*previous.at(i));
+    }
+    residual_valid = mu.real() > 0 && norm > 0;
+    if (residual_valid){
+        step_residual = std::sqrt(residual)/norm;
+        step_gain = residual/mu.real()*gainScale();
+        step_infidelity = residual/(norm*norm);
+    }
+
+    // Step 5: normalize
+    for (int i=0; i<N; i++){
+        vector_state->at(i) /= norm;
+    }
+    return 0;
+}
+
+int Minimizer::calculateRenyiEntropy(){
+    // Tr sigma^p = sum_k binom(p,k) (1-e)^k (e/M)^(p-k) Tr (W W^H)^k, and Tr (W W^H)^k = Tr C^k for the smaller Gram matrix C of W.
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    std::vector<std::complex<double> > W(M*d);
+    krausImages(&W);
+
+    // Step 1: C = W^H W (d x d) or W W^H (M x M), whichever is smaller
+    std::vector<std::complex<double> > C;
+    int r = gramMatrix(&W, &C);
+
+    // Step 2: accumulate the binomial expansion, with the powers of C from repeated GEMMs
+    double e = epsilon/M;
+    double trace = std::pow(e, renyi_p)*M;      // k = 0 term
+    double binomial = 1.0f;
+    std::vector<std::complex<double> > power(C);
+    std::vector<std::complex<double> > tmp(r*r);
+    for (int k=1; k<=renyi_p; k++){
+        binomial *= double(renyi_p-k+1)/k;
+        double power_trace = 0.0f;
+        for (int i=0; i<r; i++){
+            power_trace += power.at(i*r+i).real();
+        }
+        trace += binomial*std::pow(1-epsilon, k)*std::pow(e, renyi_p-k)*power_trace;
+        if (k < renyi_p){
+            cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, r, r, r, &one,
+                reinterpret_cast<lapack_complex_t*>(power.data()), r,
+                reinterpret_cast<lapack_complex_t*>(C.data()), r,
+                &zero, reinterpret_cast<lapack_complex_t*>(tmp.data()), r);
+            power.swap(tmp);
+        }
+    }
+    entropy = std::log(trace)/(1-renyi_p);
+    entropy_exact = true;
+    return 0;
+}
+
+int Minimizer::stepAlgorithm(){
+    // Integer Renyi-p has its own, eigensolver-free step
+    if (objective == OBJECTIVE_RENYI){
+        return stepRenyi();
+    }
+    // Early in a run, a random subset of the Kraus operators is enough
+    if (kraus_batch > 0 && kraus_batch < d && stepSubsampled() == 0){
+        return 0;
+    }
+
+    // Step 1: update the projector based on the vector
+    updateProjector();
+
+    // Step 2: compute Phi_e(rho)
+    applyEpsilonChannel(kraus_operators,input_matrix, output_matrix, d, N, M, epsilon);
+
+    // Step 3: compute log(Phi_e(rho)), or what replaces it for the selected objective
+    objectiveOutputMatrix();
+
     // As far as I can tell, the matrix logarithm is calculated correctly.
 
     // Step 4: compute Phi_e^*(log(Phi_e(rho)))
     applyDualChannel(kraus_operators,output_matrix,input_matrix,d,M,N);
 
     // Step 5: find eigenvector with highest eigenvalues
-    eigvals.resize(N);
+    std::vector<double> eigvals(N);
     zheev_wrapper('V', 'U', N, input_matrix,N,&eigvals);
 
-    
+    // Step 6: how far the vector was from a fixed point. The spectrum is already there, so this is almost free.
+    measureResidual(eigvals);
 
     // Update the vector state to the last column, which corresponds to the highest eigenvalue.
     for (int i=0; i< N; i++){
@@ -282,23 +687,50 @@ int Minimizer::stepAlgorithm(){
     return 0;
 }
 
+int Minimizer::branchVectors(int count, std::vector<std::complex<double> >* branches){
+    // stepAlgorithm keeps the top eigenvector of Phi_e^*(log(Phi_e(rho))). Near-degenerate top eigenvalues make the others just as
+    // plausible, so return the count best, for beam search. Only these are computed, not the whole spectrum.
+    count = std::max(1, std::min(count, N));
+    residual_valid = false;
+
+    // Step 1: compute log(Phi_e(rho)), or what replaces it, using that the input has rank one
+    updateOutputMatrix();
+    objectiveOutputMatrix();
+
+    // Step 2: compute Phi_e^*(log(Phi_e(rho)))
+    applyDualChannel(kraus_operators, output_matrix, input_matrix, d, M, N);
+
+    // Step 3: top count eigenvectors. They come in ascending order: reverse them.
+    std::vector<double> eigvals(N);
+    std::vector<std::complex<double> > Z(N*count);
+    zheevr_wrapper('U', N, input_matrix, N, N-count+1, N, &eigvals, &Z, N);
+    branches->resize(N*count);
+    for (int j=0; j<count; j++){
+        std::copy(Z.begin()+N*(count-1-j), Z.begin()+N*(count-j), branches->begin()+N*j);
+    }
+    return count;
+}
+
 int Minimizer::calculateEntropy(){
-    // Get the vN entropy of Phi_e(state).
+    // Get the entropy of Phi_e(state): von Neumann, Renyi-p or min-entropy depending on the objective.
     // This works, pending verification on the application of the EpsilonChannel.
 
-    updateProjector();
-    applyEpsilonChannel(kraus_operators, input_matrix, output_matrix, d, N, M, epsilon);
-    std::vector<double> eigvals = std::vector<double>(N);
-    std::vector<std::complex<double> > tmp(M*M);
-    for (int i=0; i < M*M; i++){
-        tmp.at(i) = output_matrix->at(i);
+    // Integer Renyi-p does not need Phi_e(rho) itself, and neither does the estimate of the von Neumann entropy
+    if (objective == OBJECTIVE_RENYI){
+        return calculateRenyiEntropy();
     }
-    zheev_wrapper('N', 'U', M,&tmp,M,&eigvals);
-    entropy = 0.0f;
-    for (int i = 0; i< M; i++){
-        // WARNING: We are assuming that the diagonal here is real (which it is since it contains the eigs of a hermitian matrix)
-        entropy -= eigvals.at(i)*std::log(eigvals.at(i));
+    if (useEntropyEstimator()){
+        return estimateEntropy();
     }
+    // While the steps are subsampled, the entropy must stay cheap to track: use that the input has rank one
+    if (kraus_batch > 0){
+        updateOutputMatrix();
+        return outputEntropy();
+    }
+
+    updateProjector();
+    applyEpsilonChannel(kraus_operators, input_matrix, output_matrix, d, N, M, epsilon);
+    outputEntropy();
     //std::cout<< "Current entropy: " << std::fixed << std::setprecision(PRINT_PRECISION) <<entropy << std::endl;
 
     return 0;
@@ -306,11 +738,147 @@ int Minimizer::calculateEntropy(){
 }
 
 int Minimizer::step(){
+    // Only the full steps measure their residual
+    residual_valid = false;
+    // Subsampled steps are noisy: extrapolating them makes no sense
+    if (overrelax && kraus_batch == 0){
+        return stepOverrelaxed();
+    }
     stepAlgorithm();
     calculateEntropy();
     return 0;
 }
 
+int Minimizer::stepOverrelaxed(){
+    // Adaptive overrelaxation (Salakhutdinov and Roweis, 2003). The plain step v -> w never increases the objective, and near a minimum
+    // consecutive steps point the same way. Try u = v + eta (w - v) instead: grow eta while that still does not increase the objective,
+    // and go back to the plain step with eta = 1 when it does. Costs one more entropy evaluation per step, two when the extrapolation fails.
+    double previous_entropy = entropy;
+    std::vector<std::complex<double> > previous(*vector_state);
+
+    // Step 1: plain step
+    stepAlgorithm();
+    std::vector<std::complex<double> > plain(*vector_state);
+
+    // Step 2: fix the phase of w, so that <v|w> is real and positive and w - v is a direction
+    std::complex<double> overlap;
+    cblas_zdotc_sub(N, reinterpret_cast<lapack_complex_t*>(previous.data()), 1, reinterpret_cast<lapack_complex_t*>(plain.data()), 1, reinterpret_cast<lapack_complex_t*>(&overlap));
+    if (std::abs(overlap) > 0){
+        for (std::complex<double>& entry : plain){
+            entry *= std::conj(overlap)/std::abs(overlap);
+        }
+    }
+
+    // Step 3: extrapolate, and keep the result if the objective did not increase
+    for (int i=0; i<N; i++){
+        vector_state->at(i) = previous.at(i) + overrelaxation*(plain.at(i) - previous.at(i));
+    }
+    double norm = cblas_dznrm2(N, reinterpret_cast<lapack_complex_t*>(vector_state->data()), 1);
+    for (int i=0; i<N; i++){
+        vector_state->at(i) /= norm;
+    }
+    calculateEntropy();
+    if (previous_entropy < 0 || entropy <= previous_entropy){
+        overrelaxation = std::min(overrelaxation*OVERRELAXATION_GROWTH, OVERRELAXATION_MAX);
+        return 0;
+    }
+
+    // Step 4: the extrapolation overshot, take the plain step
+    *vector_state = plain;
+    calculateEntropy();
+    overrelaxation = 1.0f;
+    return 0;
+}
+
+int Minimizer::measureResidual(const std::vector<double>& eigvals){
+    // The step operator is A = U diag(lambda) U^H, with U in input_matrix, and v has weights c_i = |<u_i|v>|^2 on its eigenvectors.
+    // With mu = <v|A|v> and w = u_{N-1} the next vector:
+    //      |A v - mu v|^2      = sum_i (lambda_i - mu)^2 c_i           eigen-residual, zero exactly at a fixed point
+    //      lambda_max - mu     = sum_i (lambda_max - lambda_i) c_i     gain of the step. The objective is concave, so the entropy decreases at least this much.
+    //      1 - |<v|w>|^2       = sum_{i<N-1} c_i                       infidelity between the iterates
+    // Every term is non-negative, so the sums stay accurate far below machine precision relative to lambda. Costs one N x N product.
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    std::vector<std::complex<double> > coefficients(N);
+    cblas_zgemv(CblasColMajor, CblasConjTrans, N, N, &one,
+        reinterpret_cast<lapack_complex_t*>(input_matrix->data()), N,
+        reinterpret_cast<lapack_complex_t*>(vector_state->data()), 1,
+        &zero, reinterpret_cast<lapack_complex_t*>(coefficients.data()), 1);
+    double mu = 0.0f;
+    for (int i=0; i<N; i++){
+        mu += eigvals.at(i)*std::norm(coefficients.at(i));
+    }
+    double residual = 0.0f;
+    double gain = 0.0f;
+    double infidelity = 0.0f;
+    for (int i=0; i<N; i++){
+        double weight = std::norm(coefficients.at(i));
+        residual += std::pow(eigvals.at(i) - mu, 2)*weight;
+        gain += (eigvals.at(N-1) - eigvals.at(i))*weight;
+        if (i < N-1){
+            infidelity += weight;
+        }
+    }
+    double scale = std::max(std::abs(eigvals.at(0)), std::abs(eigvals.at(N-1)));
+    step_residual = scale > 0 ? std::sqrt(residual)/scale : 0;
+    step_gain = gain*gainScale();
+    step_infidelity = infidelity;
+    residual_valid = true;
+    return 0;
+}
+
+double Minimizer::gainScale(){
+    // The step maximizes <v|Phi^*(X)|v> with X from objectiveOutputMatrix, and Phi_e = (1-e) Phi + e/M I. To first order in the step:
+    //      von Neumann:    dS = -(1-e) d<v|Phi^*(log sigma)|v>
+    //      Renyi-p:        dS = -p (1-e)/((p-1) Tr sigma^p) d<v|Phi^*(sigma^{p-1})|v>,     Tr sigma^p = exp((1-p) S)
+    //      min-entropy:    dS = -(1-e)/lambda_max d<v|Phi^*(|u><u|)|v>,                    lambda_max = exp(-S)
+    // where S is the entropy of the current vector.
+    if (objective == OBJECTIVE_RENYI){
+        return renyi_p*(1-epsilon)/((renyi_p-1)*std::exp((1-renyi_p)*entropy));
+    }
+    if (objective == OBJECTIVE_MIN_ENTROPY){
+        return (1-epsilon)*std::exp(entropy);
+    }
+    return 1-epsilon;
+}
+
+int Minimizer::getStepResidual(double* residual, double* gain, double* infidelity){
+    if (!residual_valid){
+        return 1;
+    }
+    *residual = step_residual;
+    *gain = step_gain;
+    *infidelity = step_infidelity;
+    return 0;
+}
+
+int Minimizer::setOverrelaxation(bool use){
+    overrelax = use;
+    overrelaxation = 1.0f;
+    return 0;
+}
+
+json Minimizer::getSnapshot(){
+    return {
+        {"entropy", encodeDouble(entropy)},
+        {"entropy_exact", entropy_exact},
+        {"overrelaxation", encodeDouble(overrelaxation)},
+        {"random_stream", random_stream},
+        {"random_draws", random_draws}
+    };
+}
+
+int Minimizer::restoreSnapshot(const json& snapshot){
+    entropy = decodeDouble(snapshot.at("entropy"));
+    entropy_exact = snapshot.at("entropy_exact").get<bool>();
+    overrelaxation = decodeDouble(snapshot.at("overrelaxation"));
+    random_stream = snapshot.at("random_stream").get<uint64_t>();
+    random_draws = snapshot.at("random_draws").get<uint64_t>();
+    // The residual is measured afresh by the next step
+    residual_valid = false;
+    return 0;
+}
+
 /// GETTERS
 std::vector<std::complex<double> >* Minimizer::getState(){
     updateProjector();
@@ -329,6 +897,10 @@ std::vector<std::complex<double> > Minimizer::getVector(){
     return out;
 }
 
+std::vector<std::complex<double> >* Minimizer::getVectorState(){
+    return vector_state;
+}
+
 double* Minimizer::getEntropy(){
     return &entropy;
 }
@@ -0,0 +1,606 @@
+#include "common_includes.h"
+#include "mps_minimizer.h"
+#include "config.h"
+#include "matrix_operations.h"
+#include "rng.h"
+
+MPSMinimizer::MPSMinimizer(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, int copies, int bond_dimension, EntropyConfig* conf){
+    // Save the channel and the shape of the MPS
+    d = kraus_number;
+    N = kraus_in_dimension;
+    M = kraus_out_dimension;
+    n = copies;
+    D = bond_dimension;
+    config = conf;
+
+    // Bond dimensions: never larger than what the Schmidt rank across the cut allows, so that every QR below is of a tall matrix
+    bonds = std::vector<int>(n+1, 1);
+    for (int s=1; s<n; s++){
+        bonds.at(s) = std::min(D, bonds.at(s-1)*N);
+    }
+    for (int s=n-1; s>0; s--){
+        bonds.at(s) = std::min(bonds.at(s), bonds.at(s+1)*N);
+    }
+
+    // Step 1: the Gram operators K_a^H K_b. Kraus operators are d contiguous MxN matrices in column-major order.
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    gram_operators = std::vector<std::complex<double> >(d*d*N*N);
+    for (int a=0; a<d; a++){
+        for (int b=0; b<d; b++){
+            cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, N, N, M, &one,
+                reinterpret_cast<const lapack_complex_t*>(&(kraus_ops->at(a*N*M))), M,
+                reinterpret_cast<const lapack_complex_t*>(&(kraus_ops->at(b*N*M))), M,
+                &zero, reinterpret_cast<lapack_complex_t*>(&(gram_operators.at((a*d+b)*N*N))), N);
+        }
+    }
+
+    // Step 2: the two-copy operator W = sum_{a,b} K_b^H K_a (x) K_a^H K_b. This is O(d^2 N^4), done once.
+    int NN = N*N;
+    two_copy_operator = std::vector<std::complex<double> >(NN*NN, zero);
+    for (int a=0; a<d; a++){
+        for (int b=0; b<d; b++){
+            std::complex<double>* first = &(gram_operators.at((b*d+a)*NN));
+            std::complex<double>* second = &(gram_operators.at((a*d+b)*NN));
+            for (int i2=0; i2<N; i2++){
+                for (int i1=0; i1<N; i1++){
+                    for (int j2=0; j2<N; j2++){
+                        for (int j1=0; j1<N; j1++){
+                            two_copy_operator.at((j1+N*j2) + NN*(i1+N*i2)) += first[i1*N+j1]*second[i2*N+j2];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Start from the product of the first basis vectors, to avoid seg faults
+    sites = std::vector<std::vector<std::complex<double> > >(n);
+    for (int s=0; s<n; s++){
+        sites.at(s) = std::vector<std::complex<double> >(bonds.at(s)*N*bonds.at(s+1), zero);
+        sites.at(s).at(0) = one;
+    }
+    left_environments = std::vector<std::vector<std::complex<double> > >(n+1);
+    right_environments = std::vector<std::vector<std::complex<double> > >(n+1);
+    left_environments.at(0) = std::vector<std::complex<double> >(1, one);
+    right_environments.at(n) = std::vector<std::complex<double> >(1, one);
+
+    purity = -1;
+    MOE = -1;
+    sweeps = 0;
+    random_mps_count = 0;
+
+    // Setup logging and messages
+    message_handler = new MessageHandler();
+    message_handler->createPrinter();
+    if (config->use_custom_log_file){
+        message_handler->createLogger(config->log_file);
+    } else {
+        message_handler->createLogger();
+    }
+    message_handler->setLogging(config->log);
+    message_handler->setPrinting(config->print);
+}
+
+int MPSMinimizer::qrFactor(std::vector<std::complex<double> >* A, int m, int k, std::vector<std::complex<double> >* R){
+    // Step 1: QR decomposition, with a workspace query first
+    std::vector<std::complex<double> > tau(k);
+    std::complex<double> work_size;
+    zgeqrfp_wrapper(m, k, A, m, &tau, &work_size, -1);
+    int lwork = static_cast<int>(work_size.real());
+    std::vector<std::complex<double> > work(std::max(lwork, 1));
+    zgeqrfp_wrapper(m, k, A, m, &tau, &work, lwork);
+
+    // Step 2: copy R out of the upper triangle
+    *R = std::vector<std::complex<double> >(k*k, std::complex<double>(0.0f,0.0f));
+    for (int j=0; j<k; j++){
+        for (int i=0; i<=j; i++){
+            R->at(j*k+i) = A->at(j*m+i);
+        }
+    }
+
+    // Step 3: form Q in place
+    zungqr_wrapper(m, k, k, A, m, &tau, &work_size, -1);
+    lwork = static_cast<int>(work_size.real());
+    work.resize(std::max(lwork, 1));
+    zungqr_wrapper(m, k, k, A, m, &tau, &work, lwork);
+    return 0;
+}
+
+int MPSMinimizer::moveCenterRight(int s){
+    // Site s as a (Dl N) x Dr matrix is Q R. Keep Q (left-canonical), and multiply site s+1 by R from the left.
+    int Dl = bonds.at(s);
+    int Dr = bonds.at(s+1);
+    std::vector<std::complex<double> > R;
+    qrFactor(&sites.at(s), Dl*N, Dr, &R);
+
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    int columns = N*bonds.at(s+2);
+    std::vector<std::complex<double> > next(sites.at(s+1));
+    cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, Dr, columns, Dr, &one,
+        reinterpret_cast<lapack_complex_t*>(R.data()), Dr,
+        reinterpret_cast<lapack_complex_t*>(next.data()), Dr,
+        &zero, reinterpret_cast<lapack_complex_t*>(sites.at(s+1).data()), Dr);
+    return 0;
+}
+
+int MPSMinimizer::moveCenterLeft(int s){
+    // Site s as a Dl x (N Dr) matrix A. Then A^H = Q R, so A = R^H Q^H: keep Q^H (right-canonical), and multiply site s-1 by R^H from the right.
+    int Dl = bonds.at(s);
+    int Dr = bonds.at(s+1);
+    int columns = N*Dr;
+    std::vector<std::complex<double> > X(columns*Dl);
+    for (int a=0; a<Dl; a++){
+        for (int c=0; c<columns; c++){
+            X.at(a*columns+c) = std::conj(sites.at(s).at(c*Dl+a));
+        }
+    }
+    std::vector<std::complex<double> > R;
+    qrFactor(&X, columns, Dl, &R);
+    for (int a=0; a<Dl; a++){
+        for (int c=0; c<columns; c++){
+            sites.at(s).at(c*Dl+a) = std::conj(X.at(a*columns+c));
+        }
+    }
+
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    int rows = bonds.at(s-1)*N;
+    std::vector<std::complex<double> > previous(sites.at(s-1));
+    cblas_zgemm(CblasColMajor, CblasNoTrans, CblasConjTrans, rows, Dl, Dl, &one,
+        reinterpret_cast<lapack_complex_t*>(previous.data()), rows,
+        reinterpret_cast<lapack_complex_t*>(R.data()), Dl,
+        &zero, reinterpret_cast<lapack_complex_t*>(sites.at(s-1).data()), rows);
+    return 0;
+}
+
+int MPSMinimizer::contractLeft(const std::vector<std::complex<double> >& E, const std::vector<std::complex<double> >& A, int Dl, int Dr, std::vector<std::complex<double> >* out){
+    // Absorb one site into a left environment: both kets, then W, then both bras. Every step is at most O(D^5 N^2) or O(D^4 N^4).
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    int NN = N*N;
+    size_t Dl2 = size_t(Dl)*Dl;
+    size_t Dr2 = size_t(Dr)*Dr;
+
+    // Step 1: ket of the first copy. S1[i1,a1',a2,b1,b2]
+    std::vector<std::complex<double> > S1(size_t(N)*Dr*Dl*Dl2);
+    for (size_t rest=0; rest<Dl*Dl2; rest++){
+        for (int a1p=0; a1p<Dr; a1p++){
+            for (int i1=0; i1<N; i1++){
+                std::complex<double> sum = zero;
+                for (int a1=0; a1<Dl; a1++){
+                    sum += A[a1 + Dl*(i1 + N*a1p)]*E[a1 + Dl*rest];
+                }
+                S1[i1 + N*(a1p + Dr*rest)] = sum;
+            }
+        }
+    }
+
+    // Step 2: ket of the second copy. S2[i1,a1',i2,a2',b1,b2]
+    std::vector<std::complex<double> > S2(size_t(NN)*Dr2*Dl2);
+    for (size_t b=0; b<Dl2; b++){
+        for (int a2p=0; a2p<Dr; a2p++){
+            for (int i2=0; i2<N; i2++){
+                for (int c=0; c<N*Dr; c++){
+                    std::complex<double> sum = zero;
+                    for (int a2=0; a2<Dl; a2++){
+                        sum += A[a2 + Dl*(i2 + N*a2p)]*S1[c + size_t(N)*Dr*(a2 + Dl*b)];
+                    }
+                    S2[c + size_t(N)*Dr*(i2 + N*(a2p + Dr*b))] = sum;
+                }
+            }
+        }
+    }
+
+    // Step 3: apply W on the physical indices. S3[j1,j2,a1',a2',b1,b2], one GEMM after gathering (i1,i2) together.
+    size_t rest_size = Dr2*Dl2;
+    std::vector<std::complex<double> > V(NN*rest_size);
+    for (size_t b=0; b<Dl2; b++){
+        for (int a2p=0; a2p<Dr; a2p++){
+            for (int i2=0; i2<N; i2++){
+                for (int a1p=0; a1p<Dr; a1p++){
+                    for (int i1=0; i1<N; i1++){
+                        V[(i1 + N*i2) + NN*(a1p + Dr*(a2p + Dr*b))] = S2[i1 + N*(a1p + size_t(Dr)*(i2 + N*(a2p + Dr*b)))];
+                    }
+                }
+            }
+        }
+    }
+    std::vector<std::complex<double> > S3(NN*rest_size);
+    cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, NN, rest_size, NN, &one,
+        reinterpret_cast<const lapack_complex_t*>(two_copy_operator.data()), NN,
+        reinterpret_cast<const lapack_complex_t*>(V.data()), NN,
+        &zero, reinterpret_cast<lapack_complex_t*>(S3.data()), NN);
+
+    // Step 4: bra of the first copy. S4[j2,a1',a2',b1',b2]
+    std::vector<std::complex<double> > S4(size_t(N)*Dr2*Dr*Dl);
+    for (int b2=0; b2<Dl; b2++){
+        for (int b1p=0; b1p<Dr; b1p++){
+            for (size_t a=0; a<Dr2; a++){
+                for (int j2=0; j2<N; j2++){
+                    std::complex<double> sum = zero;
+                    for (int b1=0; b1<Dl; b1++){
+                        for (int j1=0; j1<N; j1++){
+                            sum += std::conj(A[b1 + Dl*(j1 + N*b1p)])*S3[(j1 + N*j2) + NN*(a + Dr2*(b1 + size_t(Dl)*b2))];
+                        }
+                    }
+                    S4[j2 + N*(a + Dr2*(b1p + size_t(Dr)*b2))] = sum;
+                }
+            }
+        }
+    }
+
+    // Step 5: bra of the second copy
+    *out = std::vector<std::complex<double> >(Dr2*Dr2);
+    for (int b2p=0; b2p<Dr; b2p++){
+        for (size_t r=0; r<Dr2*Dr; r++){
+            std::complex<double> sum = zero;
+            for (int b2=0; b2<Dl; b2++){
+                for (int j2=0; j2<N; j2++){
+                    sum += std::conj(A[b2 + Dl*(j2 + N*b2p)])*S4[j2 + N*(r + Dr2*Dr*b2)];
+                }
+            }
+            out->at(r + Dr2*Dr*b2p) = sum;
+        }
+    }
+    return 0;
+}
+
+int MPSMinimizer::contractRight(const std::vector<std::complex<double> >& E, const std::vector<std::complex<double> >& A, int Dl, int Dr, std::vector<std::complex<double> >* out){
+    // Same as contractLeft, with the two bonds of the site exchanged
+    std::vector<std::complex<double> > reversed(A.size());
+    for (int ap=0; ap<Dr; ap++){
+        for (int i=0; i<N; i++){
+            for (int a=0; a<Dl; a++){
+                reversed[ap + Dr*(i + N*a)] = A[a + Dl*(i + N*ap)];
+            }
+        }
+    }
+    return contractLeft(E, reversed, Dr, Dl, out);
+}
+
+int MPSMinimizer::updateSite(int s){
+    // The effective operator of the orthogonality center is H = B^H Phi^{(x)n*}(sigma) B, with B the isometry from the site to the full space.
+    // In the two-copy picture, the first copy keeps its ket open and the second copy its bra:
+    //     <x|H|y> = sum_{a,b} <psi| K_a^H K_b |y> <x| K_b^H K_a |psi>
+    // The top eigenvector maximizes the linearization of the (convex) purity, so the purity cannot decrease.
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    int NN = N*N;
+    int Dl = bonds.at(s);
+    int Dr = bonds.at(s+1);
+    size_t Dl2 = size_t(Dl)*Dl;
+    size_t Dr2 = size_t(Dr)*Dr;
+    const std::vector<std::complex<double> >& A = sites.at(s);
+    const std::vector<std::complex<double> >& L = left_environments.at(s);
+    const std::vector<std::complex<double> >& R = right_environments.at(s+1);
+
+    // Step 1: ket of the second copy. U1[i2,a2',a1,b1,b2]
+    std::vector<std::complex<double> > U1(size_t(N)*Dr*Dl*Dl2);
+    for (size_t b=0; b<Dl2; b++){
+        for (int a1=0; a1<Dl; a1++){
+            for (int a2p=0; a2p<Dr; a2p++){
+                for (int i2=0; i2<N; i2++){
+                    std::complex<double> sum = zero;
+                    for (int a2=0; a2<Dl; a2++){
+                        sum += A[a2 + Dl*(i2 + N*a2p)]*L[a1 + Dl*(a2 + Dl*b)];
+                    }
+                    U1[i2 + N*(a2p + Dr*(a1 + Dl*b))] = sum;
+                }
+            }
+        }
+    }
+
+    // Step 2: bra of the first copy. U2[i2,a2',j1,b1',a1,b2]
+    std::vector<std::complex<double> > U2(size_t(NN)*Dr2*Dl2);
+    for (int b2=0; b2<Dl; b2++){
+        for (int a1=0; a1<Dl; a1++){
+            for (int b1p=0; b1p<Dr; b1p++){
+                for (int j1=0; j1<N; j1++){
+                    for (int c=0; c<N*Dr; c++){
+                        std::complex<double> sum = zero;
+                        for (int b1=0; b1<Dl; b1++){
+                            sum += std::conj(A[b1 + Dl*(j1 + N*b1p)])*U1[c + size_t(N)*Dr*(a1 + Dl*(b1 + size_t(Dl)*b2))];
+                        }
+                        U2[c + size_t(N)*Dr*(j1 + N*(b1p + Dr*(a1 + size_t(Dl)*b2)))] = sum;
+                    }
+                }
+            }
+        }
+    }
+
+    // Step 3: apply W. The open physical indices are (j2, i1), the contracted ones (i2, j1). Reshuffle W and gather, then one GEMM.
+    std::vector<std::complex<double> > W(NN*NN);
+    for (int i2=0; i2<N; i2++){
+        for (int i1=0; i1<N; i1++){
+            for (int j2=0; j2<N; j2++){
+                for (int j1=0; j1<N; j1++){
+                    W[(j2 + N*i1) + NN*(i2 + N*j1)] = two_copy_operator[(j1 + N*j2) + NN*(i1 + N*i2)];
+                }
+            }
+        }
+    }
+    size_t rest_size = Dr2*Dl2;
+    std::vector<std::complex<double> > V(NN*rest_size);
+    for (size_t r=0; r<Dl2; r++){
+        for (int b1p=0; b1p<Dr; b1p++){
+            for (int j1=0; j1<N; j1++){
+                for (int a2p=0; a2p<Dr; a2p++){
+                    for (int i2=0; i2<N; i2++){
+                        V[(i2 + N*j1) + NN*(a2p + Dr*(b1p + Dr*r))] = U2[i2 + N*(a2p + size_t(Dr)*(j1 + N*(b1p + Dr*r)))];
+                    }
+                }
+            }
+        }
+    }
+    std::vector<std::complex<double> > U3(NN*rest_size);
+    cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, NN, rest_size, NN, &one,
+        reinterpret_cast<lapack_complex_t*>(W.data()), NN,
+        reinterpret_cast<lapack_complex_t*>(V.data()), NN,
+        &zero, reinterpret_cast<lapack_complex_t*>(U3.data()), NN);
+
+    // Step 4: close with the right environment. Rows are (b2, j2, b2'), columns (a1, i1, a1'), both in the layout of the site tensor.
+    int m = Dl*N*Dr;
+    std::vector<std::complex<double> > H(size_t(m)*m);
+    for (int a1p=0; a1p<Dr; a1p++){
+        for (int i1=0; i1<N; i1++){
+            for (int a1=0; a1<Dl; a1++){
+                int col = a1 + Dl*(i1 + N*a1p);
+                for (int b2p=0; b2p<Dr; b2p++){
+                    for (int j2=0; j2<N; j2++){
+                        for (int b2=0; b2<Dl; b2++){
+                            int row = b2 + Dl*(j2 + N*b2p);
+                            std::complex<double> sum = zero;
+                            for (int b1p=0; b1p<Dr; b1p++){
+                                for (int a2p=0; a2p<Dr; a2p++){
+                                    sum += U3[(j2 + N*i1) + NN*(a2p + Dr*(b1p + Dr*(a1 + size_t(Dl)*b2)))]*R[a1p + Dr*(a2p + Dr*(b1p + size_t(Dr)*b2p))];
+                                }
+                            }
+                            H[row + size_t(m)*col] = sum;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Step 5: H is Hermitian up to rounding. Symmetrize, then take the eigenvector with the highest eigenvalue.
+    for (int j=0; j<m; j++){
+        for (int i=0; i<=j; i++){
+            std::complex<double> h = 0.5*(H[i + size_t(m)*j] + std::conj(H[j + size_t(m)*i]));
+            H[i + size_t(m)*j] = h;
+            H[j + size_t(m)*i] = std::conj(h);
+        }
+    }
+    std::vector<double> eigvals(m);
+    zheev_wrapper('V', 'U', m, &H, m, &eigvals);
+    for (int i=0; i<m; i++){
+        sites.at(s).at(i) = H.at(size_t(m)*(m-1)+i);
+    }
+    return 0;
+}
+
+int MPSMinimizer::initializeRandomMPS(){
+    // Step 1: Set up random number generator. Every random MPS has its own stream.
+    RandomStream stream(RNG_DOMAIN_MPS, random_mps_count++);
+
+    // Step 2: Gaussian site tensors
+    for (int s=0; s<n; s++){
+        stream.fillComplexNormal(sites.at(s).data(), sites.at(s).size());
+    }
+
+    // Step 3: right-canonical form, building the right environments on the way. The center ends up at site 0.
+    for (int s=n-1; s>0; s--){
+        moveCenterLeft(s);
+        contractRight(right_environments.at(s+1), sites.at(s), bonds.at(s), bonds.at(s+1), &right_environments.at(s));
+    }
+
+    // Step 4: the norm of the state is the norm of the center
+    double norm = 0.0f;
+    for (std::complex<double> entry : sites.at(0)){
+        norm += std::norm(entry);
+    }
+    norm = std::sqrt(norm);
+    for (int i=0; i<sites.at(0).size(); i++){
+        sites.at(0).at(i) /= norm;
+    }
+
+    sweeps = 0;
+    calculatePurity();
+    return 0;
+}
+
+int MPSMinimizer::sweep(){
+    // Step 1: left to right. The center starts at site 0.
+    for (int s=0; s<n-1; s++){
+        updateSite(s);
+        moveCenterRight(s);
+        contractLeft(left_environments.at(s), sites.at(s), bonds.at(s), bonds.at(s+1), &left_environments.at(s+1));
+    }
+    // Step 2: right to left, back to site 0
+    for (int s=n-1; s>0; s--){
+        updateSite(s);
+        moveCenterLeft(s);
+        contractRight(right_environments.at(s+1), sites.at(s), bonds.at(s), bonds.at(s+1), &right_environments.at(s));
+    }
+    // A single copy has no bonds, just update the only site
+    if (n == 1){
+        updateSite(0);
+    }
+    sweeps += 1;
+    calculatePurity();
+    return 0;
+}
+
+int MPSMinimizer::runMinimization(){
+    // Sweep until the relative improvement of the purity is below tolerance. The purity never decreases, up to rounding.
+    while (sweeps < config->max_iterations){
+        double previous = purity;
+        sweep();
+        oss.str("");
+        oss << "[Sweep " << sweeps << "] Renyi-2 entropy: " << std::fixed << std::setprecision(PRINT_PRECISION) << getRenyi2Entropy();
+        message_handler->message(oss.str());
+        if (purity - previous < TENSOR_POWER_SWEEP_TOLERANCE*purity){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int MPSMinimizer::findMOE(){
+    oss.str("");
+    oss << "Will try to find the Renyi-2 MOE of " << n << " copies with bond dimension " << D << ". Running " << config->minimization_attempts << " minimization attempts.";
+    message_handler->message(oss.str());
+
+    for (int attempt=0; attempt<config->minimization_attempts; attempt++){
+        oss.str("");
+        oss << "Initializing minimization attempt " << attempt+1 << " of " << config->minimization_attempts << ".";
+        message_handler->message(oss.str());
+        initializeRandomMPS();
+
+        if (runMinimization() == 0){
+            message_handler->message("We reached the tolerance: we have converged!");
+        } else {
+            message_handler->message("We reached the maximum number of sweeps! Aborting...");
+        }
+        if (MOE < 0 || getRenyi2Entropy() < MOE){
+            MOE = getRenyi2Entropy();
+            MOE_sites = sites;
+        }
+        oss.str("");
+        oss << "Current MOE: " << std::fixed << std::setprecision(PRINT_PRECISION) << MOE;
+        message_handler->message(oss.str());
+    }
+
+    // Report the best input, per copy as well
+    oss.str("");
+    oss << "Final MOE (Renyi-2): " << std::fixed << std::setprecision(PRINT_PRECISION) << MOE << ", per copy: " << MOE/n;
+    message_handler->message(oss.str());
+    double exact_entropy;
+    if (calculateExactEntropy(&MOE_sites, &exact_entropy) == 0){
+        oss.str("");
+        oss << "von Neumann entropy of the best input: " << std::fixed << std::setprecision(PRINT_PRECISION) << exact_entropy << ", per copy: " << exact_entropy/n;
+        message_handler->message(oss.str());
+    } else {
+        oss.str("");
+        oss << "d^n is above " << TENSOR_POWER_MAX_EXACT_DIMENSION << ", skipping the von Neumann entropy of the best input.";
+        message_handler->message(oss.str());
+    }
+    return 0;
+}
+
+int MPSMinimizer::calculatePurity(){
+    // Contract both copies of the whole chain from the left. The environment at the last cut is a number.
+    std::vector<std::complex<double> > environment(1, std::complex<double>(1.0f,0.0f));
+    std::vector<std::complex<double> > next;
+    for (int s=0; s<n; s++){
+        contractLeft(environment, sites.at(s), bonds.at(s), bonds.at(s+1), &next);
+        environment.swap(next);
+    }
+    purity = environment.at(0).real();
+    return 0;
+}
+
+int MPSMinimizer::calculateExactEntropy(std::vector<std::vector<std::complex<double> > >* mps, double* out){
+    // The output has the same nonzero spectrum as the complementary output G[a,b] = <psi| K_b^H K_a |psi>, a and b running over d^n Kraus strings.
+    // G is contracted site by site, keeping the bond indices of ket and bra open: entry (a, b, alpha, beta) at a + ds*(b + ds*(alpha + Ds*beta)).
+    long long dn = 1;
+    for (int s=0; s<n; s++){
+        dn *= d;
+        if (dn > TENSOR_POWER_MAX_EXACT_DIMENSION){
+            return 1;
+        }
+    }
+    std::complex<double> zero(0.0f,0.0f);
+    std::vector<std::complex<double> > G(1, std::complex<double>(1.0f,0.0f));
+    int ds = 1;
+    for (int s=0; s<n; s++){
+        int Dl = bonds.at(s);
+        int Dr = bonds.at(s+1);
+        const std::vector<std::complex<double> >& A = mps->at(s);
+        int ds_next = ds*d;
+        std::vector<std::complex<double> > G_next(size_t(ds_next)*ds_next*Dr*Dr, zero);
+        std::vector<std::complex<double> > T(size_t(Dl)*Dr*N);
+        std::vector<std::complex<double> > Y(size_t(N)*N*Dr*Dr);
+        for (int b=0; b<ds; b++){
+            for (int a=0; a<ds; a++){
+                const std::complex<double>* Gab = &G[size_t(Dl)*Dl*(a + size_t(ds)*b)];
+                // Step 1: T_j[alpha, beta'] = sum_beta G_ab[alpha, beta] conj(A[beta, j, beta'])
+                for (int j=0; j<N; j++){
+                    for (int bp=0; bp<Dr; bp++){
+                        for (int al=0; al<Dl; al++){
+                            std::complex<double> sum = zero;
+                            for (int be=0; be<Dl; be++){
+                                sum += Gab[al + Dl*be]*std::conj(A[be + Dl*(j + N*bp)]);
+                            }
+                            T[al + Dl*(bp + Dr*j)] = sum;
+                        }
+                    }
+                }
+                // Step 2: Y_ij[alpha', beta'] = sum_alpha A[alpha, i, alpha'] T_j[alpha, beta']
+                for (int j=0; j<N; j++){
+                    for (int i=0; i<N; i++){
+                        for (int bp=0; bp<Dr; bp++){
+                            for (int ap=0; ap<Dr; ap++){
+                                std::complex<double> sum = zero;
+                                for (int al=0; al<Dl; al++){
+                                    sum += A[al + Dl*(i + N*ap)]*T[al + Dl*(bp + Dr*j)];
+                                }
+                                Y[ap + Dr*(bp + Dr*(i + N*j))] = sum;
+                            }
+                        }
+                    }
+                }
+                // Step 3: extend the Kraus strings by (a', b'), weighting with (K_b'^H K_a')[j, i]
+                for (int bn=0; bn<d; bn++){
+                    for (int an=0; an<d; an++){
+                        const std::complex<double>* X = &gram_operators[(bn*d+an)*N*N];
+                        std::complex<double>* target = &G_next[size_t(Dr)*Dr*((a + ds*an) + size_t(ds_next)*(b + ds*bn))];
+                        for (int j=0; j<N; j++){
+                            for (int i=0; i<N; i++){
+                                std::complex<double> x = X[i*N+j];
+                                for (int c=0; c<Dr*Dr; c++){
+                                    target[c] += x*Y[c + Dr*Dr*(i + N*j)];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        G.swap(G_next);
+        ds = ds_next;
+    }
+
+    // The last bond is trivial, so G is now a ds x ds density matrix
+    std::vector<double> eigvals(ds);
+    zheev_wrapper('N', 'U', ds, &G, ds, &eigvals);
+    *out = 0.0f;
+    for (int i=0; i<ds; i++){
+        if (eigvals.at(i) > 0){
+            *out -= eigvals.at(i)*std::log(eigvals.at(i));
+        }
+    }
+    return 0;
+}
+
+double MPSMinimizer::getPurity(){
+    return purity;
+}
+
+double MPSMinimizer::getRenyi2Entropy(){
+    return -std::log(purity);
+}
+
+double MPSMinimizer::getMOE(){
+    return MOE;
+}
+
+int MPSMinimizer::getBondDimension(int cut){
+    return bonds.at(cut);
+}
+
+MPSMinimizer::~MPSMinimizer(){
+    delete message_handler;
+}
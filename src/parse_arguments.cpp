@@ -1,5 +1,6 @@
 #include "argparse/argparse.hpp"
 #include "parse_arguments.h"
+#include "config.h"
 
 
 argparse::ArgumentParser* parse_arguments(int argc, char** argv){
@@ -34,6 +35,17 @@ argparse::ArgumentParser* parse_arguments(int argc, char** argv){
     haar_parser->add_argument("--output", "-o")
     .help("path to save the Kraus operators")
     .required();
+    // seed of the random number generator
+    haar_parser->add_argument("--seed")
+    .help("seed of the random number generator, to reproduce a run. Drawn at random (and printed) if not given.")
+    .scan<'u', unsigned long long>()
+    .metavar("INT");
+    // threads drawing the unitaries
+    haar_parser->add_argument("--threads")
+    .help("number of threads drawing the unitaries, 0 for one per core. The operators do not depend on it.")
+    .default_value(DEFAULT_HAAR_THREADS)
+    .scan<'i', int>()
+    .metavar("INT");
     // logging?
     haar_parser->add_argument("--logging", "-l")
     .help("enable logging")
@@ -45,6 +57,38 @@ argparse::ArgumentParser* parse_arguments(int argc, char** argv){
     .default_value(false)
     .implicit_value(true);
 
+    // SUBSUBPARSER 2: random channel from a Haar random isometry
+    argparse::ArgumentParser* stiefel_parser = new argparse::ArgumentParser("stiefel", "0.1", argparse::default_arguments::help);
+    stiefel_parser->add_description("Generate the Kraus operators of a random channel by slicing one Haar random isometry from the input to the output and environment");
+    kraus_parser->add_subparser(*stiefel_parser);
+    stiefel_parser->add_argument("-N")
+    .help("dimension of the Hilbert space")
+    .required()
+    .scan<'i', int>();
+    stiefel_parser->add_argument("-d")
+    .help("dimension of the environment, i.e. number of Kraus operators")
+    .required()
+    .scan<'i', int>();
+    // also specify path to save the kraus operators
+    stiefel_parser->add_argument("--output", "-o")
+    .help("path to save the Kraus operators")
+    .required();
+    // seed of the random number generator
+    stiefel_parser->add_argument("--seed")
+    .help("seed of the random number generator, to reproduce a run. Drawn at random (and printed) if not given.")
+    .scan<'u', unsigned long long>()
+    .metavar("INT");
+    // logging?
+    stiefel_parser->add_argument("--logging", "-l")
+    .help("enable logging")
+    .default_value(false)
+    .implicit_value(true);
+    // printing?
+    stiefel_parser->add_argument("--silent", "-s")
+    .help("disable printing")
+    .default_value(false)
+    .implicit_value(true);
+
     /*
             SUBPARSER 2: Single-shot entropy minimization
     */
@@ -61,6 +105,16 @@ argparse::ArgumentParser* parse_arguments(int argc, char** argv){
     .metavar("FILE");
 
     single_shot_parser->add_group("Other arguments");
+    // skip the checksum of the Kraus operators
+    single_shot_parser->add_argument("--no_verify")
+    .help("do not check the checksum of the Kraus operators when loading them, so that only the pages of the file that are used get read")
+    .default_value(false)
+    .implicit_value(true);
+    // sidecar cache of what is derived from the Kraus operators
+    single_shot_parser->add_argument("--channel_cache")
+    .help("keep what is derived from the Kraus operators in a sidecar next to them (FILE.cache), keyed by their checksum, and reuse it in later runs: the checksum verification")
+    .default_value(false)
+    .implicit_value(true);
     // save flag for final vector
     single_shot_parser->add_argument("--save", "-S")
     .help("save the final vector")
@@ -97,6 +151,18 @@ argparse::ArgumentParser* parse_arguments(int argc, char** argv){
     .default_value(std::string(""))
     .metavar("FILE");
 
+    // full snapshots of the run, to resume it
+    single_shot_parser->add_argument("--snapshot")
+    .help("save the full state of the run to this file every checkpoint_interval iterations and on SIGTERM, so that --resume continues it exactly")
+    .metavar("FILE");
+    single_shot_parser->add_argument("--resume")
+    .help("continue the run saved in this snapshot instead of starting a new one, with its seed. Use the same options as the run that was stopped.")
+    .metavar("FILE");
+    // collection for the saved vectors
+    single_shot_parser->add_argument("--collection")
+    .help("append the checkpoints and the final vector to this collection instead of writing a file for each (see moe collection). Paths given with --output or --checkpoint_file are still written.")
+    .metavar("FILE");
+
 
 
     // prediction flag
@@ -117,6 +183,95 @@ argparse::ArgumentParser* parse_arguments(int argc, char** argv){
     .scan<'i', int>()
     .metavar("INT");
 
+    // objective
+    single_shot_parser->add_argument("--objective")
+    .help("entropy to minimize: vonneumann, renyi or min")
+    .default_value(std::string("vonneumann"))
+    .choices("vonneumann", "renyi", "min")
+    .metavar("NAME");
+    single_shot_parser->add_argument("--renyi_p")
+    .help("integer order p >= 2 of the Renyi entropy, with --objective renyi")
+    .default_value(DEFAULT_MINIMIZER_RENYI_P)
+    .scan<'i', int>()
+    .metavar("INT");
+    // stopping criterion
+    single_shot_parser->add_argument("--convergence")
+    .help("when a run has converged: window (the entropy stopped improving over the last steps) or residual (the fixed point residual of the step says nothing is left to gain)")
+    .default_value(std::string("window"))
+    .choices("window", "residual")
+    .metavar("NAME");
+    // restrict to product inputs
+    single_shot_parser->add_argument("--factors", "-f")
+    .help("only minimize over product inputs, for the given factorization of the input dimension (e.g. --factors 2 4 for N = 8)")
+    .nargs(argparse::nargs_pattern::at_least_one)
+    .scan<'i', int>()
+    .metavar("INT");
+    // estimate the entropy with stochastic Lanczos quadrature
+    single_shot_parser->add_argument("--slq")
+    .help("estimate the von Neumann entropy with stochastic Lanczos quadrature, and only compute it exactly at checkpoints and at the end")
+    .default_value(false)
+    .implicit_value(true);
+    single_shot_parser->add_argument("--slq_probes")
+    .help("maximal number of random probes per estimate")
+    .default_value(DEFAULT_SLQ_MAX_PROBES)
+    .scan<'i', int>()
+    .metavar("INT");
+    single_shot_parser->add_argument("--slq_steps")
+    .help("number of Lanczos steps per probe. The quadrature is exact with d+1 steps.")
+    .default_value(DEFAULT_SLQ_LANCZOS_STEPS)
+    .scan<'i', int>()
+    .metavar("INT");
+    single_shot_parser->add_argument("--slq_tolerance")
+    .help("stop adding probes once the standard error of the estimate is below this")
+    .default_value(DEFAULT_SLQ_TOLERANCE)
+    .scan<'g', double>()
+    .metavar("FLOAT");
+    // warm up on a random subset of Kraus operators
+    single_shot_parser->add_argument("--subsample")
+    .help("start each run with steps on a random, norm-weighted subset of the Kraus operators, and grow it until the full channel is used")
+    .default_value(false)
+    .implicit_value(true);
+    single_shot_parser->add_argument("--subsample_batch")
+    .help("number of Kraus operators sampled per step at the start of a run")
+    .default_value(DEFAULT_SUBSAMPLING_BATCH)
+    .scan<'i', int>()
+    .metavar("INT");
+    single_shot_parser->add_argument("--subsample_growth")
+    .help("factor by which the batch grows after every step")
+    .default_value(DEFAULT_SUBSAMPLING_GROWTH)
+    .scan<'g', double>()
+    .metavar("FLOAT");
+    // beam search over the top eigenvectors of each step
+    single_shot_parser->add_argument("--beam")
+    .help("number of vectors kept per step. Each is branched on the top eigenvectors of its step, and the best distinct branches are kept")
+    .default_value(DEFAULT_BEAM_WIDTH)
+    .scan<'i', int>()
+    .metavar("INT");
+    single_shot_parser->add_argument("--beam_branches")
+    .help("number of top eigenvectors tried from every vector of the beam")
+    .default_value(DEFAULT_BEAM_BRANCHES)
+    .scan<'i', int>()
+    .metavar("INT");
+    // overrelaxed steps
+    single_shot_parser->add_argument("--overrelax")
+    .help("extrapolate every step along its direction, with a factor that grows while the entropy keeps decreasing")
+    .default_value(false)
+    .implicit_value(true);
+    // race variants of the step on the same start
+    single_shot_parser->add_argument("--portfolio")
+    .help("race the plain, overrelaxed, beam and subsampled variants on the start of every run in parallel, cancel the laggards and keep the winner")
+    .default_value(false)
+    .implicit_value(true);
+    single_shot_parser->add_argument("--portfolio_stats")
+    .help("JSON file where the winners are counted per class of channels, so that a variant that keeps winning runs alone")
+    .metavar("FILE");
+
+    // seed of the random number generator
+    single_shot_parser->add_argument("--seed")
+    .help("seed of the random number generator, to reproduce a run. Drawn at random (and printed) if not given.")
+    .scan<'u', unsigned long long>()
+    .metavar("INT");
+
     single_shot_parser->add_group("Printing arguments");
     // logging?
     single_shot_parser->add_argument("--logging", "-l")
@@ -147,12 +302,42 @@ argparse::ArgumentParser* parse_arguments(int argc, char** argv){
     .required()
     .metavar("FILE");
     multi_shot_parser->add_group("Other arguments");
+    // skip the checksum of the Kraus operators
+    multi_shot_parser->add_argument("--no_verify")
+    .help("do not check the checksum of the Kraus operators when loading them, so that only the pages of the file that are used get read")
+    .default_value(false)
+    .implicit_value(true);
+    // sidecar cache of what is derived from the Kraus operators
+    multi_shot_parser->add_argument("--channel_cache")
+    .help("keep what is derived from the Kraus operators in a sidecar next to them (FILE.cache), keyed by their checksum, and reuse it in later runs: the checksum verification, the detected symmetry generators (--symmetry), the block decomposition (--decompose) and the ranked channel-informed starts (--starts channel)")
+    .default_value(false)
+    .implicit_value(true);
     // save flag for final vector
     multi_shot_parser->add_argument("--save", "-S")
     .help("save the final vector")
     .default_value(false)
     .implicit_value(true);
 
+    // full snapshots of the search, to resume it
+    multi_shot_parser->add_argument("--snapshot")
+    .help("save the full state of the search to this file before every attempt, every checkpoint_interval iterations and on SIGTERM, so that --resume continues it exactly")
+    .metavar("FILE");
+    multi_shot_parser->add_argument("--checkpoint_interval", "-ci")
+    .help("set the interval for saving snapshots")
+    .scan<'i', int>()
+    .metavar("INT");
+    multi_shot_parser->add_argument("--resume")
+    .help("continue the search saved in this snapshot instead of starting a new one, with its seed. Use the same options as the search that was stopped.")
+    .metavar("FILE");
+    // ledger of the attempts
+    multi_shot_parser->add_argument("--ledger")
+    .help("append a line with the seed, stream, final entropy, iterations, duration and vector of every attempt to this file. If it has attempts already, the search continues after them, with its seed.")
+    .metavar("FILE");
+    // collection for the vectors of the attempts
+    multi_shot_parser->add_argument("--collection")
+    .help("append the final vector of every attempt, and the one saved with --save, to this collection (see moe collection)")
+    .metavar("FILE");
+
 
     // how many iterations to run the minimizer for
     multi_shot_parser->add_argument("-i", "--iters")
@@ -164,6 +349,157 @@ argparse::ArgumentParser* parse_arguments(int argc, char** argv){
     .help("number of minimization attempts")
     .scan<'i', int>()
     .metavar("INT");
+    // symmetry of the channel
+    multi_shot_parser->add_argument("--symmetry", "-y")
+    .help("detect a finite symmetry group of the channel among the Weyl-Heisenberg operators. Random starts are drawn from a fundamental domain and equivalent minima are recognized")
+    .default_value(false)
+    .implicit_value(true);
+    multi_shot_parser->add_argument("--symmetry_generators")
+    .help("path to stored unitaries (saved as Kraus operators) generating a symmetry group of the channel")
+    .metavar("FILE");
+    // look for invariant subspaces and minimize block by block
+    multi_shot_parser->add_argument("--decompose", "-D")
+    .help("split the channel into common invariant subspaces of the Kraus operators and minimize each block separately")
+    .default_value(false)
+    .implicit_value(true);
+    // how to draw starting vectors
+    multi_shot_parser->add_argument("--starts")
+    .help("sequence of starting vectors: random (independent), halton (low-discrepancy, more evenly spread) or channel (built from the channel, best first, then random)")
+    .default_value(std::string("random"))
+    .choices("random", "halton", "channel")
+    .metavar("NAME");
+    multi_shot_parser->add_argument("--channel_starts")
+    .help("with --starts channel, how many of the best ranked channel-informed vectors to start from before random ones")
+    .default_value(DEFAULT_MINIMIZER_CHANNEL_STARTS)
+    .scan<'i', int>()
+    .metavar("INT");
+    multi_shot_parser->add_argument("--compare_starts")
+    .help("report starting and final entropies of channel-informed and random starts separately")
+    .default_value(false)
+    .implicit_value(true);
+    // stop attempts that enter the basin of a known minimum
+    multi_shot_parser->add_argument("--dedup")
+    .help("periodically compare running attempts to the minima already found, and stop those that have entered a known basin")
+    .default_value(false)
+    .implicit_value(true);
+    multi_shot_parser->add_argument("--dedup_interval")
+    .help("number of iterations between two comparisons with the known minima")
+    .default_value(DEFAULT_DEDUP_INTERVAL)
+    .scan<'i', int>()
+    .metavar("INT");
+    // basin hopping
+    multi_shot_parser->add_argument("--hop")
+    .help("basin hopping: start attempts from random perturbations of the last accepted minimum, and accept new minima with the Metropolis rule")
+    .default_value(false)
+    .implicit_value(true);
+    multi_shot_parser->add_argument("--hop_step")
+    .help("initial norm of the perturbations, adapted to the acceptance rate")
+    .default_value(DEFAULT_HOPPING_STEP)
+    .scan<'g', double>()
+    .metavar("FLOAT");
+    multi_shot_parser->add_argument("--hop_temperature")
+    .help("Metropolis temperature, in units of entropy")
+    .default_value(DEFAULT_HOPPING_TEMPERATURE)
+    .scan<'g', double>()
+    .metavar("FLOAT");
+    multi_shot_parser->add_argument("--hop_restarts")
+    .help("probability that an attempt starts from a fresh random vector instead of a perturbation")
+    .default_value(DEFAULT_HOPPING_RESTART_RATIO)
+    .scan<'g', double>()
+    .metavar("FLOAT");
+    multi_shot_parser->add_argument("--hop_iters")
+    .help("iteration budget of an attempt that starts from a perturbation. One that does not converge within it is rejected.")
+    .default_value(DEFAULT_HOPPING_ITERATIONS)
+    .scan<'i', int>()
+    .metavar("INT");
+    // objective
+    multi_shot_parser->add_argument("--objective")
+    .help("entropy to minimize: vonneumann, renyi or min")
+    .default_value(std::string("vonneumann"))
+    .choices("vonneumann", "renyi", "min")
+    .metavar("NAME");
+    multi_shot_parser->add_argument("--renyi_p")
+    .help("integer order p >= 2 of the Renyi entropy, with --objective renyi")
+    .default_value(DEFAULT_MINIMIZER_RENYI_P)
+    .scan<'i', int>()
+    .metavar("INT");
+    // stopping criterion
+    multi_shot_parser->add_argument("--convergence")
+    .help("when a run has converged: window (the entropy stopped improving over the last steps) or residual (the fixed point residual of the step says nothing is left to gain)")
+    .default_value(std::string("window"))
+    .choices("window", "residual")
+    .metavar("NAME");
+    // restrict to product inputs
+    multi_shot_parser->add_argument("--factors", "-f")
+    .help("only minimize over product inputs, for the given factorization of the input dimension (e.g. --factors 2 4 for N = 8)")
+    .nargs(argparse::nargs_pattern::at_least_one)
+    .scan<'i', int>()
+    .metavar("INT");
+    // estimate the entropy with stochastic Lanczos quadrature
+    multi_shot_parser->add_argument("--slq")
+    .help("estimate the von Neumann entropy with stochastic Lanczos quadrature, and only compute it exactly at checkpoints and at the end")
+    .default_value(false)
+    .implicit_value(true);
+    multi_shot_parser->add_argument("--slq_probes")
+    .help("maximal number of random probes per estimate")
+    .default_value(DEFAULT_SLQ_MAX_PROBES)
+    .scan<'i', int>()
+    .metavar("INT");
+    multi_shot_parser->add_argument("--slq_steps")
+    .help("number of Lanczos steps per probe. The quadrature is exact with d+1 steps.")
+    .default_value(DEFAULT_SLQ_LANCZOS_STEPS)
+    .scan<'i', int>()
+    .metavar("INT");
+    multi_shot_parser->add_argument("--slq_tolerance")
+    .help("stop adding probes once the standard error of the estimate is below this")
+    .default_value(DEFAULT_SLQ_TOLERANCE)
+    .scan<'g', double>()
+    .metavar("FLOAT");
+    // warm up on a random subset of Kraus operators
+    multi_shot_parser->add_argument("--subsample")
+    .help("start each run with steps on a random, norm-weighted subset of the Kraus operators, and grow it until the full channel is used")
+    .default_value(false)
+    .implicit_value(true);
+    multi_shot_parser->add_argument("--subsample_batch")
+    .help("number of Kraus operators sampled per step at the start of a run")
+    .default_value(DEFAULT_SUBSAMPLING_BATCH)
+    .scan<'i', int>()
+    .metavar("INT");
+    multi_shot_parser->add_argument("--subsample_growth")
+    .help("factor by which the batch grows after every step")
+    .default_value(DEFAULT_SUBSAMPLING_GROWTH)
+    .scan<'g', double>()
+    .metavar("FLOAT");
+    // beam search over the top eigenvectors of each step
+    multi_shot_parser->add_argument("--beam")
+    .help("number of vectors kept per step. Each is branched on the top eigenvectors of its step, and the best distinct branches are kept")
+    .default_value(DEFAULT_BEAM_WIDTH)
+    .scan<'i', int>()
+    .metavar("INT");
+    multi_shot_parser->add_argument("--beam_branches")
+    .help("number of top eigenvectors tried from every vector of the beam")
+    .default_value(DEFAULT_BEAM_BRANCHES)
+    .scan<'i', int>()
+    .metavar("INT");
+    // overrelaxed steps
+    multi_shot_parser->add_argument("--overrelax")
+    .help("extrapolate every step along its direction, with a factor that grows while the entropy keeps decreasing")
+    .default_value(false)
+    .implicit_value(true);
+    // race variants of the step on the same start
+    multi_shot_parser->add_argument("--portfolio")
+    .help("race the plain, overrelaxed, beam and subsampled variants on the start of every run in parallel, cancel the laggards and keep the winner")
+    .default_value(false)
+    .implicit_value(true);
+    multi_shot_parser->add_argument("--portfolio_stats")
+    .help("JSON file where the winners are counted per class of channels, so that a variant that keeps winning runs alone")
+    .metavar("FILE");
+    // seed of the random number generator
+    multi_shot_parser->add_argument("--seed")
+    .help("seed of the random number generator, to reproduce a run. Drawn at random (and printed) if not given.")
+    .scan<'u', unsigned long long>()
+    .metavar("INT");
+
     multi_shot_parser->add_group("Printing arguments");
     // logging?
     multi_shot_parser->add_argument("--logging", "-l")
@@ -198,6 +534,25 @@ argparse::ArgumentParser* parse_arguments(int argc, char** argv){
     .required()
     .metavar("FILE");
 
+    vector_parser->add_group("Other arguments");
+    // how to draw the vector
+    vector_parser->add_argument("--starts")
+    .help("random (uniform) or halton (point number --index of the Halton sequence on the sphere)")
+    .default_value(std::string("random"))
+    .choices("random", "halton")
+    .metavar("NAME");
+    vector_parser->add_argument("--index")
+    .help("which point of the Halton sequence to save, starting at 1")
+    .default_value(1)
+    .scan<'i', int>()
+    .metavar("INT");
+
+    // seed of the random number generator
+    vector_parser->add_argument("--seed")
+    .help("seed of the random number generator, to reproduce a run. Drawn at random (and printed) if not given.")
+    .scan<'u', unsigned long long>()
+    .metavar("INT");
+
     vector_parser->add_group("Printing arguments");
     // logging?
     vector_parser->add_argument("--logging", "-l")
@@ -209,13 +564,160 @@ argparse::ArgumentParser* parse_arguments(int argc, char** argv){
     .help("disable printing")
     .default_value(false)
     .implicit_value(true);
-    
-    
 
+    /*
+            SUBPARSER 5: Entropy minimization for tensor powers of the channel
+    */
+
+    // add a new subparser called tensorpower
+    argparse::ArgumentParser* tensor_power_parser = new argparse::ArgumentParser("tensorpower", "0.1", argparse::default_arguments::help);
+    tensor_power_parser->add_description("TENSOR POWER ENTROPY MINIMIZATION.\n\nMinimize the Renyi-2 output entropy of n copies of the channel over matrix product state inputs.");
+    parser->add_subparser(*tensor_power_parser);
 
+    tensor_power_parser->add_group("Required arguments");
+    // kraus operators of a single copy
+    tensor_power_parser->add_argument("-k", "--kraus")
+    .help("path to stored Kraus operators of a single copy of the channel")
+    .required()
+    .metavar("FILE");
 
+    tensor_power_parser->add_group("Other arguments");
+    // skip the checksum of the Kraus operators
+    tensor_power_parser->add_argument("--no_verify")
+    .help("do not check the checksum of the Kraus operators when loading them, so that only the pages of the file that are used get read")
+    .default_value(false)
+    .implicit_value(true);
+    // number of copies
+    tensor_power_parser->add_argument("-n", "--copies")
+    .help("number of copies of the channel")
+    .default_value(DEFAULT_TENSOR_POWER_COPIES)
+    .scan<'i', int>()
+    .metavar("INT");
+    // bond dimension
+    tensor_power_parser->add_argument("-D", "--bond")
+    .help("maximum bond dimension of the input MPS")
+    .default_value(DEFAULT_TENSOR_POWER_BOND_DIMENSION)
+    .scan<'i', int>()
+    .metavar("INT");
+    // how many sweeps to run the minimizer for
+    tensor_power_parser->add_argument("-i", "--iters")
+    .help("max number of sweeps")
+    .scan<'i', int>()
+    .metavar("INT");
+    // how many times to run the minimizer
+    tensor_power_parser->add_argument("-a", "--atts")
+    .help("number of minimization attempts")
+    .scan<'i', int>()
+    .metavar("INT");
 
+    // seed of the random number generator
+    tensor_power_parser->add_argument("--seed")
+    .help("seed of the random number generator, to reproduce a run. Drawn at random (and printed) if not given.")
+    .scan<'u', unsigned long long>()
+    .metavar("INT");
 
+    tensor_power_parser->add_group("Printing arguments");
+    // logging?
+    tensor_power_parser->add_argument("--logging", "-l")
+    .help("enable logging")
+    .default_value(false)
+    .implicit_value(true);
+    // printing?
+    tensor_power_parser->add_argument("--silent", "-s")
+    .help("disable printing")
+    .default_value(false)
+    .implicit_value(true);
+
+    /*
+            SUBPARSER 6: Convert files to the current format
+    */
+
+    // add a new subparser called convert
+    argparse::ArgumentParser* convert_parser = new argparse::ArgumentParser("convert", "0.1", argparse::default_arguments::help);
+    convert_parser->add_description("Rewrite a stored vector or set of Kraus operators in the current file format (version " SERIALIZER_FORMAT_VERSION "), whose data is aligned and read in place.");
+    parser->add_subparser(*convert_parser);
+    // file to convert
+    convert_parser->add_argument("input")
+    .help("path to the stored vector or Kraus operators");
+    // where to write it
+    convert_parser->add_argument("--output", "-o")
+    .help("path to save the converted file. The input file is replaced if not given.")
+    .metavar("FILE");
+    // logging?
+    convert_parser->add_argument("--logging", "-l")
+    .help("enable logging")
+    .default_value(false)
+    .implicit_value(true);
+    // printing?
+    convert_parser->add_argument("--silent", "-s")
+    .help("disable printing")
+    .default_value(false)
+    .implicit_value(true);
+
+    /*
+            SUBPARSER 7: Query collections of vectors
+    */
+
+    // add a new subparser called collection
+    argparse::ArgumentParser* collection_parser = new argparse::ArgumentParser("collection", "0.1", argparse::default_arguments::help);
+    collection_parser->add_description("List the vectors stored in a collection, find those with the lowest entropy, and extract them to files of their own");
+    parser->add_subparser(*collection_parser);
+
+    // list the vectors
+    argparse::ArgumentParser* list_parser = new argparse::ArgumentParser("list", "0.1", argparse::default_arguments::help);
+    list_parser->add_description("List the vectors of a collection, with their entropy, iteration, seed, stream and run, from its index");
+    collection_parser->add_subparser(*list_parser);
+    list_parser->add_argument("collection")
+    .help("path to the collection");
+    list_parser->add_argument("--logging", "-l")
+    .help("enable logging")
+    .default_value(false)
+    .implicit_value(true);
+    list_parser->add_argument("--silent", "-s")
+    .help("disable printing")
+    .default_value(false)
+    .implicit_value(true);
+
+    // the k lowest entropies
+    argparse::ArgumentParser* top_parser = new argparse::ArgumentParser("top", "0.1", argparse::default_arguments::help);
+    top_parser->add_description("List the vectors of a collection with the lowest entropy, lowest first, from its index");
+    collection_parser->add_subparser(*top_parser);
+    top_parser->add_argument("collection")
+    .help("path to the collection");
+    top_parser->add_argument("-k")
+    .help("number of vectors to list")
+    .default_value(10)
+    .scan<'i', int>();
+    top_parser->add_argument("--logging", "-l")
+    .help("enable logging")
+    .default_value(false)
+    .implicit_value(true);
+    top_parser->add_argument("--silent", "-s")
+    .help("disable printing")
+    .default_value(false)
+    .implicit_value(true);
+
+    // extract one vector
+    argparse::ArgumentParser* extract_parser = new argparse::ArgumentParser("extract", "0.1", argparse::default_arguments::help);
+    extract_parser->add_description("Write a vector of a collection to a file of its own, in the usual format, after checking its checksum");
+    collection_parser->add_subparser(*extract_parser);
+    extract_parser->add_argument("collection")
+    .help("path to the collection");
+    extract_parser->add_argument("index")
+    .help("index of the vector, as listed")
+    .scan<'i', int>();
+    extract_parser->add_argument("--output", "-o")
+    .help("path to save the vector to")
+    .required()
+    .metavar("FILE");
+    extract_parser->add_argument("--logging", "-l")
+    .help("enable logging")
+    .default_value(false)
+    .implicit_value(true);
+    extract_parser->add_argument("--silent", "-s")
+    .help("disable printing")
+    .default_value(false)
+    .implicit_value(true);
 
     try {
     parser->parse_args(argc, argv);
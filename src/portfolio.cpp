@@ -0,0 +1,370 @@
+#include "common_includes.h"
+#include "portfolio.h"
+#include "config.h"
+#include "entropy_minimizer.h"
+#include <fcntl.h>      // open
+#include <unistd.h>     // close, getpid
+#include <sys/file.h>   // flock
+
+Portfolio::Portfolio(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, EntropyConfig* conf){
+    config = conf;
+    d = kraus_number;
+    N = kraus_in_dimension;
+    M = kraus_out_dimension;
+    races = 0;
+
+    // Step 1: the base configuration is the plain step, quiet, with nothing that only makes sense for the whole search
+    EntropyConfig base = *config;
+    base.setPrinting(false);
+    base.setLogging(false);
+    base.setCheckpointing(false);
+    base.setPortfolio(false);
+    base.setOverrelaxation(false);
+    base.setBeamWidth(1);
+    base.setSubsampling(false);
+    base.setDedup(false);
+    base.setHopping(false);
+    base.setCompareStarts(false);
+    base.setStartSequence(START_SEQUENCE_RANDOM);
+
+    // Step 2: the variants
+    std::vector<std::pair<std::string, EntropyConfig> > configs;
+    configs.push_back({"fixedpoint", base});
+    configs.push_back({"overrelaxed", base});
+    configs.back().second.setOverrelaxation(true);
+    if (config->objective != OBJECTIVE_RENYI){
+        configs.push_back({"beam", base});
+        configs.back().second.setBeamWidth(PORTFOLIO_BEAM_WIDTH);
+    }
+    if (config->objective != OBJECTIVE_RENYI && d > config->subsampling_batch){
+        configs.push_back({"subsampled", base});
+        configs.back().second.setSubsampling(true);
+    }
+    for (const std::pair<std::string, EntropyConfig>& named : configs){
+        PortfolioVariant* variant = new PortfolioVariant();
+        variant->name = named.first;
+        variant->config = named.second;
+        variant->minimizer = new EntropyMinimizer(kraus_ops, d, N, M, &variant->config);
+        variant->status = PORTFOLIO_CANCELLED;
+        variant->finish_time = -1;
+        variants.push_back(variant);
+    }
+    racing.assign(variants.size(), false);
+
+    // Step 3: channels of the same dimensions and objective share statistics
+    std::ostringstream key;
+    key << "N=" << N << " M=" << M << " d=" << d << " ";
+    if (config->objective == OBJECTIVE_RENYI){
+        key << "renyi" << config->renyi_p;
+    } else if (config->objective == OBJECTIVE_MIN_ENTROPY){
+        key << "min";
+    } else {
+        key << "vonneumann";
+    }
+    channel_class = key.str();
+    statistics = json::object();
+    unsaved = json::object();
+}
+
+int Portfolio::readStatistics(json* read){
+    std::ifstream in_file(config->portfolio_stats_file);
+    if (!in_file){
+        return 1;
+    }
+    try {
+        *read = json::parse(in_file);
+    } catch (const json::exception&){
+        return 2;
+    }
+    return read->is_object() ? 0 : 2;
+}
+
+void Portfolio::addStatistics(json* into, const json& increments){
+    for (auto& [channel, counts] : increments.items()){
+        for (auto& [name, increment] : counts.items()){
+            json& entry = (*into)[channel][name];
+            if (!entry.is_object()){
+                entry = json::object();
+            }
+            entry["races"] = entry.value("races", 0) + increment.value("races", 0);
+            entry["wins"] = entry.value("wins", 0) + increment.value("wins", 0);
+            entry["win_time"] = entry.value("win_time", 0.0) + increment.value("win_time", 0.0);
+        }
+    }
+}
+
+int Portfolio::loadStatistics(){
+    json read;
+    int info = readStatistics(&read);
+    if (info == 0){
+        statistics = read;
+        addStatistics(&statistics, unsaved);
+    }
+    return info;
+}
+
+int Portfolio::saveStatistics(){
+    // Step 1: one job at a time, from reading the file to replacing it
+    std::filesystem::path path(config->portfolio_stats_file);
+    if (path.has_parent_path()){
+        std::filesystem::create_directories(path.parent_path());
+    }
+    std::string lock_filename = config->portfolio_stats_file + ".lock";
+    int lock_fd = open(lock_filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX) != 0){
+        if (lock_fd >= 0){
+            close(lock_fd);
+        }
+        return 1;
+    }
+
+    // Step 2: what other jobs saved in the meantime, plus our races. A file that does not parse is kept aside rather than lost.
+    json merged = json::object();
+    int info = readStatistics(&merged);
+    if (info == 1){
+        merged = json::object();
+        info = 0;
+    } else if (info == 2){
+        std::error_code ignored;
+        std::filesystem::rename(path, config->portfolio_stats_file + ".corrupt", ignored);
+        merged = json::object();
+    }
+    addStatistics(&merged, unsaved);
+
+    // Step 3: replace the file, so that readers see either the old or the new one
+    std::string temporary = config->portfolio_stats_file + "." + std::to_string(getpid()) + ".tmp";
+    std::ofstream out_file(temporary);
+    out_file << merged.dump(4) << std::endl;
+    out_file.close();
+    std::error_code error;
+    if (!out_file){
+        error = std::make_error_code(std::errc::io_error);
+    } else {
+        std::filesystem::rename(temporary, path, error);
+    }
+    if (error){
+        std::filesystem::remove(temporary, error);
+        flock(lock_fd, LOCK_UN);
+        close(lock_fd);
+        return 1;
+    }
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
+    statistics = merged;
+    unsaved = json::object();
+    return info;
+}
+
+int Portfolio::trustedVariant(){
+    // Every few runs, everybody races again
+    if (races % PORTFOLIO_RERACE_INTERVAL == 0 || !statistics.contains(channel_class)){
+        return -1;
+    }
+    for (int v=0; v<variants.size(); v++){
+        json entry = statistics[channel_class].value(variants.at(v)->name, json::object());
+        int raced = entry.value("races", 0);
+        int won = entry.value("wins", 0);
+        if (won >= PORTFOLIO_TRUST_RACES && won >= PORTFOLIO_TRUST_SHARE*raced){
+            return v;
+        }
+    }
+    return -1;
+}
+
+int Portfolio::work(int v, std::chrono::steady_clock::time_point start_time){
+    PortfolioVariant* variant = variants.at(v);
+    while (variant->status == PORTFOLIO_RUNNING){
+        int stop = variant->minimizer->stepMinimization();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        variant->trace.push_back({elapsed, *variant->minimizer->minimizer->getEntropy()});
+        if (stop != 0 || variant->trace.size() >= config->max_iterations){
+            // The referee may have cancelled the variant in the meantime: that decision stands
+            int running = PORTFOLIO_RUNNING;
+            if (variant->status.compare_exchange_strong(running, PORTFOLIO_CONVERGED)){
+                variant->finish_time = elapsed;
+            }
+        }
+    }
+    return 0;
+}
+
+int Portfolio::referee(double elapsed){
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    // Step 1: best converged entropy so far, and the leader among everybody
+    double best_final = -1;
+    int leader = -1;
+    for (int v=0; v<variants.size(); v++){
+        PortfolioVariant* variant = variants.at(v);
+        if (!racing.at(v) || variant->trace.empty() || variant->status == PORTFOLIO_CANCELLED){
+            continue;
+        }
+        double current = variant->trace.back().second;
+        if (variant->status == PORTFOLIO_CONVERGED && (best_final < 0 || current < best_final)){
+            best_final = current;
+        }
+        if (leader < 0 || current < variants.at(leader)->trace.back().second){
+            leader = v;
+        }
+    }
+
+    // Step 2: cancel the variants that cannot win
+    int running = 0;
+    for (int v=0; v<variants.size(); v++){
+        PortfolioVariant* variant = variants.at(v);
+        if (!racing.at(v) || variant->status != PORTFOLIO_RUNNING){
+            continue;
+        }
+        bool cancel = false;
+        if (best_final >= 0){
+            // Somebody has converged: only those already below it can still do better
+            cancel = variant->trace.empty() || variant->trace.back().second > best_final;
+        } else if (elapsed >= PORTFOLIO_MIN_RACE_TIME && v != leader && leader >= 0 && !variant->trace.empty()){
+            // Progress per second over the second half of the trace, against the gap to the leader. A single step says nothing about the rate.
+            double now = variant->trace.back().first;
+            double current = variant->trace.back().second;
+            double gap = current - variants.at(leader)->trace.back().second;
+            std::vector<std::pair<double, double> >::iterator past = std::lower_bound(variant->trace.begin(), variant->trace.end(), std::make_pair(now/2, -1.0));
+            if (past->first < now){
+                double rate = (past->second - current)/(now - past->first);
+                cancel = gap > 0 && (rate <= 0 || gap/rate > PORTFOLIO_CANCEL_RATIO*elapsed);
+            }
+        }
+        if (cancel){
+            int expected = PORTFOLIO_RUNNING;
+            variant->status.compare_exchange_strong(expected, PORTFOLIO_CANCELLED);
+        }
+        running += variant->status == PORTFOLIO_RUNNING;
+    }
+    return running;
+}
+
+int Portfolio::race(const std::vector<std::complex<double> >& start, uint64_t stream, EntropyMinimizer* owner){
+    races += 1;
+    int trusted = trustedVariant();
+
+    // Step 1: every racing variant starts from the same vector, and draws from the same random stream
+    for (int v=0; v<variants.size(); v++){
+        PortfolioVariant* variant = variants.at(v);
+        racing.at(v) = trusted < 0 || v == trusted;
+        variant->trace.clear();
+        variant->finish_time = -1;
+        variant->status = PORTFOLIO_CANCELLED;
+        if (racing.at(v)){
+            std::vector<std::complex<double> > vector(start);
+            variant->minimizer->initializeRun(&vector);
+            variant->minimizer->minimizer->setRandomStream(stream);
+            variant->status = PORTFOLIO_RUNNING;
+        }
+    }
+
+    // Step 2: one thread per variant, refereed from this one
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int v=0; v<variants.size(); v++){
+        if (racing.at(v)){
+            threads.push_back(std::thread(&Portfolio::work, this, v, start_time));
+        }
+    }
+    int running = threads.size();
+    while (running > 0){
+        std::this_thread::sleep_for(std::chrono::milliseconds(PORTFOLIO_POLL_INTERVAL));
+        if (owner->shouldTerminate()){
+            for (PortfolioVariant* variant : variants){
+                int expected = PORTFOLIO_RUNNING;
+                variant->status.compare_exchange_strong(expected, PORTFOLIO_CANCELLED);
+            }
+        }
+        running = referee(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count());
+    }
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+
+    // Step 3: the winner is the converged variant with the lowest entropy, the first to get there among ties.
+    // If none converged (termination was requested), take the lowest entropy reached.
+    int winner = -1;
+    for (int v=0; v<variants.size(); v++){
+        PortfolioVariant* variant = variants.at(v);
+        if (!racing.at(v) || variant->status != PORTFOLIO_CONVERGED){
+            continue;
+        }
+        if (winner < 0){
+            winner = v;
+            continue;
+        }
+        double difference = variant->trace.back().second - variants.at(winner)->trace.back().second;
+        if (difference < -START_COMPARISON_TOLERANCE || (difference <= START_COMPARISON_TOLERANCE && variant->finish_time < variants.at(winner)->finish_time)){
+            winner = v;
+        }
+    }
+    if (winner < 0){
+        for (int v=0; v<variants.size(); v++){
+            if (racing.at(v) && !variants.at(v)->trace.empty() && (winner < 0 || variants.at(v)->trace.back().second < variants.at(winner)->trace.back().second)){
+                winner = v;
+            }
+        }
+        return winner >= 0 ? winner : std::max(trusted, 0);
+    }
+
+    // Step 4: only full races count in the statistics, otherwise the trusted variant would keep winning by default
+    if (trusted < 0){
+        json increments = json::object();
+        for (int v=0; v<variants.size(); v++){
+            increments[channel_class][variants.at(v)->name] = {
+                {"races", 1},
+                {"wins", int(v == winner)},
+                {"win_time", v == winner ? variants.at(v)->finish_time : 0.0}
+            };
+        }
+        addStatistics(&statistics, increments);
+        addStatistics(&unsaved, increments);
+    }
+    return winner;
+}
+
+int Portfolio::getVariantCount(){
+    return variants.size();
+}
+
+std::string Portfolio::getName(int variant){
+    return variants.at(variant)->name;
+}
+
+std::vector<std::complex<double> > Portfolio::getVector(int variant){
+    return *variants.at(variant)->minimizer->minimizer->getVectorState();
+}
+
+double Portfolio::getEntropy(int variant){
+    return variants.at(variant)->trace.empty() ? -1 : variants.at(variant)->trace.back().second;
+}
+
+int Portfolio::getIterations(int variant){
+    return variants.at(variant)->trace.size();
+}
+
+std::string Portfolio::describe(){
+    std::ostringstream out;
+    for (int v=0; v<variants.size(); v++){
+        PortfolioVariant* variant = variants.at(v);
+        out << (v > 0 ? "\n" : "") << variant->name << ": ";
+        if (!racing.at(v)){
+            out << "did not race";
+        } else if (variant->trace.empty()){
+            out << "cancelled before its first step";
+        } else {
+            out << (variant->status == PORTFOLIO_CONVERGED ? "converged" : "cancelled") << " after " << variant->trace.size() << " steps and "
+                << std::fixed << std::setprecision(4) << variant->trace.back().first << " s, entropy "
+                << std::setprecision(PRINT_PRECISION) << variant->trace.back().second;
+        }
+    }
+    return out.str();
+}
+
+Portfolio::~Portfolio(){
+    for (PortfolioVariant* variant : variants){
+        delete variant->minimizer;
+        delete variant;
+    }
+}
@@ -0,0 +1,189 @@
+#include "common_includes.h"
+#include "product_minimizer.h"
+#include "config.h"
+#include "matrix_operations.h"
+#include "rng.h"
+
+ProductMinimizer::ProductMinimizer(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension, double eps, std::vector<int> factor_dims)
+    : Minimizer(kraus_ops, kraus_number, kraus_in_dimension, kraus_out_dimension, eps) {
+    // The product of the factor dimensions must be N. This is checked when parsing the arguments.
+    factor_dimensions = factor_dims;
+    factor_strides = std::vector<int>(factor_dimensions.size());
+    int stride = 1;
+    for (int j=factor_dimensions.size()-1; j>=0; j--){
+        factor_strides.at(j) = stride;
+        stride *= factor_dimensions.at(j);
+    }
+    // Start from the product of the first basis vectors, to avoid seg faults
+    for (int j=0; j<factor_dimensions.size(); j++){
+        std::vector<std::complex<double> > factor(factor_dimensions.at(j), std::complex<double>(0.0f,0.0f));
+        factor.at(0) = std::complex<double>(1.0f,0.0f);
+        factors.push_back(factor);
+    }
+    updateProductVector();
+}
+
+int ProductMinimizer::updateProductVector(){
+    for (int c=0; c<N; c++){
+        std::complex<double> entry(1.0f,0.0f);
+        for (int j=0; j<factors.size(); j++){
+            entry *= factors.at(j).at((c/factor_strides.at(j)) % factor_dimensions.at(j));
+        }
+        vector_state->at(c) = entry;
+    }
+    return 0;
+}
+
+int ProductMinimizer::initializeRandomVector(){
+    // Step 1: Set up random number generator
+    RandomStream stream(RNG_DOMAIN_START_VECTOR, random_stream, random_draws++);
+
+    // Step 2: Draw every factor uniformly on its sphere. The product of normalized factors is normalized.
+    for (int j=0; j<factors.size(); j++){
+        double norm = 0.0f;
+        stream.fillComplexNormal(factors.at(j).data(), factor_dimensions.at(j));
+        for (int i=0; i<factor_dimensions.at(j); i++){
+            norm += std::norm(factors.at(j).at(i));
+        }
+        norm = std::sqrt(norm);
+        for (int i=0; i<factor_dimensions.at(j); i++){
+            factors.at(j).at(i) /= norm;
+        }
+    }
+    updateProductVector();
+    return 0;
+}
+
+int ProductMinimizer::initializeVector(std::vector<std::complex<double> >* pointer){
+    // Step 1: Check that the pointer points to a valid, non-empty vector of the right size. Same fallbacks as Minimizer.
+    if (pointer == nullptr || pointer->empty()){
+        std::cout << "Wait a second, no starting vector was provided! I will generate a random one..." << std::endl;
+        initializeRandomVector();
+        return 2;
+    }
+    if (pointer->size() != N){
+        std::cout << "The vector does not match the specified dimension! Fallback: generating random vector..." << std::endl;
+        std::cout << "Expected dimension: " << N << ", got dimension: " << pointer->size() << std::endl;
+        initializeRandomVector();
+        return 1;
+    }
+    // Step 2: closest product vector, factor by factor: top eigenvector of the reduced state on that factor
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    for (int j=0; j<factors.size(); j++){
+        int n = factor_dimensions.at(j);
+        int stride = factor_strides.at(j);
+        int rest = N/n;
+        // Reshape the vector as an n x rest matrix A, then the reduced state is A A^H
+        std::vector<std::complex<double> > A(N);
+        for (int c=0; c<N; c++){
+            int a = (c/stride) % n;
+            int r = (c/(stride*n))*stride + c%stride;
+            A.at(r*n+a) = pointer->at(c);
+        }
+        std::vector<std::complex<double> > reduced(n*n);
+        cblas_zgemm(CblasColMajor, CblasNoTrans, CblasConjTrans, n, n, rest, &one,
+            reinterpret_cast<lapack_complex_t*>(A.data()), n,
+            reinterpret_cast<lapack_complex_t*>(A.data()), n,
+            &zero, reinterpret_cast<lapack_complex_t*>(reduced.data()), n);
+        std::vector<double> eigvals(n);
+        zheev_wrapper('V', 'U', n, &reduced, n, &eigvals);
+        for (int i=0; i<n; i++){
+            factors.at(j).at(i) = reduced.at(n*(n-1)+i);
+        }
+    }
+    updateProductVector();
+    return 0;
+}
+
+int ProductMinimizer::effectiveKraus(int factor, std::vector<std::complex<double> >* effective_kraus){
+    // Column a of the effective operator is sum over the columns c of K_k with c_j = a, weighted by the other factors.
+    int n = factor_dimensions.at(factor);
+    int stride = factor_strides.at(factor);
+    // Step 1: weights prod_{i != j} v_i[c_i]
+    std::vector<std::complex<double> > environment(N);
+    for (int c=0; c<N; c++){
+        std::complex<double> entry(1.0f,0.0f);
+        for (int i=0; i<factors.size(); i++){
+            if (i != factor){
+                entry *= factors.at(i).at((c/factor_strides.at(i)) % factor_dimensions.at(i));
+            }
+        }
+        environment.at(c) = entry;
+    }
+    // Step 2: contract, one column of one Kraus operator at a time. O(d M N).
+    std::fill(effective_kraus->begin(), effective_kraus->end(), std::complex<double>(0.0f,0.0f));
+    for (int k=0; k<d; k++){
+        for (int c=0; c<N; c++){
+            int a = (c/stride) % n;
+            cblas_zaxpy(M, reinterpret_cast<lapack_complex_t*>(&environment.at(c)),
+                reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*M+c*M))), 1,
+                reinterpret_cast<lapack_complex_t*>(&(effective_kraus->at(k*n*M+a*M))), 1);
+        }
+    }
+    return 0;
+}
+
+int ProductMinimizer::stepAlgorithm(){
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    for (int j=0; j<factors.size(); j++){
+        int n = factor_dimensions.at(j);
+
+        // Step 1: compute log(Phi_e(rho)) for the current product vector, or what replaces it for the selected objective
+        updateOutputMatrix();
+        objectiveOutputMatrix();
+
+        // Step 2: effective Kraus operators of factor j
+        std::vector<std::complex<double> > effective_kraus(d*M*n);
+        effectiveKraus(j, &effective_kraus);
+
+        // Step 3: apply the effective dual channel: G = sum_k Ke_k^H log(Phi_e(rho)) Ke_k
+        std::vector<std::complex<double> > tmp(M*n);
+        std::vector<std::complex<double> > G(n*n, zero);
+        for (int k=0; k<d; k++){
+            cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, n, M, &one,
+                reinterpret_cast<lapack_complex_t*>(output_matrix->data()), M,
+                reinterpret_cast<lapack_complex_t*>(&(effective_kraus.at(k*M*n))), M,
+                &zero, reinterpret_cast<lapack_complex_t*>(tmp.data()), M);
+            cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, n, n, M, &one,
+                reinterpret_cast<lapack_complex_t*>(&(effective_kraus.at(k*M*n))), M,
+                reinterpret_cast<lapack_complex_t*>(tmp.data()), M,
+                &one, reinterpret_cast<lapack_complex_t*>(G.data()), n);
+        }
+
+        // Step 4: the new factor is the eigenvector with the highest eigenvalue
+        std::vector<double> eigvals(n);
+        zheev_wrapper('V', 'U', n, &G, n, &eigvals);
+        for (int i=0; i<n; i++){
+            factors.at(j).at(i) = G.at(n*(n-1)+i);
+        }
+        updateProductVector();
+    }
+    return 0;
+}
+
+int ProductMinimizer::calculateEntropy(){
+    // Same as Minimizer::calculateEntropy, with the rank one shortcut for Phi_e(rho)
+    if (useEntropyEstimator()){
+        return estimateEntropy();
+    }
+    updateOutputMatrix();
+    return outputEntropy();
+}
+
+std::vector<std::complex<double> > ProductMinimizer::getVector(){
+    // The product vector is always up to date, no need to diagonalize anything
+    return *vector_state;
+}
+
+std::vector<std::complex<double> > ProductMinimizer::getFactor(int factor){
+    return factors.at(factor);
+}
+
+int ProductMinimizer::getFactorCount(){
+    return factors.size();
+}
+
+ProductMinimizer::~ProductMinimizer(){
+}
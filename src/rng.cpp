@@ -0,0 +1,130 @@
+#include "common_includes.h"
+#include "rng.h"
+#include "config.h"
+#include <mutex>
+
+// Philox4x32 constants: round multipliers and Weyl sequence increments of the key
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+static uint64_t random_seed = 0;
+static std::once_flag random_seed_flag;
+
+int setRandomSeed(uint64_t seed){
+    // The seed is fixed by the first call that sets or reads it. Returns 1 if it was already fixed.
+    bool set = false;
+    std::call_once(random_seed_flag, [seed, &set](){
+        random_seed = seed;
+        set = true;
+    });
+    return set ? 0 : 1;
+}
+
+uint64_t getRandomSeed(){
+    std::call_once(random_seed_flag, [](){
+        std::random_device rd;
+        random_seed = (uint64_t(rd()) << 32) ^ rd();
+    });
+    return random_seed;
+}
+
+json rngMetadata(uint64_t domain, uint64_t first_stream, uint64_t stream_count){
+    return {
+        {"generator", RNG_GENERATOR_NAME},
+        {"seed", getRandomSeed()},
+        {"domain", domain},
+        {"first_stream", first_stream},
+        {"stream_count", stream_count}
+    };
+}
+
+RandomStream::RandomStream(uint64_t domain, uint64_t stream, uint64_t substream)
+    : RandomStream(getRandomSeed(), domain, stream, substream) {
+}
+
+RandomStream::RandomStream(uint64_t seed, uint64_t domain, uint64_t stream, uint64_t substream){
+    key[0] = uint32_t(seed);
+    key[1] = uint32_t(seed >> 32);
+    counter[0] = 0;
+    counter[1] = uint32_t(domain);
+    counter[2] = uint32_t(stream);
+    counter[3] = uint32_t(substream);
+    position = 2;
+    has_spare = false;
+    spare = 0.0f;
+}
+
+int RandomStream::generateBlock(){
+    uint32_t x[4] = {counter[0], counter[1], counter[2], counter[3]};
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int r=0; r<PHILOX_ROUNDS; r++){
+        uint64_t p0 = uint64_t(PHILOX_M0)*x[0];
+        uint64_t p1 = uint64_t(PHILOX_M1)*x[2];
+        uint32_t y0 = uint32_t(p1 >> 32) ^ x[1] ^ k0;
+        uint32_t y1 = uint32_t(p1);
+        uint32_t y2 = uint32_t(p0 >> 32) ^ x[3] ^ k1;
+        uint32_t y3 = uint32_t(p0);
+        x[0] = y0; x[1] = y1; x[2] = y2; x[3] = y3;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    for (int i=0; i<4; i++){
+        block[i] = x[i];
+    }
+    counter[0] += 1;
+    position = 0;
+    return 0;
+}
+
+RandomStream::result_type RandomStream::operator()(){
+    if (position >= 2){
+        generateBlock();
+    }
+    uint64_t bits = (uint64_t(block[2*position+1]) << 32) | block[2*position];
+    position += 1;
+    return bits;
+}
+
+double RandomStream::uniform(){
+    // The top 53 bits, centered in their interval
+    return ((operator()() >> 11) + 0.5) * (1.0/9007199254740992.0);
+}
+
+double RandomStream::normal(){
+    if (has_spare){
+        has_spare = false;
+        return spare;
+    }
+    double radius = std::sqrt(-2*std::log(uniform()));
+    double angle = 2*M_PI*uniform();
+    spare = radius*std::sin(angle);
+    has_spare = true;
+    return radius*std::cos(angle);
+}
+
+int RandomStream::fillNormal(double* out, size_t count){
+    // Step 1: one block gives two uniforms, hence two normals. Work on whole blocks, without branching on the stream state.
+    size_t pairs = count/2;
+    for (size_t i=0; i<pairs; i++){
+        generateBlock();
+        double u = ((((uint64_t(block[1]) << 32) | block[0]) >> 11) + 0.5) * (1.0/9007199254740992.0);
+        double v = ((((uint64_t(block[3]) << 32) | block[2]) >> 11) + 0.5) * (1.0/9007199254740992.0);
+        double radius = std::sqrt(-2*std::log(u));
+        out[2*i] = radius*std::cos(2*M_PI*v);
+        out[2*i+1] = radius*std::sin(2*M_PI*v);
+    }
+    position = 2;
+    // Step 2: odd count
+    if (count % 2 == 1){
+        out[count-1] = normal();
+    }
+    return 0;
+}
+
+int RandomStream::fillComplexNormal(std::complex<double>* out, size_t count){
+    // std::complex<double> is laid out as two doubles
+    return fillNormal(reinterpret_cast<double*>(out), 2*count);
+}
@@ -0,0 +1,148 @@
+#include "common_includes.h"
+#include "slq_estimator.h"
+#include "config.h"
+#include "matrix_operations.h"
+#include "rng.h"
+
+SLQEstimator::SLQEstimator(int dimension, int max_probe_number, int steps, double tol){
+    M = dimension;
+    max_probes = std::max(max_probe_number, 1);
+    lanczos_steps = std::min(std::max(steps, 1), M);
+    tolerance = tol;
+    standard_error = -1;
+    probes_used = 0;
+
+    // Step 1: Set up random number generator. Estimators of the same dimension share their probes.
+    RandomStream stream(RNG_DOMAIN_SLQ_PROBES, M);
+
+    // Step 2: Rademacher probes, drawn once
+    for (int p=0; p<max_probes; p++){
+        std::vector<std::complex<double> > probe(M);
+        for (int i=0; i<M; i++){
+            probe.at(i) = std::complex<double>((stream() >> 63) ? 1.0f : -1.0f, 0.0f);
+        }
+        probes.push_back(probe);
+    }
+}
+
+int SLQEstimator::applyOutput(std::vector<std::complex<double> >* images, int rank, double epsilon, const std::complex<double>* x, std::complex<double>* y){
+    // sigma x = (1-e) W (W^H x) + e/M x
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    std::complex<double> scale(1-epsilon, 0.0f);
+    std::vector<std::complex<double> > coefficients(rank);
+    cblas_zgemv(CblasColMajor, CblasConjTrans, M, rank, &one,
+        reinterpret_cast<lapack_complex_t*>(images->data()), M,
+        reinterpret_cast<const lapack_complex_t*>(x), 1,
+        &zero, reinterpret_cast<lapack_complex_t*>(coefficients.data()), 1);
+    for (int i=0; i<M; i++){
+        y[i] = (epsilon/M)*x[i];
+    }
+    cblas_zgemv(CblasColMajor, CblasNoTrans, M, rank, &scale,
+        reinterpret_cast<lapack_complex_t*>(images->data()), M,
+        reinterpret_cast<lapack_complex_t*>(coefficients.data()), 1,
+        &one, reinterpret_cast<lapack_complex_t*>(y), 1);
+    return 0;
+}
+
+double SLQEstimator::quadrature(std::vector<std::complex<double> >* images, int rank, double epsilon, const std::vector<std::complex<double> >& probe){
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    std::complex<double> minus_one(-1.0f,0.0f);
+
+    // Step 1: Lanczos with full reorthogonalization. Q holds the Lanczos vectors as columns.
+    double probe_norm = cblas_dznrm2(M, reinterpret_cast<const lapack_complex_t*>(probe.data()), 1);
+    std::vector<std::complex<double> > Q(size_t(M)*(lanczos_steps+1));
+    for (int i=0; i<M; i++){
+        Q.at(i) = probe.at(i)/probe_norm;
+    }
+    std::vector<double> alpha;
+    std::vector<double> beta;
+    std::vector<std::complex<double> > w(M);
+    std::vector<std::complex<double> > overlaps(lanczos_steps);
+    for (int k=0; k<lanczos_steps; k++){
+        std::complex<double>* q = &(Q.at(size_t(M)*k));
+        applyOutput(images, rank, epsilon, q, w.data());
+        std::complex<double> a;
+        cblas_zdotc_sub(M, reinterpret_cast<lapack_complex_t*>(q), 1, reinterpret_cast<lapack_complex_t*>(w.data()), 1, reinterpret_cast<lapack_complex_t*>(&a));
+        alpha.push_back(a.real());
+        // Orthogonalize against all previous Lanczos vectors (twice is enough), which also removes the alpha and beta components
+        for (int pass=0; pass<2; pass++){
+            cblas_zgemv(CblasColMajor, CblasConjTrans, M, k+1, &one,
+                reinterpret_cast<lapack_complex_t*>(Q.data()), M,
+                reinterpret_cast<lapack_complex_t*>(w.data()), 1,
+                &zero, reinterpret_cast<lapack_complex_t*>(overlaps.data()), 1);
+            cblas_zgemv(CblasColMajor, CblasNoTrans, M, k+1, &minus_one,
+                reinterpret_cast<lapack_complex_t*>(Q.data()), M,
+                reinterpret_cast<lapack_complex_t*>(overlaps.data()), 1,
+                &one, reinterpret_cast<lapack_complex_t*>(w.data()), 1);
+        }
+        double b = cblas_dznrm2(M, reinterpret_cast<lapack_complex_t*>(w.data()), 1);
+        // Breakdown: the Krylov space is invariant, and the quadrature is exact. This happens after at most d+1 steps.
+        if (k == lanczos_steps-1 || b < SLQ_BREAKDOWN_TOLERANCE){
+            break;
+        }
+        beta.push_back(b);
+        for (int i=0; i<M; i++){
+            Q.at(size_t(M)*(k+1)+i) = w.at(i)/b;
+        }
+    }
+
+    // Step 2: Gauss quadrature from the tridiagonal matrix: nodes are its eigenvalues, weights the squared first components of its eigenvectors
+    int m = alpha.size();
+    std::vector<std::complex<double> > T(m*m, zero);
+    for (int k=0; k<m; k++){
+        T.at(k*m+k) = alpha.at(k);
+        if (k+1 < m){
+            T.at(k*m+k+1) = beta.at(k);
+            T.at((k+1)*m+k) = beta.at(k);
+        }
+    }
+    std::vector<double> nodes(m);
+    zheev_wrapper('V', 'U', m, &T, m, &nodes);
+    double value = 0.0f;
+    for (int j=0; j<m; j++){
+        if (nodes.at(j) > 0){
+            value -= std::norm(T.at(j*m))*nodes.at(j)*std::log(nodes.at(j));
+        }
+    }
+    return probe_norm*probe_norm*value;
+}
+
+double SLQEstimator::estimateEntropy(std::vector<std::complex<double> >* images, int rank, double epsilon){
+    // Average over probes, until the standard error of the mean is below tolerance
+    double sum = 0.0f;
+    double sum_squares = 0.0f;
+    probes_used = 0;
+    standard_error = -1;
+    for (int p=0; p<max_probes; p++){
+        double value = quadrature(images, rank, epsilon, probes.at(p));
+        sum += value;
+        sum_squares += value*value;
+        probes_used += 1;
+        if (probes_used >= SLQ_MIN_PROBES){
+            double mean = sum/probes_used;
+            double variance = std::max(sum_squares/probes_used - mean*mean, 0.0)*probes_used/(probes_used-1);
+            standard_error = std::sqrt(variance/probes_used);
+            if (standard_error <= tolerance){
+                break;
+            }
+        }
+    }
+    return sum/probes_used;
+}
+
+double SLQEstimator::getStandardError(){
+    return standard_error;
+}
+
+int SLQEstimator::getProbesUsed(){
+    return probes_used;
+}
+
+int SLQEstimator::getLanczosSteps(){
+    return lanczos_steps;
+}
+
+SLQEstimator::~SLQEstimator(){
+}
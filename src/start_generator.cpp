@@ -0,0 +1,231 @@
+#include "common_includes.h"
+#include "start_generator.h"
+#include "config.h"
+#include "matrix_operations.h"
+
+StartGenerator::StartGenerator(ComplexView* kraus_ops, int kraus_number, int kraus_in_dimension, int kraus_out_dimension){
+    kraus_operators = kraus_ops;
+    d = kraus_number;
+    N = kraus_in_dimension;
+    M = kraus_out_dimension;
+    next_candidate = 0;
+}
+
+int StartGenerator::addSpectralCandidates(){
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    std::complex<double> scale(1.0f/N, 0.0f);
+
+    // Step 1: Phi(I/N) = 1/N sum_k K_k K_k^H
+    std::vector<std::complex<double> > output(M*M, zero);
+    for (int k=0; k<d; k++){
+        cblas_zgemm(CblasColMajor, CblasNoTrans, CblasConjTrans, M, M, N, &scale,
+            reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*M))), M,
+            reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*M))), M,
+            &one, reinterpret_cast<lapack_complex_t*>(output.data()), M);
+    }
+
+    // Step 2: Phi^*(Phi(I/N)) = sum_k K_k^H Phi(I/N) K_k
+    std::vector<std::complex<double> > tmp(M*N);
+    std::vector<std::complex<double> > input(N*N, zero);
+    for (int k=0; k<d; k++){
+        cblas_zgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, M, N, M, &one,
+            reinterpret_cast<lapack_complex_t*>(output.data()), M,
+            reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*M))), M,
+            &zero, reinterpret_cast<lapack_complex_t*>(tmp.data()), M);
+        cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, N, N, M, &one,
+            reinterpret_cast<const lapack_complex_t*>(&(kraus_operators->at(k*N*M))), M,
+            reinterpret_cast<lapack_complex_t*>(tmp.data()), M,
+            &one, reinterpret_cast<lapack_complex_t*>(input.data()), N);
+    }
+
+    // Step 3: all its eigenvectors are candidates, the ranking sorts them out
+    std::vector<double> eigvals(N);
+    zheev_wrapper('V', 'U', N, &input, N, &eigvals);
+    for (int i=N-1; i>=0; i--){
+        candidates.push_back(std::vector<std::complex<double> >(input.begin()+N*i, input.begin()+N*(i+1)));
+        labels.push_back("eigenvector " + std::to_string(N-i) + " of Phi*(Phi(I/N))");
+    }
+    return 0;
+}
+
+int StartGenerator::addOutputCandidates(){
+    std::complex<double> one(1.0f,0.0f);
+    std::complex<double> zero(0.0f,0.0f);
+    // Phi^*(|j><j|) = R^H R, where row k of R (d x N) is row j of K_k. It has rank at most d.
+    // If d < N, its top eigenvector is R^H u for the top eigenvector u of the d x d matrix R R^H: O(d^2 N + d^3) instead of O(N^3).
+    int r = std::min(d, N);
+    std::vector<std::complex<double> > R(d*N);
+    std::vector<std::complex<double> > gram(r*r);
+    std::vector<double> eigvals(r);
+    std::vector<std::complex<double> > u(r);
+    std::vector<std::complex<double> > top(N);
+    for (int j=0; j<M; j++){
+        for (int k=0; k<d; k++){
+            for (int c=0; c<N; c++){
+                R.at(c*d+k) = kraus_operators->at(k*N*M+c*M+j);
+            }
+        }
+        // Step 1: the smaller Gram matrix, and its top eigenvector only
+        if (d < N){
+            cblas_zgemm(CblasColMajor, CblasNoTrans, CblasConjTrans, d, d, N, &one,
+                reinterpret_cast<lapack_complex_t*>(R.data()), d,
+                reinterpret_cast<lapack_complex_t*>(R.data()), d,
+                &zero, reinterpret_cast<lapack_complex_t*>(gram.data()), d);
+        } else {
+            cblas_zgemm(CblasColMajor, CblasConjTrans, CblasNoTrans, N, N, d, &one,
+                reinterpret_cast<lapack_complex_t*>(R.data()), d,
+                reinterpret_cast<lapack_complex_t*>(R.data()), d,
+                &zero, reinterpret_cast<lapack_complex_t*>(gram.data()), N);
+        }
+        zheevr_wrapper('U', r, &gram, r, r, r, &eigvals, &u, r);
+        // Step 2: map it back to the input, unless no input reaches |j> at all
+        if (d < N){
+            if (eigvals.at(0) <= 0){
+                continue;
+            }
+            cblas_zgemv(CblasColMajor, CblasConjTrans, d, N, &one,
+                reinterpret_cast<lapack_complex_t*>(R.data()), d,
+                reinterpret_cast<lapack_complex_t*>(u.data()), 1,
+                &zero, reinterpret_cast<lapack_complex_t*>(top.data()), 1);
+            double norm = cblas_dznrm2(N, reinterpret_cast<lapack_complex_t*>(top.data()), 1);
+            for (int c=0; c<N; c++){
+                top.at(c) /= norm;
+            }
+        } else {
+            top = u;
+        }
+        candidates.push_back(top);
+        labels.push_back("output |" + std::to_string(j) + ">");
+    }
+    return 0;
+}
+
+int StartGenerator::addBasisCandidates(){
+    for (int i=0; i<N; i++){
+        std::vector<std::complex<double> > basis(N, std::complex<double>(0.0f,0.0f));
+        basis.at(i) = std::complex<double>(1.0f,0.0f);
+        candidates.push_back(basis);
+        labels.push_back("basis |" + std::to_string(i) + ">");
+    }
+    for (int k=0; k<N; k++){
+        std::vector<std::complex<double> > fourier(N);
+        for (int c=0; c<N; c++){
+            fourier.at(c) = std::polar(1.0f/std::sqrt(double(N)), 2*M_PI*k*c/N);
+        }
+        candidates.push_back(fourier);
+        labels.push_back("Fourier |" + std::to_string(k) + ">");
+    }
+    return 0;
+}
+
+int StartGenerator::rankCandidates(Minimizer* minimizer){
+    // Step 1: build the pool
+    candidates.clear();
+    labels.clear();
+    addSpectralCandidates();
+    addOutputCandidates();
+    addBasisCandidates();
+
+    // Step 2: one entropy evaluation per candidate, from the Gram matrix of its Kraus images. The minimizer is left on the last one.
+    std::vector<double> values;
+    for (const std::vector<std::complex<double> >& candidate : candidates){
+        *minimizer->getVectorState() = candidate;
+        minimizer->calculateImageEntropy();
+        values.push_back(*minimizer->getEntropy());
+    }
+
+    // Step 3: sort, and drop candidates that coincide with a better one
+    std::vector<int> order(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&values](int a, int b){ return values.at(a) < values.at(b); });
+    std::vector<std::vector<std::complex<double> > > ranked;
+    std::vector<std::string> ranked_labels;
+    entropies.clear();
+    for (int c : order){
+        bool duplicate = false;
+        for (const std::vector<std::complex<double> >& kept : ranked){
+            std::complex<double> overlap;
+            cblas_zdotc_sub(N, reinterpret_cast<const lapack_complex_t*>(kept.data()), 1,
+                reinterpret_cast<const lapack_complex_t*>(candidates.at(c).data()), 1, reinterpret_cast<lapack_complex_t*>(&overlap));
+            if (std::abs(overlap) > MINIMA_FIDELITY_THRESHOLD){
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate){
+            ranked.push_back(candidates.at(c));
+            ranked_labels.push_back(labels.at(c));
+            entropies.push_back(values.at(c));
+        }
+    }
+    candidates.swap(ranked);
+    labels.swap(ranked_labels);
+    next_candidate = 0;
+    return candidates.size();
+}
+
+int StartGenerator::nextVector(std::vector<std::complex<double> >* out){
+    if (next_candidate >= candidates.size()){
+        return 1;
+    }
+    *out = candidates.at(next_candidate);
+    next_candidate += 1;
+    return 0;
+}
+
+int StartGenerator::getCandidateCount(){
+    return candidates.size();
+}
+
+json StartGenerator::getSnapshot(){
+    return {
+        {"labels", labels},
+        {"entropies", encodeDoubles(entropies.data(), entropies.size())}
+    };
+}
+
+std::vector<std::complex<double> > StartGenerator::getCandidates(){
+    std::vector<std::complex<double> > all;
+    for (const std::vector<std::complex<double> >& candidate : candidates){
+        all.insert(all.end(), candidate.begin(), candidate.end());
+    }
+    return all;
+}
+
+int StartGenerator::restoreSnapshot(const json& snapshot, const ComplexView& ranked){
+    std::vector<std::string> ranked_labels = snapshot.at("labels").get<std::vector<std::string> >();
+    if (ranked.size() != ranked_labels.size()*N){
+        throw std::runtime_error("Channel-informed starts do not fit the channel.");
+    }
+    std::vector<double> ranked_entropies(ranked_labels.size());
+    decodeDoubles(snapshot.at("entropies"), ranked_entropies.data(), ranked_entropies.size());
+    candidates.clear();
+    for (size_t c = 0; c < ranked_labels.size(); c++){
+        candidates.push_back(std::vector<std::complex<double> >(ranked.begin() + c*N, ranked.begin() + (c+1)*N));
+    }
+    labels.swap(ranked_labels);
+    entropies.swap(ranked_entropies);
+    next_candidate = 0;
+    return candidates.size();
+}
+
+int StartGenerator::getPosition(){
+    return next_candidate;
+}
+
+int StartGenerator::setPosition(int position){
+    next_candidate = std::min<int>(position, candidates.size());
+    return 0;
+}
+
+std::string StartGenerator::getLabel(){
+    return next_candidate > 0 ? labels.at(next_candidate-1) : "";
+}
+
+double StartGenerator::getEntropy(){
+    return next_candidate > 0 ? entropies.at(next_candidate-1) : -1;
+}
+
+StartGenerator::~StartGenerator(){
+}
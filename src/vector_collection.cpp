@@ -0,0 +1,351 @@
+#include "common_includes.h"
+#include "vector_collection.h"
+#include "checksum.h"
+#include <cerrno>
+#include <cstddef>      // offsetof
+#include <cstring>
+#include <fcntl.h>      // open
+#include <unistd.h>     // pwrite, fsync, ftruncate, close
+#include <sys/file.h>   // flock
+#include <sys/stat.h>   // fstat
+
+static_assert(sizeof(CollectionEntry) == 96, "Index records are stored as they are in memory");
+
+namespace {
+
+uint64_t alignUp(uint64_t offset){
+    return offset + (SERIALIZER_ALIGNMENT - offset % SERIALIZER_ALIGNMENT) % SERIALIZER_ALIGNMENT;
+}
+
+uint64_t fileSize(int fd){
+    struct stat info;
+    if (fstat(fd, &info) != 0){
+        throw std::runtime_error("Failed to read the size of a collection file.");
+    }
+    return info.st_size;
+}
+
+}
+
+VectorCollection::VectorCollection(){
+    data_fd = -1;
+    index_fd = -1;
+    writable = false;
+    unsynced = 0;
+}
+
+VectorCollection::~VectorCollection(){
+    if (writable){
+        try {
+            sync();
+        } catch (const std::exception&){
+            // Nothing more can be done here: the next open repairs the collection
+        }
+    }
+    if (data_fd >= 0){
+        close(data_fd);
+    }
+    if (index_fd >= 0){
+        close(index_fd);
+    }
+}
+
+std::string VectorCollection::indexFilename(const std::string& filename){
+    return filename + ".idx";
+}
+
+std::string VectorCollection::buildHeader(const std::string& magic, uint64_t record_size){
+    std::string header = magic;
+    const std::string version = COLLECTION_VERSION;
+    uint32_t versionSize = version.size();
+    header.append(reinterpret_cast<const char*>(&versionSize), sizeof(versionSize));
+    header += version;
+    // The index also records the size of its records
+    if (record_size > 0){
+        header.append(reinterpret_cast<const char*>(&record_size), sizeof(record_size));
+    }
+    header.append(SERIALIZER_ALIGNMENT - header.size(), '\0');
+    return header;
+}
+
+int VectorCollection::open(const std::string& file, bool write){
+    std::lock_guard<std::mutex> lock(mutex);
+    if (data_fd >= 0){
+        throw std::runtime_error("Collection " + filename + " is already open.");
+    }
+    filename = file;
+    writable = write;
+    entries.clear();
+    mapping.reset();
+
+    // Step 1: the collection, with its header. Other processes do not append while it is checked.
+    if (writable){
+        std::filesystem::path path(filename);
+        if (path.has_parent_path()){
+            std::filesystem::create_directories(path.parent_path());
+        }
+    }
+    data_fd = ::open(filename.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    if (data_fd < 0){
+        throw std::runtime_error("Failed to open collection " + filename + ".");
+    }
+    if (writable && flock(data_fd, LOCK_EX) != 0){
+        throw std::runtime_error("Failed to lock collection " + filename + ".");
+    }
+    try {
+        std::string header = buildHeader("VCOLL", 0);
+        uint64_t data_size = fileSize(data_fd);
+        if (data_size == 0 && writable){
+            writeAt(data_fd, 0, header.data(), header.size());
+            data_size = header.size();
+        }
+        std::string found(header.size(), '\0');
+        if (data_size < header.size() || pread(data_fd, &found[0], found.size(), 0) != ssize_t(found.size()) || found != header){
+            throw std::runtime_error(filename + " is not a collection of version " COLLECTION_VERSION ".");
+        }
+
+        // Step 2: the index. A collection opened for reading may have none: its vectors are then found by reading the collection.
+        index_fd = ::open(indexFilename(filename).c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (index_fd < 0 && (writable || errno != ENOENT)){
+            throw std::runtime_error("Failed to open the index of collection " + filename + ".");
+        }
+        repair(data_size);
+    } catch (...){
+        if (writable){
+            flock(data_fd, LOCK_UN);
+        }
+        throw;
+    }
+    if (writable){
+        flock(data_fd, LOCK_UN);
+    }
+    return entries.size();
+}
+
+int VectorCollection::repair(uint64_t data_size){
+    // Step 1: the records of the index, up to the first one that is torn, does not follow the previous one, or points past the end
+    // of the collection. An index that is not one (or of another version) is rebuilt.
+    std::string index_header = buildHeader("VINDX", sizeof(CollectionEntry));
+    std::string content;
+    if (index_fd >= 0){
+        content.resize(fileSize(index_fd));
+        if (pread(index_fd, &content[0], content.size(), 0) != ssize_t(content.size())){
+            throw std::runtime_error("Failed to read the index of collection " + filename + ".");
+        }
+    }
+    bool index_valid = content.compare(0, index_header.size(), index_header) == 0;
+    uint64_t end = SERIALIZER_ALIGNMENT;
+    for (size_t position = index_header.size(); index_valid && position + sizeof(CollectionEntry) <= content.size(); position += sizeof(CollectionEntry)){
+        CollectionEntry entry;
+        std::memcpy(&entry, content.data() + position, sizeof(entry));
+        if (entry.checksum != entryChecksum(entry) || entry.offset < end || entry.offset % SERIALIZER_ALIGNMENT != 0
+            || entry.size > data_size || entry.offset > data_size - entry.size){
+            break;
+        }
+        entries.push_back(entry);
+        end = entry.offset + entry.size;
+    }
+    size_t indexed = entries.size();
+
+    // Step 2: the index of the last batch may have reached the disk before the vectors did. Check them against their checksums.
+    if (writable){
+        size_t first = indexed > COLLECTION_SYNC_RECORDS ? indexed - COLLECTION_SYNC_RECORDS : 0;
+        for (size_t i = first; i < entries.size(); i++){
+            try {
+                if (serializer.map(mapUpTo(data_size), entries[i].offset, entries[i].offset + entries[i].size, true).size != entries[i].size){
+                    throw std::runtime_error("Size mismatch.");
+                }
+            } catch (const std::exception&){
+                entries.resize(i);
+                break;
+            }
+        }
+        end = entries.empty() ? SERIALIZER_ALIGNMENT : entries.back().offset + entries.back().size;
+    }
+    size_t kept = entries.size();
+
+    // Step 3: stored files after the last indexed one. Complete ones are indexed, and what follows the last of them is cut off.
+    for (uint64_t offset = alignUp(end); offset < data_size; offset = alignUp(end)){
+        try {
+            MappedData stored = serializer.map(mapUpTo(data_size), offset, data_size, true);
+            entries.push_back(describe(offset, stored.size, stored.metadata));
+            end = offset + stored.size;
+        } catch (const std::exception&){
+            break;
+        }
+    }
+    if (!writable){
+        return 0;
+    }
+    bool changed = false;
+    if (end < data_size){
+        if (ftruncate(data_fd, end) != 0){
+            throw std::runtime_error("Failed to truncate collection " + filename + ".");
+        }
+        mapping.reset();
+        changed = true;
+    }
+
+    // Step 4: write the index again if it does not match
+    if (!index_valid || kept != indexed || entries.size() != kept || content.size() != index_header.size() + kept*sizeof(CollectionEntry)){
+        std::string rebuilt = index_header;
+        rebuilt.append(reinterpret_cast<const char*>(entries.data()), entries.size()*sizeof(CollectionEntry));
+        if (ftruncate(index_fd, 0) != 0){
+            throw std::runtime_error("Failed to truncate the index of collection " + filename + ".");
+        }
+        writeAt(index_fd, 0, rebuilt.data(), rebuilt.size());
+        changed = true;
+    }
+    if (changed && (fsync(data_fd) != 0 || fsync(index_fd) != 0)){
+        throw std::runtime_error("Failed to sync collection " + filename + ".");
+    }
+    return 0;
+}
+
+int VectorCollection::append(const std::string& type, const ComplexView& vec, const std::string& description, int d, int N, const json& metadata){
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!writable){
+        throw std::runtime_error("Collection " + filename + " is not open for appending.");
+    }
+    // Step 1: store the vector at the end of the collection, then its record at the end of the index, both while holding the lock.
+    // Other processes may have appended since this one last did, so the ends are read again.
+    if (flock(data_fd, LOCK_EX) != 0){
+        throw std::runtime_error("Failed to lock collection " + filename + ".");
+    }
+    CollectionEntry entry;
+    try {
+        uint64_t offset = alignUp(fileSize(data_fd));
+        uint64_t position = offset;
+        uint64_t size = VectorSerializer::serialize(type, [&](const char* bytes, size_t count){
+            writeAt(data_fd, position, bytes, count);
+            position += count;
+        }, vec, description, d, N, metadata);
+        entry = describe(offset, size, metadata);
+        writeAt(index_fd, fileSize(index_fd), reinterpret_cast<const char*>(&entry), sizeof(entry));
+    } catch (...){
+        flock(data_fd, LOCK_UN);
+        throw;
+    }
+    flock(data_fd, LOCK_UN);
+    entries.push_back(entry);
+
+    // Step 2: sync if the batch is full
+    if (unsynced == 0){
+        first_unsynced = std::chrono::steady_clock::now();
+    }
+    unsynced += 1;
+    if (unsynced >= COLLECTION_SYNC_RECORDS || std::chrono::steady_clock::now() - first_unsynced >= std::chrono::seconds(COLLECTION_SYNC_SECONDS)){
+        // The vectors first, so that a synced record never points to vectors that are not
+        if (fsync(data_fd) != 0 || fsync(index_fd) != 0){
+            throw std::runtime_error("Failed to sync collection " + filename + ".");
+        }
+        unsynced = 0;
+    }
+    return entries.size() - 1;
+}
+
+int VectorCollection::sync(){
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!writable || unsynced == 0){
+        return 0;
+    }
+    if (fsync(data_fd) != 0 || fsync(index_fd) != 0){
+        throw std::runtime_error("Failed to sync collection " + filename + ".");
+    }
+    unsynced = 0;
+    return 0;
+}
+
+size_t VectorCollection::size(){
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+CollectionEntry VectorCollection::getEntry(size_t index){
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.at(index);
+}
+
+std::vector<size_t> VectorCollection::top(size_t k){
+    std::lock_guard<std::mutex> lock(mutex);
+    // Vectors without an entropy come last, and ties in order of the collection
+    auto key = [this](size_t i){
+        return std::isnan(entries[i].entropy) ? INFINITY : entries[i].entropy;
+    };
+    std::vector<size_t> order(entries.size());
+    std::iota(order.begin(), order.end(), 0);
+    k = std::min(k, order.size());
+    std::partial_sort(order.begin(), order.begin() + k, order.end(), [&key](size_t a, size_t b){
+        return key(a) < key(b) || (key(a) == key(b) && a < b);
+    });
+    order.resize(k);
+    return order;
+}
+
+MappedData VectorCollection::map(size_t index, bool verify){
+    std::lock_guard<std::mutex> lock(mutex);
+    const CollectionEntry& entry = entries.at(index);
+    return serializer.map(mapUpTo(entry.offset + entry.size), entry.offset, entry.offset + entry.size, verify);
+}
+
+int VectorCollection::extract(size_t index, const std::string& output){
+    // The stored file is checked first, so that a damaged one is not copied out as if it were fine
+    MappedData stored = map(index, true);
+    CollectionEntry entry = getEntry(index);
+    std::string temporary = output + ".tmp";
+    std::ofstream out_file(temporary, std::ios::binary);
+    if (!out_file.is_open()){
+        throw std::runtime_error("Failed to open " + temporary + " for writing.");
+    }
+    out_file.write(reinterpret_cast<const char*>(stored.mapping->bytes() + entry.offset), entry.size);
+    out_file.close();
+    if (!out_file){
+        throw std::runtime_error("Failed to write " + temporary + ".");
+    }
+    std::filesystem::rename(temporary, output);
+    return 0;
+}
+
+std::shared_ptr<MappedFile> VectorCollection::mapUpTo(uint64_t end){
+    if (mapping == nullptr || mapping->size() < end){
+        mapping = std::make_shared<MappedFile>(filename);
+        if (mapping->size() < end){
+            throw std::runtime_error("Collection " + filename + " is shorter than its index.");
+        }
+    }
+    return mapping;
+}
+
+CollectionEntry VectorCollection::describe(uint64_t offset, uint64_t size, const json& metadata){
+    CollectionEntry entry = {};
+    entry.offset = offset;
+    entry.size = size;
+    entry.entropy = metadata.contains("entropy") && metadata["entropy"].is_number() ? metadata["entropy"].get<double>() : NAN;
+    if (metadata.contains("rng") && metadata["rng"].is_object()){
+        const json& rng = metadata["rng"];
+        entry.seed = rng.contains("seed") && rng["seed"].is_number_unsigned() ? rng["seed"].get<uint64_t>() : 0;
+        entry.stream = rng.contains("first_stream") && rng["first_stream"].is_number_unsigned() ? rng["first_stream"].get<uint64_t>() : 0;
+    }
+    entry.iteration = metadata.contains("iteration") && metadata["iteration"].is_number_integer() ? metadata["iteration"].get<int64_t>() : -1;
+    if (metadata.contains("run_id") && metadata["run_id"].is_string()){
+        std::strncpy(entry.run_id, metadata["run_id"].get<std::string>().c_str(), sizeof(entry.run_id) - 1);
+    }
+    entry.checksum = entryChecksum(entry);
+    return entry;
+}
+
+uint64_t VectorCollection::entryChecksum(const CollectionEntry& entry){
+    return xxHash64(reinterpret_cast<const uint8_t*>(&entry), offsetof(CollectionEntry, checksum), 0);
+}
+
+void VectorCollection::writeAt(int fd, uint64_t offset, const char* bytes, size_t size){
+    while (size > 0){
+        ssize_t written = pwrite(fd, bytes, size, offset);
+        if (written < 0){
+            throw std::runtime_error("Failed to write to collection " + filename + ".");
+        }
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+}
@@ -1,7 +1,13 @@
 #include "common_includes.h"
 #include "vector_serializer.h"
+#include "checksum.h"
 #include "nlohmann/json.hpp"
 using json = nlohmann::json;
+#include <cstring>
+#include <fcntl.h>      // For mapping files: open
+#include <unistd.h>     // close
+#include <sys/mman.h>   // mmap, madvise
+#include <sys/stat.h>   // fstat
 
 VectorSerializer::VectorSerializer(/* args */)
 {
@@ -13,119 +19,245 @@ VectorSerializer::~VectorSerializer()
 }
 
 
-void VectorSerializer::serialize(const std::string& type, const std::string& fileName, const std::vector<std::complex<double>>& vec, 
-                                  const std::string& description, int d, int N) {
-    std::ofstream outFile(fileName, std::ios::binary);
-    if (!outFile.is_open()) {
-        throw std::runtime_error("Failed to open file for writing.");
-    }
+std::string VectorSerializer::buildMetadata(const std::string& description, int d, int N, const json& extra_metadata) {
+    json metadata = {
+        {"metadata_version", "1.0"},
+        {"description", description},
+        {"d", d},
+        {"N", N}
+    };
+    metadata.update(extra_metadata);
+    return metadata.dump();
+}
+
+std::string VectorSerializer::buildHeader(const std::string& type, const std::string& metadataStr, uint64_t vectorSize) {
+    // The header is assembled in memory, so that it is written with one call
+    std::string header;
+    auto append = [&header](const void* bytes, size_t size) {
+        header.append(reinterpret_cast<const char*>(bytes), size);
+    };
 
     // Magic identifier
     if (type == "vector") {
-        const std::string magic = "VECTR";
-        outFile.write(magic.c_str(), magic.size());
+        header += "VECTR";
     } else if (type == "kraus") {
-        const std::string magic = "KRAUS";
-        outFile.write(magic.c_str(), magic.size());
+        header += "KRAUS";
+    } else if (type == "state") {
+        header += "STATE";
+    } else if (type == "channel") {
+        header += "CHANL";
     } else {
         throw std::runtime_error("Invalid type for serialization.");
     }
 
     // Format version
-    const std::string version = "1.0";
+    const std::string version = SERIALIZER_FORMAT_VERSION;
     uint32_t versionSize = version.size();
-    outFile.write(reinterpret_cast<const char*>(&versionSize), sizeof(versionSize)); // Write the size of the version string
-    outFile.write(version.c_str(), versionSize); // Write the version string
+    append(&versionSize, sizeof(versionSize)); // Write the size of the version string
+    header += version; // Write the version string
 
     // Metadata
-    json metadata = {
-        {"metadata_version", "1.0"},
-        {"description", description},
-        {"d", d},
-        {"N", N}
-    };
-    std::string metadataStr = metadata.dump();
-    uint32_t metadataSize = metadataStr.size();
-    outFile.write(reinterpret_cast<const char*>(&metadataSize), sizeof(metadataSize)); // Write the size of the metadata string
-    outFile.write(metadataStr.c_str(), metadataSize); // Write the metadata string
+    uint64_t metadataSize = metadataStr.size();
+    append(&metadataSize, sizeof(metadataSize)); // Write the size of the metadata string
+    header += metadataStr; // Write the metadata string
+
+    // Vector size and checksum chunk size
+    uint64_t chunkSize = SERIALIZER_CHUNK_SIZE;
+    append(&vectorSize, sizeof(vectorSize)); // Write the size of the vector
+    append(&chunkSize, sizeof(chunkSize));
+
+    // Padding, so that the data is aligned when the file is mapped
+    header.append((SERIALIZER_ALIGNMENT - header.size() % SERIALIZER_ALIGNMENT) % SERIALIZER_ALIGNMENT, '\0');
+    return header;
+}
 
-    // Vector size
-    uint32_t vectorSize = vec.size(); 
-    outFile.write(reinterpret_cast<const char*>(&vectorSize), sizeof(vectorSize)); // Write the size of the vector
+void VectorSerializer::serialize(const std::string& type, const std::string& fileName, const ComplexView& vec, 
+                                  const std::string& description, int d, int N, const json& extra_metadata) {
+    std::ofstream outFile(fileName, std::ios::binary);
+    if (!outFile.is_open()) {
+        throw std::runtime_error("Failed to open file for writing.");
+    }
+    serialize(type, [&outFile](const char* bytes, size_t size) { outFile.write(bytes, size); }, vec, description, d, N, extra_metadata);
+    outFile.close();
+    if (!outFile) {
+        throw std::runtime_error("Failed to write file.");
+    }
+}
 
-    // Vector data
-    for (const auto& elem : vec) {
-        double real = elem.real();
-        double imag = elem.imag();
-        outFile.write(reinterpret_cast<const char*>(&real), sizeof(real));
-        outFile.write(reinterpret_cast<const char*>(&imag), sizeof(imag));
+uint64_t VectorSerializer::serialize(const std::string& type, const std::function<void(const char*, size_t)>& write, const ComplexView& vec,
+                                     const std::string& description, int d, int N, const json& extra_metadata) {
+    std::string metadataStr = buildMetadata(description, d, N, extra_metadata);
+    std::string header = buildHeader(type, metadataStr, vec.size());
+
+    // Footer: checksum of the metadata and the data, computed in parallel
+    size_t dataSize = vec.size()*sizeof(std::complex<double>);
+    uint64_t checksum = calculateHash(reinterpret_cast<const uint8_t*>(metadataStr.data()), metadataStr.size(),
+                                      reinterpret_cast<const uint8_t*>(vec.data()), dataSize, SERIALIZER_CHUNK_SIZE);
+
+    write(header.data(), header.size());
+    write(reinterpret_cast<const char*>(vec.data()), dataSize); // Write the vector data
+    write(reinterpret_cast<const char*>(&checksum), sizeof(checksum)); // Write the checksum
+    return header.size() + dataSize + sizeof(checksum);
+}
+
+VectorStreamWriter::VectorStreamWriter() : dataHash(SERIALIZER_CHUNK_SIZE), metadataHash(0), expected(0), written(0), open(false) {
+}
+
+VectorStreamWriter::~VectorStreamWriter() {
+    // A file that was not finalized is incomplete: do not leave it behind
+    if (open) {
+        outFile.close();
+        std::remove(fileName.c_str());
     }
+}
 
-    // Footer: Calculate checksum
-    std::vector<uint8_t> footerBuffer;
-    std::stringstream footerStream;
-    footerStream.write(metadataStr.c_str(), metadataSize);
-    for (const auto& elem : vec) {
-        footerStream.write(reinterpret_cast<const char*>(&elem), sizeof(elem));
+void VectorStreamWriter::begin(const std::string& type, const std::string& fileName, uint64_t vectorSize,
+                               const std::string& description, int d, int N, const json& extra_metadata) {
+    if (open) {
+        throw std::runtime_error("Stream writer already has an open file.");
     }
+    std::string metadataStr = VectorSerializer::buildMetadata(description, d, N, extra_metadata);
+    std::string header = VectorSerializer::buildHeader(type, metadataStr, vectorSize);
+    outFile.open(fileName, std::ios::binary | std::ios::trunc);
+    if (!outFile.is_open()) {
+        throw std::runtime_error("Failed to open file for writing.");
+    }
+    this->fileName = fileName;
+    open = true;
+    outFile.write(header.data(), header.size());
+    metadataHash = xxHash64(reinterpret_cast<const uint8_t*>(metadataStr.data()), metadataStr.size(), 0);
+    dataHash = ChunkedHash(SERIALIZER_CHUNK_SIZE);
+    expected = vectorSize;
+    written = 0;
+}
 
-    footerBuffer.assign(std::istreambuf_iterator<char>(footerStream), std::istreambuf_iterator<char>()); 
-    uint32_t checksum = calculateChecksum(footerBuffer);
-    outFile.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum)); // Write the checksum
+void VectorStreamWriter::append(const std::complex<double>* block, size_t size) {
+    if (!open) {
+        throw std::runtime_error("Stream writer has no open file.");
+    }
+    if (size > expected - written) {
+        throw std::runtime_error("More data appended than announced in begin.");
+    }
+    size_t bytes = size*sizeof(std::complex<double>);
+    outFile.write(reinterpret_cast<const char*>(block), bytes);
+    if (!outFile) {
+        throw std::runtime_error("Failed to write file.");
+    }
+    dataHash.update(reinterpret_cast<const uint8_t*>(block), bytes);
+    written += size;
+}
 
+void VectorStreamWriter::finalize() {
+    if (!open) {
+        throw std::runtime_error("Stream writer has no open file.");
+    }
+    if (written != expected) {
+        throw std::runtime_error("Less data appended than announced in begin.");
+    }
+    // Footer: same checksum as VectorSerializer::calculateHash on the whole data
+    uint64_t hashes[2] = {metadataHash, dataHash.digest()};
+    uint64_t checksum = xxHash64(reinterpret_cast<const uint8_t*>(hashes), sizeof(hashes), 0);
+    outFile.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum)); // Write the checksum
     outFile.close();
+    open = false;
+    if (!outFile) {
+        throw std::runtime_error("Failed to write file.");
+    }
 }
 
 DeserializedData VectorSerializer::deserialize(const std::string& fileName) {
-    std::ifstream inFile(fileName, std::ios::binary);
-    if (!inFile.is_open()) {
-        throw std::runtime_error("Failed to open file for reading.");
+    // Map the file, and copy the vector out of the mapping in one go
+    MappedData mapped = map(fileName, true);
+
+    // Return the deserialized data as DeserializedData struct
+    DeserializedData deserializedData;
+    deserializedData.type = mapped.type;
+    deserializedData.vectorData.assign(mapped.view.begin(), mapped.view.end());
+    deserializedData.d = mapped.d;
+    deserializedData.N = mapped.N;
+    deserializedData.description = mapped.description;
+    deserializedData.metadata = std::move(mapped.metadata);
+
+    return deserializedData;
+}
+
+MappedData VectorSerializer::map(const std::string& fileName, bool verify) {
+    std::shared_ptr<MappedFile> mapping = std::make_shared<MappedFile>(fileName);
+    return map(mapping, 0, mapping->size(), verify);
+}
+
+MappedData VectorSerializer::map(const std::shared_ptr<MappedFile>& mapping, size_t begin, size_t end, bool verify) {
+    if (begin > end || end > mapping->size()) {
+        throw std::runtime_error("Unexpected end of file.");
     }
+    // Offsets are relative to begin, as if the file started there
+    const uint8_t* bytes = mapping->bytes() + begin;
+    size_t fileSize = end - begin;
+    size_t offset = 0;
+    // Every read is checked against the end of the file
+    auto read = [&](void* out, size_t size) {
+        if (size > fileSize - offset) {
+            throw std::runtime_error("Unexpected end of file.");
+        }
+        std::memcpy(out, bytes + offset, size);
+        offset += size;
+    };
+    // madvise wants a page-aligned start
+    auto advise = [&](int advice) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t start = begin - begin % page;
+        madvise(const_cast<uint8_t*>(mapping->bytes()) + start, end - start, advice);
+    };
 
     // Read magic identifier
     char magic[5];
-    inFile.read(magic, 5);
+    read(magic, 5);
     // Check magic identifier
-    if (std::strncmp(magic, "VECTR", 5) != 0 && std::strncmp(magic, "KRAUS", 5) != 0) {
+    if (std::strncmp(magic, "VECTR", 5) != 0 && std::strncmp(magic, "KRAUS", 5) != 0 && std::strncmp(magic, "STATE", 5) != 0 && std::strncmp(magic, "CHANL", 5) != 0) {
         throw std::runtime_error("Invalid magic identifier.");
     }
 
     // Read format version
     uint32_t versionSize;
-    inFile.read(reinterpret_cast<char*>(&versionSize), sizeof(versionSize));
+    read(&versionSize, sizeof(versionSize));
     std::string version(versionSize, '\0');
-    inFile.read(&version[0], versionSize);
+    read(&version[0], versionSize);
+    bool legacy = version == "1.0";
+    if (!legacy && version != "2.0") {
+        throw std::runtime_error("Unsupported format version " + version + ".");
+    }
 
-    // Read metadata
-    uint32_t metadataSize;
-    inFile.read(reinterpret_cast<char*>(&metadataSize), sizeof(metadataSize));
+    // Read metadata. Sizes are 32 bits in version 1.0, 64 bits since.
+    uint64_t metadataSize = 0;
+    read(&metadataSize, legacy ? sizeof(uint32_t) : sizeof(uint64_t));
+    if (metadataSize > fileSize - offset) {
+        throw std::runtime_error("Unexpected end of file.");
+    }
+    size_t metadataOffset = offset;
     std::string metadataStr(metadataSize, '\0');
-    inFile.read(&metadataStr[0], metadataSize);
+    read(&metadataStr[0], metadataSize);
     json metadata = json::parse(metadataStr);
 
-    // Extract metadata to DeserualizedData struct
-    std::string description;
-    int d, N;
-
-
+    // Extract metadata to MappedData struct
+    MappedData mappedData;
     try {
         // Check and extract "description"
         if (metadata.contains("description") && metadata["description"].is_string()) {
-            description = metadata["description"].get<std::string>();
+            mappedData.description = metadata["description"].get<std::string>();
         } else {
             throw std::runtime_error("Missing or invalid 'description' in metadata.");
         }
 
         // Check and extract "d"
         if (metadata.contains("d") && metadata["d"].is_number_integer()) {
-            d = metadata["d"].get<int>();
+            mappedData.d = metadata["d"].get<int>();
         } else {
             throw std::runtime_error("Missing or invalid 'd' in metadata.");
         }
 
         // Check and extract "N"
         if (metadata.contains("N") && metadata["N"].is_number_integer()) {
-            N = metadata["N"].get<int>();
+            mappedData.N = metadata["N"].get<int>();
         } else {
             throw std::runtime_error("Missing or invalid 'N' in metadata.");
         }
@@ -133,64 +265,152 @@ DeserializedData VectorSerializer::deserialize(const std::string& fileName) {
         throw std::runtime_error(std::string("Error extracting metadata: ") + e.what());
     }
 
-    // Read vector size
-    uint32_t vectorSize;
-    inFile.read(reinterpret_cast<char*>(&vectorSize), sizeof(vectorSize));
-
-    // Read vector data
-    std::vector<std::complex<double>> vec(vectorSize);
-    for (size_t i = 0; i < vectorSize; ++i) {
-        double real, imag;
-        inFile.read(reinterpret_cast<char*>(&real), sizeof(real));
-        inFile.read(reinterpret_cast<char*>(&imag), sizeof(imag));
-        vec[i] = std::complex<double>(real, imag);
+    // Read vector size, and in version 2.0 the chunk size and the padding. The data and the checksum after it must be in the file.
+    uint64_t vectorSize = 0;
+    uint64_t chunkSize = 0;
+    read(&vectorSize, legacy ? sizeof(uint32_t) : sizeof(uint64_t));
+    if (!legacy) {
+        read(&chunkSize, sizeof(chunkSize));
+        if (chunkSize == 0) {
+            throw std::runtime_error("Invalid checksum chunk size.");
+        }
+        offset += (SERIALIZER_ALIGNMENT - offset % SERIALIZER_ALIGNMENT) % SERIALIZER_ALIGNMENT;
     }
-
-    // Read footer: checksum
-    uint32_t checksum;
-    inFile.read(reinterpret_cast<char*>(&checksum), sizeof(checksum));
-
-    // Validate checksum
-    std::vector<uint8_t> footerBuffer;
-    std::stringstream footerStream;
-    footerStream.write(metadataStr.c_str(), metadataSize);
-    for (const auto& elem : vec) {
-        footerStream.write(reinterpret_cast<const char*>(&elem), sizeof(elem));
+    size_t footerSize = legacy ? sizeof(uint32_t) : sizeof(uint64_t);
+    size_t dataOffset = offset;
+    if (dataOffset > fileSize || vectorSize > (fileSize - dataOffset)/sizeof(std::complex<double>)) {
+        throw std::runtime_error("Unexpected end of file.");
     }
-
-    footerBuffer.assign(std::istreambuf_iterator<char>(footerStream), std::istreambuf_iterator<char>());
-    uint32_t calculatedChecksum = calculateChecksum(footerBuffer);
-
-    if (calculatedChecksum != checksum) {
-        throw std::runtime_error("Checksum validation failed.");
+    size_t dataSize = vectorSize*sizeof(std::complex<double>);
+    if (dataSize + footerSize > fileSize - dataOffset) {
+        throw std::runtime_error("Unexpected end of file.");
+    }
+    offset += dataSize;
+
+    // Read footer: checksum, and validate it if asked. The pass is sequential: tell the kernel to read ahead.
+    uint64_t checksum = 0;
+    read(&checksum, footerSize);
+    if (verify) {
+        advise(MADV_SEQUENTIAL);
+        uint64_t calculatedChecksum;
+        if (legacy) {
+            calculatedChecksum = uint32_t(calculateChecksum(bytes + metadataOffset, metadataSize) + calculateChecksum(bytes + dataOffset, dataSize));
+        } else {
+            calculatedChecksum = calculateHash(bytes + metadataOffset, metadataSize, bytes + dataOffset, dataSize, chunkSize);
+        }
+        advise(MADV_NORMAL);
+        if (calculatedChecksum != checksum) {
+            throw std::runtime_error("Checksum validation failed.");
+        }
+    } else {
+        // Start reading the pages in the background
+        advise(MADV_WILLNEED);
     }
 
-    inFile.close();
+    // The data region is used in place if it is aligned, which it need not be in version 1.0
+    const uint8_t* data = bytes + dataOffset;
+    mappedData.zero_copy = reinterpret_cast<uintptr_t>(data) % alignof(std::complex<double>) == 0;
+    if (mappedData.zero_copy) {
+        mappedData.view = ComplexView(reinterpret_cast<const std::complex<double>*>(data), vectorSize);
+    } else {
+        mappedData.copy = std::make_shared<std::vector<std::complex<double> > >(vectorSize);
+        std::memcpy(mappedData.copy->data(), data, dataSize);
+        mappedData.view = ComplexView(*mappedData.copy);
+    }
 
-    // Return the deserialized data as DeserializedData struct
-    DeserializedData deserializedData;
     // choose type
     if (std::strncmp(magic, "VECTR", 5) == 0) {
-        deserializedData.type = "vector";
-    } else if (std::strncmp(magic, "KRAUS", 5) == 0) {
-        deserializedData.type = "kraus";
+        mappedData.type = "vector";
+    } else if (std::strncmp(magic, "STATE", 5) == 0) {
+        mappedData.type = "state";
+    } else if (std::strncmp(magic, "CHANL", 5) == 0) {
+        mappedData.type = "channel";
     } else {
-        deserializedData.type = "unknown";
+        mappedData.type = "kraus";
     }
-    deserializedData.vectorData = vec;
-    deserializedData.d = d;
-    deserializedData.N = N;
-    deserializedData.description = description;
-    deserializedData.metadata = metadata;
+    mappedData.version = version;
+    mappedData.size = offset;
+    mappedData.checksum = checksum;
+    mappedData.metadata = metadata;
+    mappedData.mapping = mapping;
 
-    return deserializedData;
+    return mappedData;
 }
 
-uint32_t VectorSerializer::calculateChecksum(const std::vector<uint8_t>& buffer) {
+uint32_t VectorSerializer::calculateChecksum(const uint8_t* bytes, size_t size) {
     uint32_t checksum = 0;
-    for (uint8_t byte : buffer) {
-        checksum += byte;
+    for (size_t i = 0; i < size; ++i) {
+        checksum += bytes[i];
     }
     return checksum;
 }
 
+uint64_t VectorSerializer::calculateHash(const uint8_t* metadata, size_t metadataSize, const uint8_t* data, size_t dataSize, size_t chunkSize) {
+    uint64_t hashes[2] = {xxHash64(metadata, metadataSize, 0), chunkedHash(data, dataSize, chunkSize)};
+    return xxHash64(reinterpret_cast<const uint8_t*>(hashes), sizeof(hashes), 0);
+}
+
+json encodeDouble(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double decodeDouble(const json& encoded) {
+    uint64_t bits = encoded.get<uint64_t>();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+json encodeDoubles(const double* values, size_t count) {
+    json encoded = json::array();
+    for (size_t i = 0; i < count; i++) {
+        encoded.push_back(encodeDouble(values[i]));
+    }
+    return encoded;
+}
+
+int decodeDoubles(const json& encoded, double* values, size_t count) {
+    if (!encoded.is_array() || encoded.size() != count) {
+        throw std::runtime_error("Unexpected number of values in metadata.");
+    }
+    for (size_t i = 0; i < count; i++) {
+        values[i] = decodeDouble(encoded.at(i));
+    }
+    return 0;
+}
+
+MappedFile::MappedFile(const std::string& fileName) {
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file for reading.");
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        throw std::runtime_error("Failed to read the size of the file, or the file is empty.");
+    }
+    length = info.st_size;
+    // Shared and read-only: concurrent processes on the same file use the same pages of the page cache
+    address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file open
+    close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Failed to map the file.");
+    }
+}
+
+MappedFile::~MappedFile() {
+    munmap(address, length);
+}
+
+const uint8_t* MappedFile::bytes() const {
+    return static_cast<const uint8_t*>(address);
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
+
+